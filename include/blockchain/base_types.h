@@ -362,6 +362,18 @@ namespace BaseTypes
     {
         UncommittedTransactionSuffix() {}
 
+        UncommittedTransactionSuffix(const std::vector<uint8_t> &data)
+        {
+            deserializer_t reader(data);
+
+            deserialize_suffix(reader);
+        }
+
+        UncommittedTransactionSuffix(deserializer_t &reader)
+        {
+            deserialize_suffix(reader);
+        }
+
         [[nodiscard]] crypto_hash_t suffix_hash() const
         {
             serializer_t writer;
@@ -403,6 +415,15 @@ namespace BaseTypes
             range_proof.serialize(writer);
         }
 
+        std::vector<uint8_t> serialize_suffix() const
+        {
+            serializer_t writer;
+
+            serialize_suffix(writer);
+
+            return writer.vector();
+        }
+
         JSON_TO_FUNC(suffix_toJSON)
         {
             writer.Key("offsets");
@@ -683,6 +704,8 @@ namespace Types::Blockchain
     typedef BaseTypes::TransactionOutput transaction_output_t;
 
     typedef BaseTypes::StakerOutput staker_output_t;
+
+    typedef BaseTypes::UncommittedTransactionSuffix transaction_suffix_t;
 } // namespace Types::Blockchain
 
 namespace std
@@ -0,0 +1,129 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef TURTLECOIN_TRANSACTION_OUTPUTS_H
+#define TURTLECOIN_TRANSACTION_OUTPUTS_H
+
+#include "base_types.h"
+
+namespace Types::Blockchain
+{
+    /**
+     * A partial view of a committed transaction of any type that decodes only its type, its public
+     * key and its outputs, skipping over everything else (ie. its data, signatures, or the proofs
+     * held in its suffix) without decoding it
+     *
+     * The layout read here must be kept in step with the deserialize() method of each transaction
+     * type it skips through.
+     */
+    struct transaction_outputs_t
+    {
+        transaction_outputs_t() {}
+
+        transaction_outputs_t(deserializer_t &reader)
+        {
+            deserialize(reader);
+        }
+
+        transaction_outputs_t(const std::vector<uint8_t> &data)
+        {
+            deserializer_t reader(data);
+
+            deserialize(reader);
+        }
+
+        /**
+         * Reads the transaction from the reader, stopping as soon as its outputs have been read
+         *
+         * Staker reward transactions pay their stakers rather than one-time keys, so nothing
+         * beyond their type is read for them.
+         *
+         * @param reader
+         */
+        void deserialize(deserializer_t &reader)
+        {
+            type = reader.varint<uint64_t>();
+
+            outputs.clear();
+
+            if (type == BaseTypes::TransactionType::STAKER_REWARD)
+            {
+                return;
+            }
+
+            // version, unlock block
+            [[maybe_unused]] const auto version = reader.varint<uint64_t>();
+
+            [[maybe_unused]] const auto unlock_block = reader.varint<uint64_t>();
+
+            tx_public_key = reader.key<crypto_public_key_t>();
+
+            switch (type)
+            {
+                case BaseTypes::TransactionType::GENESIS:
+                {
+                    [[maybe_unused]] const auto tx_secret_key = reader.key<crypto_secret_key_t>();
+
+                    deserialize_outputs(reader);
+
+                    break;
+                }
+                case BaseTypes::TransactionType::NORMAL:
+                case BaseTypes::TransactionType::STAKE:
+                case BaseTypes::TransactionType::RECALL_STAKE:
+                {
+                    // nonce, fee, key images
+                    [[maybe_unused]] const auto nonce = reader.varint<uint64_t>();
+
+                    [[maybe_unused]] const auto fee = reader.varint<uint64_t>();
+
+                    [[maybe_unused]] const auto key_images = reader.keyV<crypto_key_image_t>();
+
+                    deserialize_outputs(reader);
+
+                    break;
+                }
+                case BaseTypes::TransactionType::STAKE_REFUND:
+                {
+                    [[maybe_unused]] const auto tx_secret_key = reader.key<crypto_secret_key_t>();
+
+                    [[maybe_unused]] const auto recall_stake_tx = reader.key<crypto_hash_t>();
+
+                    outputs.emplace_back(reader);
+
+                    break;
+                }
+                default:
+                    throw std::invalid_argument("Unknown transaction type");
+            }
+        }
+
+        /**
+         * Whether the outputs of the transaction are given global indexes
+         *
+         * @return
+         */
+        [[nodiscard]] bool indexed() const
+        {
+            return type != BaseTypes::TransactionType::STAKER_REWARD;
+        }
+
+        uint64_t type = 0;
+        crypto_public_key_t tx_public_key;
+        std::vector<transaction_output_t> outputs;
+
+      private:
+        void deserialize_outputs(deserializer_t &reader)
+        {
+            const auto count = reader.varint<uint64_t>();
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                outputs.emplace_back(reader);
+            }
+        }
+    };
+} // namespace Types::Blockchain
+
+#endif // TURTLECOIN_TRANSACTION_OUTPUTS_H
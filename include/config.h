@@ -155,6 +155,140 @@ namespace Configuration
         const uint16_t DEFAULT_WALLET_BIND_PORT = 18070;
     } // namespace API
 
+    namespace Database
+    {
+        /**
+         * The default number of blocks written within a single database write transaction
+         * when storing blocks in bulk (ie. during initial synchronization)
+         */
+        const size_t BLOCKS_PER_WRITE_TRANSACTION = 100;
+
+        /**
+         * The default amount of memory (in bytes) used to cache decoded blocks and transactions
+         */
+        const size_t DEFAULT_CACHE_SIZE = 64 * 1024 * 1024;
+
+        /**
+         * The number of independently locked shards that the caches are split into
+         */
+        const size_t CACHE_SHARDS = 16;
+
+        /**
+         * The number of the most recent block headers held in memory, which covers the windows
+         * of recent blocks walked when validating the next block
+         */
+        const size_t RECENT_BLOCK_HEADERS = 4'096;
+
+        /**
+         * The number of bits of the key image filter allocated to each key image, which sets
+         * the false positive rate of the filter (16 bits yields roughly 0.1%)
+         */
+        const size_t KEY_IMAGE_FILTER_BITS_PER_KEY = 16;
+
+        /**
+         * The minimum number of key images the key image filter is sized for
+         */
+        const size_t KEY_IMAGE_FILTER_MINIMUM_CAPACITY = 1'000'000;
+
+        /**
+         * The size (in bytes) of the dictionary trained to compress the stored transactions
+         */
+        const size_t COMPRESSION_DICTIONARY_SIZE = 32 * 1024;
+
+        /**
+         * The number of stored transactions sampled to train the compression dictionary, which
+         * is trained once the blockchain storage holds at least this many transactions
+         */
+        const size_t COMPRESSION_TRAINING_SAMPLES = 10'000;
+
+        /**
+         * The maximum number of named databases the blockchain storage environment may hold,
+         * which includes headroom for the tables used while migrating older layouts
+         */
+        const unsigned int MAXIMUM_DATABASES = 24;
+
+        /**
+         * The number of records copied within a single database write transaction when
+         * migrating a table to a newer layout
+         */
+        const size_t MIGRATION_RECORDS_PER_WRITE_TRANSACTION = 100'000;
+
+        /**
+         * The minimum and maximum amount of memory (in bytes) added to the database memory map
+         * each time it grows
+         */
+        const size_t MAP_MINIMUM_INCREMENT = 64 * 1024 * 1024;
+
+        const size_t MAP_MAXIMUM_INCREMENT = size_t(4) * 1024 * 1024 * 1024;
+
+        /**
+         * The factor by which the database memory map grows each time it is expanded
+         */
+        const double MAP_GROWTH_RATIO = 1.5;
+
+        /**
+         * Once less than this fraction of the database memory map remains unused, it is expanded
+         * between write transactions rather than waiting for a write transaction to fill it
+         */
+        const double MAP_FREE_SPACE_THRESHOLD = 0.1;
+
+        /**
+         * The number of bytes of the database memory map reserved for every serialized byte
+         * of the blocks and transactions in a bulk import, which covers the indexes and the
+         * partially filled pages written alongside them
+         */
+        const size_t MAP_RESERVE_FACTOR = 4;
+
+        /**
+         * How often (in milliseconds) the block writer syncs the database to disk when it is
+         * not syncing every group commit
+         */
+        const size_t WRITER_SYNC_INTERVAL = 100;
+
+        /**
+         * The maximum number of transaction suffixes written within a single write transaction
+         * of the suffix archive
+         */
+        const size_t SUFFIX_ARCHIVE_BATCH_SIZE = 1'000;
+
+        /**
+         * The number of transaction suffixes that may wait to be archived before archive()
+         * blocks until the writer catches up
+         */
+        const size_t SUFFIX_ARCHIVE_MAXIMUM_PENDING = 100'000;
+
+        /**
+         * The number of bytes of records written to a snapshot between checkpoints, which also
+         * bounds the memory used (and the size of each write transaction) while importing
+         */
+        const size_t SNAPSHOT_CHECKPOINT_BYTES = 16 * 1024 * 1024;
+
+        /**
+         * The number of consecutive blocks handed to a verification thread at a time, each of which
+         * is verified within its own read session
+         */
+        const size_t VERIFY_BLOCKS_PER_CHUNK = 1'000;
+
+        /**
+         * The default number of bytes of wallet sync records returned by a single call, after
+         * which the caller continues from the block following the last block returned
+         */
+        const size_t WALLET_SYNC_MAXIMUM_BYTES = 1024 * 1024;
+
+        /**
+         * The number of recent election results (keyed by their round seed) held in memory for
+         * peers asking about the producers and validators of past rounds
+         */
+        const size_t ELECTION_CACHE_ROUNDS = 1'024;
+
+        /**
+         * The names of the database directories held within the data directory
+         */
+        const std::string BLOCKCHAIN_DB_NAME = "blockchain";
+
+        const std::string STAKING_DB_NAME = "staking";
+    } // namespace Database
+
     namespace Consensus
     {
         /**
@@ -163,6 +297,12 @@ namespace Configuration
          */
         const size_t ELECTOR_TARGET_COUNT = 10;
 
+        /**
+         * The number of blocks in each round; the hashes of the blocks of a round establish the
+         * election seed (M) from which the producers and validators of the next round are elected
+         */
+        const size_t BLOCKS_PER_ROUND = 100;
+
         /**
          * The minimum percentage of validators in a round that must validate a block for
          * the block to be committed to the chain.
@@ -0,0 +1,256 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef TURTLECOIN_THREAD_SAFE_LRU_CACHE_H
+#define TURTLECOIN_THREAD_SAFE_LRU_CACHE_H
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+/**
+ * A least recently used cache that is bounded by the total cost (in bytes) of the values that
+ * it holds rather than by the number of entries that it holds
+ *
+ * The cache is split into shards, each with its own lock and an equal share of the capacity,
+ * so that concurrent readers rarely contend with one another. The shard for a key is selected
+ * using the supplied ShardHash functor.
+ */
+template<typename K, typename V, typename ShardHash> class ThreadSafeLRUCache
+{
+  public:
+    struct stats_t
+    {
+        size_t capacity = 0;
+
+        size_t bytes = 0;
+
+        size_t entries = 0;
+
+        size_t evictions = 0;
+
+        size_t hits = 0;
+
+        size_t misses = 0;
+    };
+
+    /**
+     * Creates a new cache that holds up to the specified number of bytes spread across
+     * the specified number of shards. A capacity of zero disables the cache.
+     *
+     * @param capacity
+     * @param shards
+     */
+    ThreadSafeLRUCache(size_t capacity, size_t shards = 16):
+        m_capacity(capacity), m_hits(0), m_misses(0), m_evictions(0)
+    {
+        if (shards == 0)
+        {
+            shards = 1;
+        }
+
+        m_shard_capacity = m_capacity / shards;
+
+        for (size_t i = 0; i < shards; ++i)
+        {
+            m_shards.push_back(std::make_unique<shard_t>());
+        }
+    }
+
+    /**
+     * Returns the maximum number of bytes the cache will hold
+     *
+     * @return
+     */
+    size_t capacity() const
+    {
+        return m_capacity;
+    }
+
+    /**
+     * Removes all elements from the cache
+     */
+    void clear()
+    {
+        for (auto &shard : m_shards)
+        {
+            std::scoped_lock lock(shard->mutex);
+
+            shard->entries.clear();
+
+            shard->index.clear();
+
+            shard->bytes = 0;
+        }
+    }
+
+    /**
+     * Removes the element with the specified key from the cache
+     *
+     * @param key
+     */
+    void erase(const K &key)
+    {
+        auto &shard = shard_for(key);
+
+        std::scoped_lock lock(shard.mutex);
+
+        const auto it = shard.index.find(key);
+
+        if (it == shard.index.end())
+        {
+            return;
+        }
+
+        shard.bytes -= std::get<2>(*it->second);
+
+        shard.entries.erase(it->second);
+
+        shard.index.erase(it);
+    }
+
+    /**
+     * Retrieves a copy of the value with the specified key and marks it as the most recently used
+     *
+     * @param key
+     * @return
+     */
+    std::optional<V> get(const K &key)
+    {
+        if (m_capacity == 0)
+        {
+            return std::nullopt;
+        }
+
+        auto &shard = shard_for(key);
+
+        std::scoped_lock lock(shard.mutex);
+
+        const auto it = shard.index.find(key);
+
+        if (it == shard.index.end())
+        {
+            m_misses++;
+
+            return std::nullopt;
+        }
+
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+
+        m_hits++;
+
+        return std::get<1>(*it->second);
+    }
+
+    /**
+     * Inserts (or replaces) the value with the specified key at the specified cost, evicting the
+     * least recently used values as required to stay within the capacity of the shard
+     *
+     * Values that cost more than the capacity of a shard are not cached.
+     *
+     * @param key
+     * @param value
+     * @param cost
+     */
+    void insert(const K &key, const V &value, size_t cost)
+    {
+        if (cost > m_shard_capacity)
+        {
+            return;
+        }
+
+        auto &shard = shard_for(key);
+
+        std::scoped_lock lock(shard.mutex);
+
+        const auto it = shard.index.find(key);
+
+        if (it != shard.index.end())
+        {
+            shard.bytes -= std::get<2>(*it->second);
+
+            shard.entries.erase(it->second);
+
+            shard.index.erase(it);
+        }
+
+        shard.entries.emplace_front(key, value, cost);
+
+        shard.index.insert({key, shard.entries.begin()});
+
+        shard.bytes += cost;
+
+        while (shard.bytes > m_shard_capacity)
+        {
+            const auto &[last_key, last_value, last_cost] = shard.entries.back();
+
+            shard.bytes -= last_cost;
+
+            shard.index.erase(last_key);
+
+            shard.entries.pop_back();
+
+            m_evictions++;
+        }
+    }
+
+    /**
+     * Returns the usage statistics of the cache
+     *
+     * @return
+     */
+    stats_t stats() const
+    {
+        stats_t result;
+
+        result.capacity = m_capacity;
+
+        result.hits = m_hits;
+
+        result.misses = m_misses;
+
+        result.evictions = m_evictions;
+
+        for (const auto &shard : m_shards)
+        {
+            std::scoped_lock lock(shard->mutex);
+
+            result.bytes += shard->bytes;
+
+            result.entries += shard->index.size();
+        }
+
+        return result;
+    }
+
+  private:
+    struct shard_t
+    {
+        mutable std::mutex mutex;
+
+        std::list<std::tuple<K, V, size_t>> entries;
+
+        std::map<K, typename std::list<std::tuple<K, V, size_t>>::iterator> index;
+
+        size_t bytes = 0;
+    };
+
+    shard_t &shard_for(const K &key)
+    {
+        return *m_shards[ShardHash()(key) % m_shards.size()];
+    }
+
+    size_t m_capacity, m_shard_capacity;
+
+    std::atomic<size_t> m_hits, m_misses, m_evictions;
+
+    std::vector<std::unique_ptr<shard_t>> m_shards;
+};
+
+#endif
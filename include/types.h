@@ -20,6 +20,9 @@
 #include "blockchain/transaction_recall_stake.h"
 #include "blockchain/transaction_stake.h"
 
+// Partial Transaction Views
+#include "blockchain/transaction_outputs.h"
+
 // Network Packets
 #include "network/packet_data.h"
 #include "network/packet_handshake.h"
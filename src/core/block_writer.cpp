@@ -0,0 +1,311 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "block_writer.h"
+
+#include <algorithm>
+
+namespace Core
+{
+    BlockWriter::BlockWriter(
+        std::shared_ptr<BlockchainStorage> storage,
+        durability_t durability,
+        size_t sync_interval,
+        size_t maximum_batch):
+        m_storage(std::move(storage)),
+        m_durability(durability),
+        m_sync_interval(std::max(sync_interval, size_t(1))),
+        m_maximum_batch(std::max(maximum_batch, size_t(1))),
+        m_dirty(false),
+        m_epoch(1),
+        m_failed_epoch(0),
+        m_running(true),
+        m_blocks(0),
+        m_commits(0),
+        m_failed_blocks(0),
+        m_syncs(0)
+    {
+        if (m_durability != DURABILITY_SYNC)
+        {
+            const auto error = m_storage->set_sync_on_commit(false);
+
+            if (error)
+            {
+                throw std::runtime_error("Could not disable database sync on commit: " + error.to_string());
+            }
+        }
+
+        m_thread = std::thread(&BlockWriter::writer_thread, this);
+    }
+
+    BlockWriter::~BlockWriter()
+    {
+        stop();
+    }
+
+    std::vector<Error> BlockWriter::commit(
+        const std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>>
+            &blocks)
+    {
+        m_commits++;
+
+        const auto error = m_storage->put_blocks(blocks, blocks.size());
+
+        if (!error)
+        {
+            return std::vector<Error>(blocks.size(), MAKE_ERROR(SUCCESS));
+        }
+
+        /**
+         * The whole group was rolled back, so each block is retried within its own write transaction
+         * to find out which of them caused the failure. The blocks after the first that fails are not
+         * stored as the block indexes are appended and would otherwise be left with a gap.
+         */
+        std::vector<Error> results;
+
+        results.reserve(blocks.size());
+
+        for (const auto &[block, transactions] : blocks)
+        {
+            if (!results.empty() && results.back())
+            {
+                results.push_back(MAKE_ERROR(DB_WRITER_PRECEDING_BLOCK_FAILED));
+
+                continue;
+            }
+
+            m_commits++;
+
+            results.push_back(m_storage->put_block(block, transactions));
+        }
+
+        return results;
+    }
+
+    durability_t BlockWriter::durability() const
+    {
+        return m_durability;
+    }
+
+    std::future<Error> BlockWriter::enqueue(
+        Types::Blockchain::block_t block,
+        std::vector<Types::Blockchain::transaction_t> transactions)
+    {
+        pending_block_t pending;
+
+        auto future = pending.promise.get_future();
+
+        {
+            std::scoped_lock lock(m_mutex);
+
+            if (!m_running)
+            {
+                pending.promise.set_value(MAKE_ERROR(DB_WRITER_STOPPED));
+
+                return future;
+            }
+
+            if (m_failed_epoch == m_epoch)
+            {
+                pending.promise.set_value(MAKE_ERROR(DB_WRITER_PRECEDING_BLOCK_FAILED));
+
+                return future;
+            }
+
+            pending.block = {std::move(block), std::move(transactions)};
+
+            pending.epoch = m_epoch;
+
+            m_queue.push_back(std::move(pending));
+        }
+
+        m_queued.notify_one();
+
+        return future;
+    }
+
+    bool BlockWriter::failed() const
+    {
+        std::scoped_lock lock(m_mutex);
+
+        return m_failed_epoch == m_epoch;
+    }
+
+    size_t BlockWriter::pending() const
+    {
+        std::scoped_lock lock(m_mutex);
+
+        return m_queue.size();
+    }
+
+    void BlockWriter::resume()
+    {
+        std::scoped_lock lock(m_mutex);
+
+        m_epoch++;
+    }
+
+    bool BlockWriter::running() const
+    {
+        return m_running;
+    }
+
+    BlockWriter::stats_t BlockWriter::stats() const
+    {
+        stats_t result;
+
+        result.blocks = m_blocks;
+
+        result.commits = m_commits;
+
+        result.failed_blocks = m_failed_blocks;
+
+        result.syncs = m_syncs;
+
+        return result;
+    }
+
+    void BlockWriter::stop()
+    {
+        {
+            std::scoped_lock lock(m_mutex);
+
+            m_running = false;
+        }
+
+        m_queued.notify_all();
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+
+            if (m_durability != DURABILITY_SYNC)
+            {
+                m_storage->set_sync_on_commit(true);
+            }
+        }
+    }
+
+    void BlockWriter::sync()
+    {
+        const auto error = m_storage->flush(true);
+
+        m_syncs++;
+
+        m_dirty = false;
+
+        // a block only counts as stored once it has reached the disk
+        for (auto &[promise, result] : m_awaiting_sync)
+        {
+            promise.set_value((error) ? error : result);
+        }
+
+        m_awaiting_sync.clear();
+    }
+
+    void BlockWriter::writer_thread()
+    {
+        auto next_sync = std::chrono::steady_clock::now() + m_sync_interval;
+
+        while (true)
+        {
+            std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>> blocks;
+
+            std::vector<std::promise<Error>> promises;
+
+            bool stopping, rejected = false;
+
+            uint64_t epoch = 0;
+
+            {
+                std::unique_lock lock(m_mutex);
+
+                const auto ready = [this] { return !m_queue.empty() || !m_running; };
+
+                // there is nothing to wake up for between syncs unless there is something to sync
+                if (m_durability == DURABILITY_SYNC || !m_dirty)
+                {
+                    m_queued.wait(lock, ready);
+                }
+                else
+                {
+                    m_queued.wait_until(lock, next_sync, ready);
+                }
+
+                if (!m_queue.empty())
+                {
+                    epoch = m_queue.front().epoch;
+
+                    // the blocks queued before (or alongside) a block that failed were built upon it
+                    rejected = epoch <= m_failed_epoch;
+                }
+
+                // everything waiting at this point joins the same group commit, unless queued after a resume()
+                while (!m_queue.empty() && blocks.size() < m_maximum_batch && m_queue.front().epoch == epoch)
+                {
+                    blocks.push_back(std::move(m_queue.front().block));
+
+                    promises.push_back(std::move(m_queue.front().promise));
+
+                    m_queue.pop_front();
+                }
+
+                stopping = !m_running && m_queue.empty();
+            }
+
+            if (!blocks.empty())
+            {
+                std::vector<Error> results(blocks.size(), MAKE_ERROR(DB_WRITER_PRECEDING_BLOCK_FAILED));
+
+                if (!rejected)
+                {
+                    results = commit(blocks);
+                }
+
+                if (std::any_of(results.begin(), results.end(), [](const auto &result) { return bool(result); }))
+                {
+                    std::scoped_lock lock(m_mutex);
+
+                    m_failed_epoch = std::max(m_failed_epoch, epoch);
+                }
+
+                for (size_t i = 0; i < results.size(); ++i)
+                {
+                    if (results[i])
+                    {
+                        m_failed_blocks++;
+                    }
+                    else
+                    {
+                        m_blocks++;
+
+                        m_dirty = true;
+                    }
+
+                    if (m_durability == DURABILITY_INTERVAL && !results[i])
+                    {
+                        m_awaiting_sync.emplace_back(std::move(promises[i]), results[i]);
+                    }
+                    else
+                    {
+                        promises[i].set_value(results[i]);
+                    }
+                }
+            }
+
+            if (m_durability != DURABILITY_SYNC && m_dirty
+                && (stopping || std::chrono::steady_clock::now() >= next_sync))
+            {
+                sync();
+
+                next_sync = std::chrono::steady_clock::now() + m_sync_interval;
+            }
+
+            if (stopping)
+            {
+                break;
+            }
+        }
+    }
+} // namespace Core
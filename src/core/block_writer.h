@@ -0,0 +1,214 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_BLOCK_WRITER_H
+#define CORE_BLOCK_WRITER_H
+
+#include <atomic>
+#include <blockchain_storage.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace Core
+{
+    /**
+     * Controls when the blocks committed by the block writer are synced to disk
+     */
+    enum durability_t
+    {
+        /**
+         * Every group commit is synced to disk before the futures of its blocks are resolved
+         */
+        DURABILITY_SYNC,
+        /**
+         * Group commits are not synced as they happen; instead the database is synced every
+         * sync interval and the futures of the blocks are resolved once they are on disk
+         */
+        DURABILITY_INTERVAL,
+        /**
+         * Group commits are not synced and the futures of the blocks are resolved as soon as
+         * they commit; the database is synced every sync interval so a system crash loses at
+         * most the blocks committed within that interval
+         */
+        DURABILITY_NOSYNC
+    };
+
+    /**
+     * Persists blocks on a dedicated writer thread so that the callers validating blocks do not
+     * wait on the disk
+     *
+     * Producers enqueue blocks and receive a future that resolves with the result of storing
+     * the block. The writer thread merges every block waiting in the queue (up to the maximum
+     * batch size) into a single LMDB write transaction so that the cost of each commit, and its
+     * sync to disk, is shared by all of the blocks in that group.
+     *
+     * Blocks are stored in the order in which they are enqueued. Should a group commit fail, its
+     * blocks are retried one at a time until one fails; that block reports its error and every
+     * block after it in the group reports DB_WRITER_PRECEDING_BLOCK_FAILED without being stored
+     * so that the chain is never stored with a gap. The writer then stays failed: every block
+     * queued before the caller calls resume() (having resynchronized with the stored chain) is
+     * rejected with DB_WRITER_PRECEDING_BLOCK_FAILED rather than stored.
+     *
+     * Please note: while the writer is not using DURABILITY_SYNC, every write transaction in
+     * the storage environment (including those from put_block()) skips its sync to disk.
+     */
+    class BlockWriter
+    {
+      public:
+        struct stats_t
+        {
+            size_t blocks = 0;
+
+            size_t commits = 0;
+
+            size_t failed_blocks = 0;
+
+            size_t syncs = 0;
+        };
+
+        /**
+         * Creates a new block writer and starts its writer thread
+         *
+         * @param storage
+         * @param durability
+         * @param sync_interval how often (in milliseconds) the database is synced if not DURABILITY_SYNC
+         * @param maximum_batch the maximum number of blocks written within a single write transaction
+         */
+        BlockWriter(
+            std::shared_ptr<BlockchainStorage> storage,
+            durability_t durability = DURABILITY_SYNC,
+            size_t sync_interval = Configuration::Database::WRITER_SYNC_INTERVAL,
+            size_t maximum_batch = Configuration::Database::BLOCKS_PER_WRITE_TRANSACTION);
+
+        /**
+         * Destroying the instance stops the writer thread after it has stored every queued block
+         */
+        ~BlockWriter();
+
+        /**
+         * Returns the durability mode of the writer
+         *
+         * @return
+         */
+        [[nodiscard]] durability_t durability() const;
+
+        /**
+         * Queues the block with the transactions specified to be saved in the database
+         *
+         * @param block
+         * @param transactions
+         * @return a future that resolves with the result of saving the block
+         */
+        std::future<Error> enqueue(
+            Types::Blockchain::block_t block,
+            std::vector<Types::Blockchain::transaction_t> transactions);
+
+        /**
+         * Returns whether a block failed to be stored since the last call to resume()
+         *
+         * @return
+         */
+        [[nodiscard]] bool failed() const;
+
+        /**
+         * Returns the number of blocks waiting to be written
+         *
+         * @return
+         */
+        [[nodiscard]] size_t pending() const;
+
+        /**
+         * Clears the failed state of the writer once the caller has resynchronized with the stored
+         * chain; blocks queued before the call are still rejected, blocks queued after it are stored
+         */
+        void resume();
+
+        /**
+         * Returns whether the writer thread is running or not
+         *
+         * @return
+         */
+        [[nodiscard]] bool running() const;
+
+        /**
+         * Retrieves the write counters of the writer
+         *
+         * @return
+         */
+        [[nodiscard]] stats_t stats() const;
+
+        /**
+         * Stops accepting blocks, stores every block already queued, syncs the database to disk
+         * and then stops the writer thread
+         */
+        void stop();
+
+      private:
+        struct pending_block_t
+        {
+            std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>> block;
+
+            std::promise<Error> promise;
+
+            uint64_t epoch = 0;
+        };
+
+        /**
+         * Writes the blocks within a single write transaction, falling back to writing them one
+         * at a time (up to the first block that fails) if the group commit fails
+         *
+         * @param blocks
+         * @return the result of saving each block
+         */
+        std::vector<Error> commit(
+            const std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>>
+                &blocks);
+
+        /**
+         * Syncs the database to disk and resolves the futures waiting on the sync
+         */
+        void sync();
+
+        /**
+         * The thread that writes the queued blocks to the database
+         */
+        void writer_thread();
+
+        std::shared_ptr<BlockchainStorage> m_storage;
+
+        durability_t m_durability;
+
+        std::chrono::milliseconds m_sync_interval;
+
+        size_t m_maximum_batch;
+
+        mutable std::mutex m_mutex;
+
+        std::condition_variable m_queued;
+
+        std::deque<pending_block_t> m_queue;
+
+        std::vector<std::pair<std::promise<Error>, Error>> m_awaiting_sync;
+
+        bool m_dirty;
+
+        /**
+         * Blocks are queued within the epoch current at the time, which resume() advances, and are
+         * rejected if a block of the same (or a later) epoch failed to be stored
+         */
+        uint64_t m_epoch, m_failed_epoch;
+
+        std::atomic<bool> m_running;
+
+        std::thread m_thread;
+
+        std::atomic<size_t> m_blocks, m_commits, m_failed_blocks, m_syncs;
+    };
+} // namespace Core
+
+#endif // CORE_BLOCK_WRITER_H
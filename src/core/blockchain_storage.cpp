@@ -4,302 +4,2296 @@
 
 #include "blockchain_storage.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
 static std::shared_ptr<Core::BlockchainStorage> blockchain_storage_instance;
 
 namespace Core
 {
-    BlockchainStorage::BlockchainStorage(const std::string &db_path)
+    /**
+     * Retrieves the key images spent by the transaction, if it spends any
+     *
+     * @param transaction
+     * @return
+     */
+    static std::vector<crypto_key_image_t> transaction_key_images(const Types::Blockchain::transaction_t &transaction)
     {
-        m_db_env = Database::LMDB::getInstance(db_path, 0, 0600, 16, 8);
-
-        m_blocks = m_db_env->open_database("blocks");
+        return std::visit(
+            [](auto &&arg)
+            {
+                using T = std::decay_t<decltype(arg)>;
 
-        m_block_indexes = m_db_env->open_database("block_indexes");
+                if constexpr (
+                    std::is_same_v<
+                        T,
+                        Types::Blockchain::
+                            committed_normal_transaction_t> || std::is_same_v<T, Types::Blockchain::committed_stake_transaction_t> || std::is_same_v<T, Types::Blockchain::committed_recall_stake_transaction_t>)
+                {
+                    return arg.key_images;
+                }
+                else
+                {
+                    return std::vector<crypto_key_image_t>();
+                }
+            },
+            transaction);
+    }
 
-        m_block_timestamps = m_db_env->open_database("block_timestamps");
+    /**
+     * Retrieves the outputs that the transaction adds to the global indexes (as they are stored,
+     * without their amounts) and whether the transaction is given global indexes at all
+     *
+     * @param transaction
+     * @return [indexed, outputs]
+     */
+    static std::tuple<bool, std::vector<Types::Blockchain::transaction_output_t>>
+        transaction_outputs(const Types::Blockchain::transaction_t &transaction)
+    {
+        return std::visit(
+            [](auto &&arg)
+            {
+                using T = std::decay_t<decltype(arg)>;
 
-        m_transactions = m_db_env->open_database("transactions");
+                std::vector<Types::Blockchain::transaction_output_t> outputs;
 
-        m_key_images = m_db_env->open_database("key_images");
+                if constexpr (
+                    std::is_same_v<
+                        T,
+                        Types::Blockchain::
+                            committed_normal_transaction_t> || std::is_same_v<T, Types::Blockchain::committed_stake_transaction_t> || std::is_same_v<T, Types::Blockchain::committed_recall_stake_transaction_t> || std::is_same_v<T, Types::Blockchain::genesis_transaction_t>)
+                {
+                    for (const auto &output : arg.outputs)
+                    {
+                        outputs.emplace_back(output.public_ephemeral, 0, output.commitment);
+                    }
 
-        m_global_indexes = m_db_env->open_database("global_indexes");
+                    return std::make_tuple(true, outputs);
+                }
+                else if constexpr (std::is_same_v<T, Types::Blockchain::stake_refund_transaction_t>)
+                {
+                    outputs.emplace_back(arg.public_ephemeral, 0, arg.commitment);
 
-        m_transaction_indexes = m_db_env->open_database("transaction_indexes");
+                    return std::make_tuple(true, outputs);
+                }
+                else
+                {
+                    return std::make_tuple(false, outputs);
+                }
+            },
+            transaction);
+    }
 
-        m_transaction_block_hashes = m_db_env->open_database("transaction_block_hashes");
+    block_header_t::block_header_t(const Types::Blockchain::block_t &block, const crypto_hash_t &block_hash):
+        block_index(block.block_index),
+        block_hash(block_hash),
+        previous_blockhash(block.previous_blockhash),
+        timestamp(block.timestamp),
+        transaction_count(block.transactions.size()),
+        producer_public_key(block.producer_public_key)
+    {
     }
 
-    std::shared_ptr<BlockchainStorage> BlockchainStorage::getInstance(const std::string &db_path)
+    block_header_t::block_header_t(const std::vector<uint8_t> &data)
     {
-        if (!blockchain_storage_instance)
+        if (data.size() != SIZE)
         {
-            blockchain_storage_instance = std::make_shared<BlockchainStorage>(db_path);
+            throw std::invalid_argument("Invalid block header record size");
         }
 
-        return blockchain_storage_instance;
-    }
+        deserializer_t reader(data);
 
-    bool BlockchainStorage::block_exists(const crypto_hash_t &block_hash) const
-    {
-        return m_blocks->exists(block_hash);
+        block_index = reader.uint64();
+
+        block_hash = reader.key<crypto_hash_t>();
+
+        previous_blockhash = reader.key<crypto_hash_t>();
+
+        timestamp = reader.uint64();
+
+        transaction_count = reader.uint64();
+
+        producer_public_key = reader.key<crypto_public_key_t>();
     }
 
-    bool BlockchainStorage::block_exists(const uint64_t &block_index) const
+    std::vector<uint8_t> block_header_t::serialize() const
     {
-        return m_block_indexes->exists(block_index);
+        serializer_t writer;
+
+        writer.uint64(block_index);
+
+        writer.key(block_hash);
+
+        writer.key(previous_blockhash);
+
+        writer.uint64(timestamp);
+
+        writer.uint64(transaction_count);
+
+        writer.key(producer_public_key);
+
+        return writer.vector();
     }
 
-    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
-        BlockchainStorage::get_block(const crypto_hash_t &block_hash) const
+    size_t wallet_sync_block_t::size() const
     {
-        // go get the block
-        const auto [error, block] = m_blocks->get<crypto_hash_t, Types::Blockchain::block_t>(block_hash);
+        // block index (8), block hash (32), timestamp (8)
+        size_t result = 48;
 
-        if (error)
+        for (const auto &transaction : transactions)
         {
-            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}, {}};
+            // transaction hash (32), public key (32), and per output: global index (8), ephemeral (32), commitment (32)
+            result += 64 + transaction.outputs.size() * 72;
         }
 
-        std::vector<Types::Blockchain::transaction_t> transactions;
+        return result;
+    }
+
+    BlockchainStorage::block_undo_t::block_undo_t(const std::vector<uint8_t> &data)
+    {
+        deserializer_t reader(data);
+
+        block_hash = reader.key<crypto_hash_t>();
+
+        timestamp = reader.varint<uint64_t>();
+
+        first_global_index = reader.varint<uint64_t>();
+
+        output_count = reader.varint<uint64_t>();
 
-        // loop through the transactions in the block and retrieve them
-        for (const auto &txn : block.transactions)
         {
-            // retrieve the transaction
-            const auto [txn_error, transaction, txn_block_hash] = get_transaction(txn);
+            const auto count = reader.varint<uint64_t>();
 
-            if (txn_error)
+            for (size_t i = 0; i < count; ++i)
             {
-                return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}, {}};
+                transactions.push_back(reader.key<crypto_hash_t>());
             }
-
-            transactions.push_back(transaction);
         }
 
-        return {MAKE_ERROR(SUCCESS), block, transactions};
+        {
+            const auto count = reader.varint<uint64_t>();
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                key_images.push_back(reader.key<crypto_key_image_t>());
+            }
+        }
     }
 
-    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
-        BlockchainStorage::get_block(const uint64_t &block_index) const
+    std::vector<uint8_t> BlockchainStorage::block_undo_t::serialize() const
     {
-        // go get the block
-        const auto [error, block_hash] = m_block_indexes->get<crypto_hash_t>(block_index);
+        serializer_t writer;
 
-        if (error)
+        writer.key(block_hash);
+
+        writer.varint(timestamp);
+
+        writer.varint(first_global_index);
+
+        writer.varint(output_count);
+
+        writer.varint(transactions.size());
+
+        for (const auto &txn_hash : transactions)
         {
-            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}, {}};
+            writer.key(txn_hash);
+        }
+
+        writer.varint(key_images.size());
+
+        for (const auto &key_image : key_images)
+        {
+            writer.key(key_image);
         }
 
-        return get_block(block_hash);
+        return writer.vector();
     }
 
-    std::tuple<Error, uint64_t, crypto_hash_t>
-        BlockchainStorage::get_block_by_timestamp(const uint64_t &timestamp) const
+    BlockchainReadSession::BlockchainReadSession(
+        const BlockchainStorage &storage,
+        std::unique_ptr<Database::LMDBTransaction> db_tx):
+        m_storage(storage), m_db_tx(std::move(db_tx))
     {
-        auto txn = m_block_timestamps->transaction(true);
+    }
 
-        auto cursor = txn->cursor();
+    bool BlockchainReadSession::block_exists(const crypto_hash_t &block_hash)
+    {
+        return m_storage.block_exists(m_db_tx, block_hash);
+    }
 
-        // go get the next closest (higher) timestamp information
-        const auto [error, result_timestamp, block_hash] = cursor->get<crypto_hash_t>(timestamp, MDB_SET_RANGE);
+    bool BlockchainReadSession::block_exists(const uint64_t &block_index)
+    {
+        return m_storage.block_exists(m_db_tx, block_index);
+    }
 
-        if (error)
-        {
-            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), 0, {}};
-        }
+    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+        BlockchainReadSession::get_block(const crypto_hash_t &block_hash)
+    {
+        return m_storage.get_block(m_db_tx, block_hash);
+    }
 
-        return {error, result_timestamp, block_hash};
+    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+        BlockchainReadSession::get_block(const uint64_t &block_index)
+    {
+        return m_storage.get_block(m_db_tx, block_index);
     }
 
-    size_t BlockchainStorage::get_block_count() const
+    std::tuple<Error, uint64_t, crypto_hash_t> BlockchainReadSession::get_block_by_timestamp(const uint64_t &timestamp)
     {
-        return m_blocks->count();
+        return m_storage.get_block_by_timestamp(m_db_tx, timestamp);
     }
 
-    std::tuple<Error, crypto_hash_t> BlockchainStorage::get_block_hash(const uint64_t &block_index) const
+    size_t BlockchainReadSession::get_block_count()
     {
-        // go get the block hash from the indexes
-        const auto [error, block_hash] = m_block_indexes->get<crypto_hash_t>(block_index);
+        return m_storage.get_block_count(m_db_tx);
+    }
 
-        if (error)
-        {
-            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}};
-        }
+    std::tuple<Error, crypto_hash_t> BlockchainReadSession::get_block_hash(const uint64_t &block_index)
+    {
+        return m_storage.get_block_hash(m_db_tx, block_index);
+    }
 
-        return {error, block_hash};
+    std::tuple<Error, std::vector<crypto_hash_t>>
+        BlockchainReadSession::get_block_hashes(const uint64_t &first_block_index, const uint64_t &last_block_index)
+    {
+        return m_storage.get_block_hashes(m_db_tx, first_block_index, last_block_index);
     }
 
-    std::tuple<Error, uint64_t> BlockchainStorage::get_block_index(const crypto_hash_t &block_hash) const
+    std::tuple<Error, block_header_t> BlockchainReadSession::get_block_header(const crypto_hash_t &block_hash)
     {
-        // go get the block
-        const auto [error, block] = m_blocks->get<crypto_hash_t, Types::Blockchain::block_t>(block_hash);
+        return m_storage.get_block_header(m_db_tx, block_hash);
+    }
 
-        if (error)
-        {
-            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), 0};
-        }
+    std::tuple<Error, block_header_t> BlockchainReadSession::get_block_header(const uint64_t &block_index)
+    {
+        return m_storage.get_block_header(m_db_tx, block_index);
+    }
 
-        return {error, block.block_index};
+    std::tuple<Error, std::vector<block_header_t>>
+        BlockchainReadSession::get_block_headers(const uint64_t &first_block_index, const uint64_t &last_block_index)
+    {
+        return m_storage.get_block_headers(m_db_tx, first_block_index, last_block_index);
     }
 
-    std::tuple<Error, uint64_t> BlockchainStorage::get_maximum_global_index() const
+    std::tuple<Error, uint64_t> BlockchainReadSession::get_block_index(const crypto_hash_t &block_hash)
     {
-        const auto count = m_global_indexes->count();
+        return m_storage.get_block_index(m_db_tx, block_hash);
+    }
 
-        if (count == 0)
-        {
-            return {MAKE_ERROR(DB_EMPTY), 0};
-        }
+    std::tuple<Error, std::vector<std::tuple<uint64_t, uint64_t>>>
+        BlockchainReadSession::get_block_indexes_by_timestamp(
+            const uint64_t &first_timestamp,
+            const uint64_t &last_timestamp)
+    {
+        return m_storage.get_block_indexes_by_timestamp(m_db_tx, first_timestamp, last_timestamp);
+    }
 
-        return {MAKE_ERROR(SUCCESS), count - 1};
+    std::tuple<Error, uint64_t> BlockchainReadSession::get_maximum_global_index()
+    {
+        return m_storage.get_maximum_global_index(m_db_tx);
     }
 
     std::tuple<Error, Types::Blockchain::transaction_output_t>
-        BlockchainStorage::get_output_by_global_index(const uint64_t &global_index) const
+        BlockchainReadSession::get_output_by_global_index(const uint64_t &global_index)
     {
-        // go get the maximum global index number
-        const auto [error, maximum_global_index] = get_maximum_global_index();
+        return m_storage.get_output_by_global_index(m_db_tx, global_index);
+    }
 
-        if (error)
-        {
-            return {error, {}};
-        }
+    std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
+        BlockchainReadSession::get_outputs_by_global_indexes(const std::vector<uint64_t> &global_indexes)
+    {
+        return m_storage.get_outputs_by_global_indexes(m_db_tx, global_indexes);
+    }
 
-        if (global_index > maximum_global_index)
-        {
-            return {MAKE_ERROR(DB_GLOBAL_INDEX_OUT_OF_BOUNDS), {}};
-        }
+    std::tuple<Error, std::vector<Types::Blockchain::transaction_output_t>>
+        BlockchainReadSession::get_ring_outputs(const std::vector<uint64_t> &global_indexes)
+    {
+        return m_storage.get_ring_outputs(m_db_tx, global_indexes);
+    }
 
-        // go get the transaction output for the global index
-        return m_global_indexes->get<Types::Blockchain::transaction_output_t>(global_index);
+    std::tuple<Error, std::vector<std::vector<Types::Blockchain::transaction_output_t>>>
+        BlockchainReadSession::get_ring_outputs(const std::vector<std::vector<uint64_t>> &rings)
+    {
+        return m_storage.get_ring_outputs(m_db_tx, rings);
     }
 
-    std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
-        BlockchainStorage::get_outputs_by_global_indexes(const std::vector<uint64_t> &global_indexes) const
+    std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t>
+        BlockchainReadSession::get_transaction(const crypto_hash_t &txn_hash)
     {
-        std::map<uint64_t, Types::Blockchain::transaction_output_t> results;
+        return m_storage.get_transaction(m_db_tx, txn_hash);
+    }
 
-        // loop through the global indexes
-        for (const auto &index : global_indexes)
-        {
-            // go get the transaction output for the global index
-            const auto [error, output] = get_output_by_global_index(index);
+    std::tuple<Error, std::vector<uint64_t>>
+        BlockchainReadSession::get_transaction_indexes(const crypto_hash_t &txn_hash)
+    {
+        return m_storage.get_transaction_indexes(m_db_tx, txn_hash);
+    }
 
-            if (error)
-            {
-                return {error, {}};
-            }
+    std::tuple<Error, std::vector<wallet_sync_block_t>> BlockchainReadSession::get_wallet_sync_data(
+        const uint64_t &start_height,
+        const uint64_t &count,
+        size_t maximum_bytes)
+    {
+        return m_storage.get_wallet_sync_data(m_db_tx, start_height, count, maximum_bytes);
+    }
 
-            results.insert({index, output});
-        }
+    bool BlockchainReadSession::key_image_exists(const crypto_key_image_t &key_image)
+    {
+        return m_storage.key_image_exists(m_db_tx, key_image);
+    }
 
-        // if we did not get the same number of results as requested... fail
-        if (results.size() != global_indexes.size())
-        {
-            return {MAKE_ERROR(DB_GLOBAL_INDEX_OUT_OF_BOUNDS), {}};
-        }
+    std::map<crypto_key_image_t, bool>
+        BlockchainReadSession::key_image_exists(const std::vector<crypto_key_image_t> &key_images)
+    {
+        return m_storage.key_image_exists(m_db_tx, key_images);
+    }
 
-        return {MAKE_ERROR(SUCCESS), results};
+    std::tuple<Error, block_verification_t>
+        BlockchainReadSession::verify_block(const uint64_t &block_index, bool validate_construction)
+    {
+        return m_storage.verify_block(m_db_tx, block_index, validate_construction);
     }
 
-    std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t>
-        BlockchainStorage::get_transaction(const crypto_hash_t &txn_hash) const
+    BlockchainStorage::BlockchainStorage(const std::string &db_path, size_t cache_size):
+        m_block_cache(cache_size / 2, Configuration::Database::CACHE_SHARDS),
+        m_transaction_cache(cache_size / 2, Configuration::Database::CACHE_SHARDS),
+        m_cache_floor(0),
+        m_key_image_filter_valid(false),
+        m_key_image_filter_rebuilding(false),
+        m_recent_headers(Configuration::Database::RECENT_BLOCK_HEADERS),
+        m_recent_headers_first(0),
+        m_recent_headers_end(0),
+        m_transaction_dictionary_trained(false)
     {
-        // go get the transaction
-        const auto [error, txn_data] = m_transactions->get(txn_hash);
+        m_db_env = Database::LMDB::getInstance(
+            db_path,
+            0,
+            0600,
+            Configuration::Database::MAP_MINIMUM_INCREMENT / (1024 * 1024),
+            Configuration::Database::MAXIMUM_DATABASES);
 
-        if (error)
         {
-            return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}, {}};
-        }
+            auto policy = m_db_env->growth_policy();
 
-        // go get the block hash the transaction is contained within
-        const auto [txn_error, block_hash] = m_transaction_block_hashes->get<crypto_hash_t>(txn_hash);
+            policy.minimum_increment = Configuration::Database::MAP_MINIMUM_INCREMENT;
 
-        if (txn_error)
-        {
-            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}, {}};
-        }
+            policy.maximum_increment = Configuration::Database::MAP_MAXIMUM_INCREMENT;
 
-        deserializer_t reader(txn_data);
+            policy.growth_ratio = Configuration::Database::MAP_GROWTH_RATIO;
 
-        // figure out what type of transaction it is
-        const auto type = reader.varint<uint64_t>(true);
+            policy.free_space_threshold = Configuration::Database::MAP_FREE_SPACE_THRESHOLD;
 
-        // depending on the transaction type, we'll return the proper structure
-        switch (type)
-        {
-            case Types::Blockchain::TransactionType::GENESIS:
-                return {MAKE_ERROR(SUCCESS), Types::Blockchain::genesis_transaction_t(reader), block_hash};
-            case Types::Blockchain::TransactionType::STAKER_REWARD:
-                return {MAKE_ERROR(SUCCESS), Types::Blockchain::staker_reward_transaction_t(reader), block_hash};
-            case Types::Blockchain::TransactionType::NORMAL:
-                return {MAKE_ERROR(SUCCESS), Types::Blockchain::committed_normal_transaction_t(reader), block_hash};
-            case Types::Blockchain::TransactionType::STAKE:
-                return {MAKE_ERROR(SUCCESS), Types::Blockchain::committed_stake_transaction_t(reader), block_hash};
-            case Types::Blockchain::TransactionType::RECALL_STAKE:
-                return {
-                    MAKE_ERROR(SUCCESS), Types::Blockchain::committed_recall_stake_transaction_t(reader), block_hash};
-            case Types::Blockchain::TransactionType::STAKE_REFUND:
-                return {MAKE_ERROR(SUCCESS), Types::Blockchain::stake_refund_transaction_t(reader), block_hash};
-            default:
-                return {MAKE_ERROR(UNKNOWN_TRANSACTION_TYPE), {}, block_hash};
+            m_db_env->set_growth_policy(policy);
         }
-    }
 
-    std::tuple<Error, std::vector<uint64_t>>
-        BlockchainStorage::get_transaction_indexes(const crypto_hash_t &txn_hash) const
-    {
-        // go get all of the transaction output global indexes for the specified transaction
-        const auto [error, data] = m_transaction_indexes->get(txn_hash);
+        m_blocks = m_db_env->open_database("blocks");
 
-        if (error)
-        {
-            return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}};
-        }
+        m_block_indexes = m_db_env->open_sequential_database("block_indexes_seq");
 
-        std::vector<uint64_t> result;
+        // blocks sharing a timestamp are kept as duplicates holding their big-endian block indexes
+        m_block_timestamps = m_db_env->open_database(
+            "block_timestamps_ordered", MDB_DUPSORT | MDB_DUPFIXED, Database::KEY_ENCODING_BIG_ENDIAN);
 
-        deserializer_t reader(data);
+        // transactions share most of their structure so they are compressed with a trained dictionary
+        m_transactions = m_db_env->open_database("compressed_transactions");
+
+        m_key_images = m_db_env->open_database("key_images");
+
+        m_global_indexes = m_db_env->open_sequential_database("global_indexes_seq");
+
+        m_transaction_indexes = m_db_env->open_database("transaction_indexes");
+
+        m_transaction_block_hashes = m_db_env->open_database("transaction_block_hashes");
+
+        m_block_headers = m_db_env->open_sequential_database("block_headers_seq");
+
+        m_block_hash_indexes = m_db_env->open_database("block_hash_indexes");
+
+        m_block_undo = m_db_env->open_sequential_database("block_undo_seq");
+
+        m_compression_dictionaries = m_db_env->open_sequential_database("compression_dictionaries");
 
-        // the indexes are stored in a bytestream to save space so we need to read until finished
-        while (reader.unread_bytes() > 0)
         {
-            try
+            const auto error = load_compression_dictionaries();
+
+            if (error)
             {
-                result.push_back(reader.varint<uint64_t>());
+                throw std::runtime_error("Could not load compression dictionaries: " + error.to_string());
             }
-            catch (...)
+        }
+
+        // environments created before the sequential tables existed keep their records in byte-keyed tables
+        for (const auto &[db, legacy_name] :
+             {std::make_pair(m_block_indexes, "block_indexes"), std::make_pair(m_global_indexes, "global_indexes")})
+        {
+            const auto error = migrate_sequential_database(db, legacy_name);
+
+            if (error)
             {
-                return {MAKE_ERROR(DB_DESERIALIZATION_ERROR), {}};
+                throw std::runtime_error("Could not migrate " + std::string(legacy_name) + ": " + error.to_string());
             }
         }
 
-        return {MAKE_ERROR(SUCCESS), result};
-    }
-
-    bool BlockchainStorage::key_image_exists(const crypto_key_image_t &key_image) const
-    {
-        return m_key_images->exists(key_image);
-    }
+        {
+            const auto error = migrate_compressed_database(m_transactions, "transactions");
 
-    std::map<crypto_key_image_t, bool>
-        BlockchainStorage::key_image_exists(const std::vector<crypto_key_image_t> &key_images) const
-    {
-        auto txn = m_key_images->transaction(true);
+            if (error)
+            {
+                throw std::runtime_error("Could not migrate transactions: " + error.to_string());
+            }
+        }
 
-        std::map<crypto_key_image_t, bool> results;
+        maintain_compression_dictionary();
 
-        // loop through the requested key images
-        for (const auto &key_image : key_images)
         {
-            // check to see if the key image exists
-            const auto exists = txn->exists(key_image);
+            const auto error = migrate_block_timestamps();
 
-            results.insert({key_image, exists});
+            if (error)
+            {
+                throw std::runtime_error("Could not migrate block_timestamps: " + error.to_string());
+            }
         }
 
-        return results;
+        {
+            const auto error = migrate_block_headers();
+
+            if (error)
+            {
+                throw std::runtime_error("Could not build block_headers_seq: " + error.to_string());
+            }
+        }
+
+        {
+            const auto error = load_recent_headers();
+
+            if (error)
+            {
+                throw std::runtime_error("Could not load recent block headers: " + error.to_string());
+            }
+        }
+
+        m_key_image_filter_path = db_path + "/key_images.filter";
+
+        load_key_image_filter();
+    }
+
+    BlockchainStorage::~BlockchainStorage()
+    {
+        if (m_key_image_filter_thread.joinable())
+        {
+            m_key_image_filter_thread.join();
+        }
+
+        save_key_image_filter();
+    }
+
+    std::shared_ptr<BlockchainStorage> BlockchainStorage::getInstance(const std::string &db_path, size_t cache_size)
+    {
+        if (!blockchain_storage_instance)
+        {
+            blockchain_storage_instance = std::make_shared<BlockchainStorage>(db_path, cache_size);
+        }
+
+        return blockchain_storage_instance;
+    }
+
+    block_cache_t::stats_t BlockchainStorage::block_cache_stats() const
+    {
+        return m_block_cache.stats();
+    }
+
+    bool BlockchainStorage::block_exists(const crypto_hash_t &block_hash) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return block_exists(db_tx, block_hash);
+    }
+
+    bool BlockchainStorage::block_exists(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const crypto_hash_t &block_hash) const
+    {
+        db_tx->set_database(m_blocks);
+
+        return db_tx->exists(block_hash);
+    }
+
+    bool BlockchainStorage::block_exists(const uint64_t &block_index) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return block_exists(db_tx, block_index);
+    }
+
+    bool BlockchainStorage::block_exists(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &block_index) const
+    {
+        db_tx->set_database(m_block_indexes);
+
+        return db_tx->exists(block_index);
+    }
+
+    std::shared_ptr<Database::LMDB> BlockchainStorage::environment() const
+    {
+        return m_db_env;
+    }
+
+    Error BlockchainStorage::flush(bool force) const
+    {
+        return m_db_env->flush(force);
+    }
+
+    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+        BlockchainStorage::get_block(const crypto_hash_t &block_hash) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block(db_tx, block_hash);
+    }
+
+    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+        BlockchainStorage::get_block(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const crypto_hash_t &block_hash) const
+    {
+        Types::Blockchain::block_t block;
+
+        db_tx->set_database(m_blocks);
+
+        // the caches are shared by every snapshot, so a cached block is only used if it exists within this one
+        const auto cached = m_block_cache.get(block_hash);
+
+        if (cached && db_tx->exists(block_hash))
+        {
+            block = *cached;
+        }
+        else
+        {
+            // go get the block
+            const auto [error, block_data] = db_tx->get_view(block_hash);
+
+            if (error)
+            {
+                return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}, {}};
+            }
+
+            block = block_data.decode<Types::Blockchain::block_t>();
+
+            if (const auto snapshot = cache_snapshot(db_tx))
+            {
+                m_block_cache.insert(block_hash, block, block_data.size());
+
+                // pop_blocks() raises the floor before it erases, so either it erases the block or we do
+                if (*snapshot < m_cache_floor)
+                {
+                    m_block_cache.erase(block_hash);
+                }
+            }
+        }
+
+        std::vector<Types::Blockchain::transaction_t> transactions;
+
+        transactions.reserve(block.transactions.size());
+
+        // loop through the transactions in the block and retrieve them
+        for (const auto &txn : block.transactions)
+        {
+            // retrieve the transaction
+            const auto [txn_error, transaction, txn_block_hash] = get_transaction(db_tx, txn);
+
+            if (txn_error)
+            {
+                return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}, {}};
+            }
+
+            transactions.push_back(transaction);
+        }
+
+        return {MAKE_ERROR(SUCCESS), block, transactions};
+    }
+
+    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+        BlockchainStorage::get_block(const uint64_t &block_index) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block(db_tx, block_index);
+    }
+
+    std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+        BlockchainStorage::get_block(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &block_index) const
+    {
+        // go get the block hash
+        const auto [error, block_hash] = get_block_hash(db_tx, block_index);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}, {}};
+        }
+
+        return get_block(db_tx, block_hash);
+    }
+
+    std::tuple<Error, uint64_t, crypto_hash_t>
+        BlockchainStorage::get_block_by_timestamp(const uint64_t &timestamp) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_by_timestamp(db_tx, timestamp);
+    }
+
+    std::tuple<Error, uint64_t, crypto_hash_t> BlockchainStorage::get_block_by_timestamp(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &timestamp) const
+    {
+        db_tx->set_database(m_block_timestamps);
+
+        auto cursor = db_tx->cursor();
+
+        // go get the next closest (higher) timestamp information, which is the lowest block at that timestamp
+        const auto [error, result_timestamp, value] = cursor->get_view(timestamp, MDB_SET_RANGE);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), 0, {}};
+        }
+
+        const auto block_index = Database::decode_key(value.data(), value.size(), Database::KEY_ENCODING_BIG_ENDIAN);
+
+        const auto [hash_error, block_hash] = get_block_hash(db_tx, block_index);
+
+        if (hash_error)
+        {
+            return {hash_error, 0, {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), result_timestamp, block_hash};
+    }
+
+    size_t BlockchainStorage::get_block_count() const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_count(db_tx);
+    }
+
+    size_t BlockchainStorage::get_block_count(std::unique_ptr<Database::LMDBTransaction> &db_tx) const
+    {
+        db_tx->set_database(m_blocks);
+
+        const auto [error, count] = db_tx->count();
+
+        return count;
+    }
+
+    std::tuple<Error, crypto_hash_t> BlockchainStorage::get_block_hash(const uint64_t &block_index) const
+    {
+        if (const auto header = recent_header(block_index))
+        {
+            return {MAKE_ERROR(SUCCESS), header->block_hash};
+        }
+
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_hash(db_tx, block_index);
+    }
+
+    std::tuple<Error, crypto_hash_t> BlockchainStorage::get_block_hash(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &block_index) const
+    {
+        db_tx->set_database(m_block_indexes);
+
+        // go get the block hash from the indexes
+        const auto [error, block_hash] = db_tx->get<crypto_hash_t>(block_index);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}};
+        }
+
+        return {error, block_hash};
+    }
+
+    std::tuple<Error, std::vector<crypto_hash_t>>
+        BlockchainStorage::get_block_hashes(const uint64_t &first_block_index, const uint64_t &last_block_index) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_hashes(db_tx, first_block_index, last_block_index);
+    }
+
+    std::tuple<Error, std::vector<crypto_hash_t>> BlockchainStorage::get_block_hashes(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &first_block_index,
+        const uint64_t &last_block_index) const
+    {
+        db_tx->set_database(m_block_indexes);
+
+        auto cursor = db_tx->cursor();
+
+        std::vector<crypto_hash_t> results;
+
+        const auto error = cursor->for_each(
+            first_block_index,
+            last_block_index,
+            [&results](const uint64_t &, const Database::LMDBValueView &value)
+            {
+                results.push_back(value.decode<crypto_hash_t>());
+
+                return true;
+            });
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    std::tuple<Error, block_header_t> BlockchainStorage::get_block_header(const crypto_hash_t &block_hash) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        const auto [error, block_index] = get_block_index(db_tx, block_hash);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        if (const auto header = recent_header(block_index))
+        {
+            return {MAKE_ERROR(SUCCESS), *header};
+        }
+
+        return get_block_header(db_tx, block_index);
+    }
+
+    std::tuple<Error, block_header_t> BlockchainStorage::get_block_header(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const crypto_hash_t &block_hash) const
+    {
+        const auto [error, block_index] = get_block_index(db_tx, block_hash);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        return get_block_header(db_tx, block_index);
+    }
+
+    std::tuple<Error, block_header_t> BlockchainStorage::get_block_header(const uint64_t &block_index) const
+    {
+        if (const auto header = recent_header(block_index))
+        {
+            return {MAKE_ERROR(SUCCESS), *header};
+        }
+
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_header(db_tx, block_index);
+    }
+
+    std::tuple<Error, block_header_t> BlockchainStorage::get_block_header(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &block_index) const
+    {
+        db_tx->set_database(m_block_headers);
+
+        const auto [error, header] = db_tx->get<block_header_t>(block_index);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}};
+        }
+
+        return {error, header};
+    }
+
+    std::tuple<Error, std::vector<block_header_t>>
+        BlockchainStorage::get_block_headers(const uint64_t &first_block_index, const uint64_t &last_block_index) const
+    {
+        {
+            std::shared_lock lock(m_recent_headers_mutex);
+
+            if (first_block_index <= last_block_index && first_block_index >= m_recent_headers_first
+                && last_block_index < m_recent_headers_end)
+            {
+                std::vector<block_header_t> results;
+
+                results.reserve(last_block_index - first_block_index + 1);
+
+                for (auto block_index = first_block_index; block_index <= last_block_index; ++block_index)
+                {
+                    results.push_back(m_recent_headers[block_index % m_recent_headers.size()]);
+                }
+
+                return {MAKE_ERROR(SUCCESS), results};
+            }
+        }
+
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_headers(db_tx, first_block_index, last_block_index);
+    }
+
+    std::tuple<Error, std::vector<block_header_t>> BlockchainStorage::get_block_headers(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &first_block_index,
+        const uint64_t &last_block_index) const
+    {
+        db_tx->set_database(m_block_headers);
+
+        auto cursor = db_tx->cursor();
+
+        std::vector<block_header_t> results;
+
+        const auto error = cursor->for_each(
+            first_block_index,
+            last_block_index,
+            [&results](const uint64_t &, const Database::LMDBValueView &value)
+            {
+                results.push_back(value.decode<block_header_t>());
+
+                return true;
+            });
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    std::tuple<Error, uint64_t> BlockchainStorage::get_block_index(const crypto_hash_t &block_hash) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_index(db_tx, block_hash);
+    }
+
+    std::tuple<Error, uint64_t> BlockchainStorage::get_block_index(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const crypto_hash_t &block_hash) const
+    {
+        db_tx->set_database(m_block_hash_indexes);
+
+        const auto [error, value] = db_tx->get_view(block_hash);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), 0};
+        }
+
+        return {error, Database::decode_key(value.data(), value.size(), Database::KEY_ENCODING_NATIVE)};
+    }
+
+    std::tuple<Error, std::vector<std::tuple<uint64_t, uint64_t>>> BlockchainStorage::get_block_indexes_by_timestamp(
+        const uint64_t &first_timestamp,
+        const uint64_t &last_timestamp) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_block_indexes_by_timestamp(db_tx, first_timestamp, last_timestamp);
+    }
+
+    std::tuple<Error, std::vector<std::tuple<uint64_t, uint64_t>>> BlockchainStorage::get_block_indexes_by_timestamp(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &first_timestamp,
+        const uint64_t &last_timestamp) const
+    {
+        db_tx->set_database(m_block_timestamps);
+
+        auto cursor = db_tx->cursor();
+
+        std::vector<std::tuple<uint64_t, uint64_t>> results;
+
+        const auto error = cursor->for_each(
+            first_timestamp,
+            last_timestamp,
+            [&results](const uint64_t &timestamp, const Database::LMDBValueView &value)
+            {
+                results.emplace_back(
+                    timestamp,
+                    Database::decode_key(value.data(), value.size(), Database::KEY_ENCODING_BIG_ENDIAN));
+
+                return true;
+            });
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    std::tuple<Error, uint64_t> BlockchainStorage::get_maximum_global_index() const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_maximum_global_index(db_tx);
+    }
+
+    std::tuple<Error, uint64_t>
+        BlockchainStorage::get_maximum_global_index(std::unique_ptr<Database::LMDBTransaction> &db_tx) const
+    {
+        db_tx->set_database(m_global_indexes);
+
+        const auto [error, count] = db_tx->count();
+
+        if (error)
+        {
+            return {error, 0};
+        }
+
+        if (count == 0)
+        {
+            return {MAKE_ERROR(DB_EMPTY), 0};
+        }
+
+        return {MAKE_ERROR(SUCCESS), count - 1};
+    }
+
+    std::tuple<Error, Types::Blockchain::transaction_output_t>
+        BlockchainStorage::get_output_by_global_index(const uint64_t &global_index) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_output_by_global_index(db_tx, global_index);
+    }
+
+    std::tuple<Error, Types::Blockchain::transaction_output_t> BlockchainStorage::get_output_by_global_index(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &global_index) const
+    {
+        // go get the maximum global index number
+        const auto [error, maximum_global_index] = get_maximum_global_index(db_tx);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        if (global_index > maximum_global_index)
+        {
+            return {MAKE_ERROR(DB_GLOBAL_INDEX_OUT_OF_BOUNDS), {}};
+        }
+
+        db_tx->set_database(m_global_indexes);
+
+        // go get the transaction output for the global index
+        return db_tx->get<Types::Blockchain::transaction_output_t>(global_index);
+    }
+
+    std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
+        BlockchainStorage::get_outputs_by_global_indexes(const std::vector<uint64_t> &global_indexes) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_outputs_by_global_indexes(db_tx, global_indexes);
+    }
+
+    std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
+        BlockchainStorage::get_outputs_by_global_indexes(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const std::vector<uint64_t> &global_indexes) const
+    {
+        const auto [error, outputs] = get_ring_outputs(db_tx, global_indexes);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        std::map<uint64_t, Types::Blockchain::transaction_output_t> results;
+
+        for (size_t i = 0; i < global_indexes.size(); ++i)
+        {
+            results.insert({global_indexes[i], outputs[i]});
+        }
+
+        // if we did not get the same number of results as requested... fail
+        if (results.size() != global_indexes.size())
+        {
+            return {MAKE_ERROR(DB_GLOBAL_INDEX_OUT_OF_BOUNDS), {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    std::tuple<Error, std::vector<Types::Blockchain::transaction_output_t>>
+        BlockchainStorage::get_ring_outputs(const std::vector<uint64_t> &global_indexes) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_ring_outputs(db_tx, global_indexes);
+    }
+
+    std::tuple<Error, std::vector<Types::Blockchain::transaction_output_t>> BlockchainStorage::get_ring_outputs(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const std::vector<uint64_t> &global_indexes) const
+    {
+        auto [error, results] = get_ring_outputs(db_tx, std::vector<std::vector<uint64_t>> {global_indexes});
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        return {error, std::move(results.front())};
+    }
+
+    std::tuple<Error, std::vector<std::vector<Types::Blockchain::transaction_output_t>>>
+        BlockchainStorage::get_ring_outputs(const std::vector<std::vector<uint64_t>> &rings) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_ring_outputs(db_tx, rings);
+    }
+
+    std::tuple<Error, std::vector<std::vector<Types::Blockchain::transaction_output_t>>>
+        BlockchainStorage::get_ring_outputs(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const std::vector<std::vector<uint64_t>> &rings) const
+    {
+        // merge all of the requested global indexes into a single sorted list without duplicates
+        std::vector<uint64_t> indexes;
+
+        for (const auto &ring : rings)
+        {
+            indexes.insert(indexes.end(), ring.begin(), ring.end());
+        }
+
+        std::sort(indexes.begin(), indexes.end());
+
+        indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+
+        std::vector<Types::Blockchain::transaction_output_t> outputs(indexes.size());
+
+        if (!indexes.empty())
+        {
+            // the maximum global index only needs to be checked against the largest index requested
+            {
+                const auto [error, maximum_global_index] = get_maximum_global_index(db_tx);
+
+                if (error)
+                {
+                    return {error, {}};
+                }
+
+                if (indexes.back() > maximum_global_index)
+                {
+                    return {MAKE_ERROR(DB_GLOBAL_INDEX_OUT_OF_BOUNDS), {}};
+                }
+            }
+
+            db_tx->set_database(m_global_indexes);
+
+            /**
+             * The table is integer keyed, so the sorted indexes are already in the order the database
+             * stores them and the cursor only ever moves forward through the tree. Runs of consecutive
+             * indexes are stepped with MDB_NEXT and any gap is crossed with a single MDB_SET_RANGE seek.
+             */
+            auto cursor = db_tx->cursor();
+
+            for (size_t i = 0; i < indexes.size(); ++i)
+            {
+                const auto op = (i != 0 && indexes[i] == indexes[i - 1] + 1) ? MDB_NEXT : MDB_SET_RANGE;
+
+                const auto [error, key, output] = cursor->get<Types::Blockchain::transaction_output_t>(indexes[i], op);
+
+                if (error == LMDB_NOTFOUND || (!error && key != indexes[i]))
+                {
+                    return {MAKE_ERROR(DB_GLOBAL_INDEX_OUT_OF_BOUNDS), {}};
+                }
+
+                if (error)
+                {
+                    return {error, {}};
+                }
+
+                outputs[i] = output;
+            }
+        }
+
+        // lay the results back out in the same shape and order as the requests
+        std::vector<std::vector<Types::Blockchain::transaction_output_t>> results;
+
+        results.reserve(rings.size());
+
+        for (const auto &ring : rings)
+        {
+            std::vector<Types::Blockchain::transaction_output_t> ring_outputs;
+
+            ring_outputs.reserve(ring.size());
+
+            for (const auto &index : ring)
+            {
+                const auto position = std::lower_bound(indexes.begin(), indexes.end(), index) - indexes.begin();
+
+                ring_outputs.push_back(outputs[position]);
+            }
+
+            results.push_back(std::move(ring_outputs));
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t>
+        BlockchainStorage::get_transaction(const crypto_hash_t &txn_hash) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_transaction(db_tx, txn_hash);
+    }
+
+    std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t> BlockchainStorage::get_transaction(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const crypto_hash_t &txn_hash,
+        bool use_cache) const
+    {
+        /**
+         * The caches are shared by every snapshot, so a cached transaction is only used if this snapshot
+         * holds it within the same block (it may have been popped and included again in another block)
+         */
+        if (const auto cached = (use_cache) ? m_transaction_cache.get(txn_hash) : std::nullopt)
+        {
+            const auto &[transaction, block_hash] = *cached;
+
+            db_tx->set_database(m_transaction_block_hashes);
+
+            const auto [error, stored_block_hash] = db_tx->get<crypto_hash_t, crypto_hash_t>(txn_hash);
+
+            if (!error && stored_block_hash == block_hash)
+            {
+                return {MAKE_ERROR(SUCCESS), transaction, block_hash};
+            }
+        }
+
+        db_tx->set_database(m_transactions);
+
+        // go get a view of the transaction, it is only copied out of the map by the deserializer below
+        const auto [error, txn_data] = db_tx->get_view(txn_hash);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}, {}};
+        }
+
+        db_tx->set_database(m_transaction_block_hashes);
+
+        // go get the block hash the transaction is contained within
+        const auto [txn_error, block_hash] = db_tx->get<crypto_hash_t, crypto_hash_t>(txn_hash);
+
+        if (txn_error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}, {}};
+        }
+
+        auto reader = txn_data.reader();
+
+        // figure out what type of transaction it is
+        const auto type = reader.varint<uint64_t>(true);
+
+        Types::Blockchain::transaction_t transaction;
+
+        // depending on the transaction type, we'll return the proper structure
+        switch (type)
+        {
+            case Types::Blockchain::TransactionType::GENESIS:
+                transaction = Types::Blockchain::genesis_transaction_t(reader);
+                break;
+            case Types::Blockchain::TransactionType::STAKER_REWARD:
+                transaction = Types::Blockchain::staker_reward_transaction_t(reader);
+                break;
+            case Types::Blockchain::TransactionType::NORMAL:
+                transaction = Types::Blockchain::committed_normal_transaction_t(reader);
+                break;
+            case Types::Blockchain::TransactionType::STAKE:
+                transaction = Types::Blockchain::committed_stake_transaction_t(reader);
+                break;
+            case Types::Blockchain::TransactionType::RECALL_STAKE:
+                transaction = Types::Blockchain::committed_recall_stake_transaction_t(reader);
+                break;
+            case Types::Blockchain::TransactionType::STAKE_REFUND:
+                transaction = Types::Blockchain::stake_refund_transaction_t(reader);
+                break;
+            default:
+                return {MAKE_ERROR(UNKNOWN_TRANSACTION_TYPE), {}, block_hash};
+        }
+
+        const auto snapshot = (use_cache) ? cache_snapshot(db_tx) : std::nullopt;
+
+        if (snapshot)
+        {
+            m_transaction_cache.insert(txn_hash, {transaction, block_hash}, txn_data.size());
+
+            // pop_blocks() raises the floor before it erases, so either it erases the transaction or we do
+            if (*snapshot < m_cache_floor)
+            {
+                m_transaction_cache.erase(txn_hash);
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), transaction, block_hash};
+    }
+
+    std::tuple<Error, std::vector<uint64_t>>
+        BlockchainStorage::get_transaction_indexes(const crypto_hash_t &txn_hash) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_transaction_indexes(db_tx, txn_hash);
+    }
+
+    std::tuple<Error, std::vector<uint64_t>> BlockchainStorage::get_transaction_indexes(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const crypto_hash_t &txn_hash) const
+    {
+        db_tx->set_database(m_transaction_indexes);
+
+        // go get all of the transaction output global indexes for the specified transaction
+        const auto [error, data] = db_tx->get_view(txn_hash);
+
+        if (error)
+        {
+            return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}};
+        }
+
+        std::vector<uint64_t> result;
+
+        auto reader = data.reader();
+
+        // the indexes are stored in a bytestream to save space so we need to read until finished
+        while (reader.unread_bytes() > 0)
+        {
+            try
+            {
+                result.push_back(reader.varint<uint64_t>());
+            }
+            catch (...)
+            {
+                return {MAKE_ERROR(DB_DESERIALIZATION_ERROR), {}};
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), result};
+    }
+
+    std::tuple<Error, std::vector<wallet_sync_block_t>> BlockchainStorage::get_wallet_sync_data(
+        const uint64_t &start_height,
+        const uint64_t &count,
+        size_t maximum_bytes) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return get_wallet_sync_data(db_tx, start_height, count, maximum_bytes);
+    }
+
+    std::tuple<Error, std::vector<wallet_sync_block_t>> BlockchainStorage::get_wallet_sync_data(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &start_height,
+        const uint64_t &count,
+        size_t maximum_bytes) const
+    {
+        const auto block_count = get_block_count(db_tx);
+
+        if (start_height >= block_count)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}};
+        }
+
+        const auto end_height = start_height + std::min<uint64_t>(count, block_count - start_height);
+
+        std::vector<wallet_sync_block_t> results;
+
+        size_t total_bytes = 0;
+
+        try
+        {
+            // the budget is checked once a block has been added so that at least one block is always returned
+            for (auto block_index = start_height;
+                 block_index < end_height && (results.empty() || total_bytes < maximum_bytes);
+                 ++block_index)
+            {
+                wallet_sync_block_t record;
+
+                record.block_index = block_index;
+
+                std::vector<crypto_hash_t> transaction_hashes;
+
+                std::optional<uint64_t> next_global_index;
+
+                db_tx->set_database(m_block_undo);
+
+                const auto [undo_error, undo_data] = db_tx->get_view(block_index);
+
+                if (!undo_error)
+                {
+                    // the undo record lists the transactions of the block (reward transaction first) and where
+                    // the run of global indexes given to the block starts, so the block itself is not decoded
+                    const auto undo = undo_data.decode<block_undo_t>();
+
+                    record.block_hash = undo.block_hash;
+
+                    record.timestamp = undo.timestamp;
+
+                    transaction_hashes = undo.transactions;
+
+                    next_global_index = undo.first_global_index;
+                }
+                else
+                {
+                    // blocks stored before undo records existed do not have one
+                    const auto [hash_error, block_hash] = get_block_hash(db_tx, block_index);
+
+                    if (hash_error)
+                    {
+                        return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}};
+                    }
+
+                    db_tx->set_database(m_blocks);
+
+                    const auto [block_error, block] = db_tx->get<crypto_hash_t, Types::Blockchain::block_t>(block_hash);
+
+                    if (block_error)
+                    {
+                        return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), {}};
+                    }
+
+                    record.block_hash = block_hash;
+
+                    record.timestamp = block.timestamp;
+
+                    transaction_hashes = block.transactions;
+
+                    transaction_hashes.insert(
+                        transaction_hashes.begin(), std::visit([](auto &&arg) { return arg.hash(); }, block.reward_tx));
+                }
+
+                for (const auto &txn_hash : transaction_hashes)
+                {
+                    wallet_sync_transaction_t transaction;
+
+                    transaction.txn_hash = txn_hash;
+
+                    {
+                        db_tx->set_database(m_transactions);
+
+                        const auto [txn_error, txn_data] = db_tx->get_view(txn_hash);
+
+                        if (txn_error)
+                        {
+                            return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}};
+                        }
+
+                        auto reader = txn_data.reader();
+
+                        // only the public key and the outputs are decoded, the rest of the transaction is skipped
+                        const auto partial = Types::Blockchain::transaction_outputs_t(reader);
+
+                        if (!partial.indexed() || partial.outputs.empty())
+                        {
+                            continue;
+                        }
+
+                        transaction.tx_public_key = partial.tx_public_key;
+
+                        for (const auto &output : partial.outputs)
+                        {
+                            wallet_sync_output_t sync_output;
+
+                            sync_output.public_ephemeral = output.public_ephemeral;
+
+                            sync_output.commitment = output.commitment;
+
+                            transaction.outputs.push_back(sync_output);
+                        }
+                    }
+
+                    if (next_global_index)
+                    {
+                        for (auto &output : transaction.outputs)
+                        {
+                            output.global_index = (*next_global_index)++;
+                        }
+                    }
+                    else
+                    {
+                        const auto [index_error, indexes] = get_transaction_indexes(db_tx, txn_hash);
+
+                        if (index_error || indexes.size() != transaction.outputs.size())
+                        {
+                            return {MAKE_ERROR(DB_TRANSACTION_NOT_FOUND), {}};
+                        }
+
+                        for (size_t i = 0; i < indexes.size(); ++i)
+                        {
+                            transaction.outputs[i].global_index = indexes[i];
+                        }
+                    }
+
+                    record.transactions.push_back(std::move(transaction));
+                }
+
+                total_bytes += record.size();
+
+                results.push_back(std::move(record));
+            }
+        }
+        catch (...)
+        {
+            return {MAKE_ERROR(DB_DESERIALIZATION_ERROR), {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    bool BlockchainStorage::key_image_exists(const crypto_key_image_t &key_image) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return key_image_exists(db_tx, key_image);
+    }
+
+    bool BlockchainStorage::key_image_exists(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const crypto_key_image_t &key_image) const
+    {
+        // the filter never reports a false negative so if it has not seen the key image, neither has the database
+        if (m_key_image_filter_valid && !m_key_image_filter.contains(key_image))
+        {
+            return false;
+        }
+
+        db_tx->set_database(m_key_images);
+
+        return db_tx->exists(key_image);
+    }
+
+    std::map<crypto_key_image_t, bool>
+        BlockchainStorage::key_image_exists(const std::vector<crypto_key_image_t> &key_images) const
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        return key_image_exists(db_tx, key_images);
+    }
+
+    std::map<crypto_key_image_t, bool> BlockchainStorage::key_image_exists(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const std::vector<crypto_key_image_t> &key_images) const
+    {
+        db_tx->set_database(m_key_images);
+
+        std::map<crypto_key_image_t, bool> results;
+
+        const bool filter_valid = m_key_image_filter_valid;
+
+        // loop through the requested key images
+        for (const auto &key_image : key_images)
+        {
+            // only the key images that the filter may have seen need to be checked in the database
+            const auto exists =
+                (!filter_valid || m_key_image_filter.contains(key_image)) ? db_tx->exists(key_image) : false;
+
+            results.insert({key_image, exists});
+        }
+
+        return results;
+    }
+
+    std::optional<size_t> BlockchainStorage::cache_snapshot(std::unique_ptr<Database::LMDBTransaction> &db_tx) const
+    {
+        // what a write transaction reads has not been committed (and may never be)
+        if (!db_tx->readonly())
+        {
+            return std::nullopt;
+        }
+
+        const auto [error, snapshot] = db_tx->id();
+
+        if (error || snapshot < m_cache_floor)
+        {
+            return std::nullopt;
+        }
+
+        return snapshot;
+    }
+
+    void BlockchainStorage::cache_committed(const pending_cache_entries_t &cache_entries)
+    {
+        for (const auto &[block_hash, block, size] : cache_entries.blocks)
+        {
+            m_block_cache.insert(block_hash, block, size);
+        }
+
+        for (const auto &[txn_hash, transaction, block_hash, size] : cache_entries.transactions)
+        {
+            m_transaction_cache.insert(txn_hash, {transaction, block_hash}, size);
+        }
+
+        remember_headers(cache_entries.headers);
+    }
+
+    Error BlockchainStorage::check_block_transactions(
+        const Types::Blockchain::block_t &block,
+        const std::vector<Types::Blockchain::transaction_t> &transactions)
+    {
+        // verify that the number of transactions match what is expected
+        if (transactions.size() != block.transactions.size())
+        {
+            return MAKE_ERROR(BLOCK_TXN_MISMATCH);
+        }
+
+        // dump the transaction hashes into two vectors so that we can easily compare them
+        std::vector<crypto_hash_t> block_tx_hashes, txn_hashes;
+
+        for (const auto &tx : block.transactions)
+        {
+            block_tx_hashes.push_back(tx);
+        }
+
+        for (const auto &tx : transactions)
+        {
+            std::visit([&txn_hashes](auto &&arg) { txn_hashes.push_back(arg.hash()); }, tx);
+        }
+
+        // hash the vectors to get a result that we can match against
+        const auto block_hashes = Crypto::Hashing::sha3(block_tx_hashes);
+
+        const auto tx_hashes = Crypto::Hashing::sha3(txn_hashes);
+
+        /**
+         * Compare the resulting hashes and if they do not match, then kick back out.
+         * The reason that we do this is that it guarantees that the order of the transactions
+         * are processed in is the same at each node so that the global indexes match across
+         * multiple nodes
+         */
+        if (block_hashes != tx_hashes)
+        {
+            return MAKE_ERROR(BLOCK_TXN_ORDER);
+        }
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    Error BlockchainStorage::load_compression_dictionaries()
+    {
+        auto db_tx = m_compression_dictionaries->transaction(true);
+
+        const auto [error, count] = db_tx->count();
+
+        if (error)
+        {
+            return error;
+        }
+
+        /**
+         * Values are always tagged, so the empty dictionary is used until one has been trained. It is
+         * registered even once dictionaries have been trained as the values written before the first
+         * dictionary was trained remain tagged with it.
+         */
+        {
+            const auto set_error = m_transactions->set_compression(
+                std::make_shared<Database::CompressionDictionary>(0, std::vector<uint8_t>()));
+
+            if (set_error || count == 0)
+            {
+                return set_error;
+            }
+        }
+
+        for (uint64_t id = 1; id <= count; ++id)
+        {
+            const auto [get_error, data] = db_tx->get<std::vector<uint8_t>>(id);
+
+            if (get_error)
+            {
+                return get_error;
+            }
+
+            const auto set_error =
+                m_transactions->set_compression(std::make_shared<Database::CompressionDictionary>(id, data));
+
+            if (set_error)
+            {
+                return set_error;
+            }
+        }
+
+        m_transaction_dictionary_trained = true;
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    void BlockchainStorage::load_key_image_filter()
+    {
+        const auto key_image_count = m_key_images->count();
+
+        const auto [info_error, info] = m_db_env->info();
+
+        if (!info_error
+            && !m_key_image_filter.load(m_key_image_filter_path, info.me_last_txnid, key_image_count))
+        {
+            /**
+             * The saved filter is only valid for the exact state of the database it was saved with, so we
+             * remove it now that it is loaded. If we do not shut down cleanly, it will be rebuilt instead.
+             */
+            std::remove(m_key_image_filter_path.c_str());
+
+            m_key_image_filter_valid = true;
+
+            return;
+        }
+
+        // leave room to grow so that the filter is not immediately rebuilt again
+        const auto error = m_key_image_filter.rebuild(
+            m_key_images,
+            std::max(Configuration::Database::KEY_IMAGE_FILTER_MINIMUM_CAPACITY, key_image_count * 2));
+
+        m_key_image_filter_valid = !error;
+    }
+
+    Error BlockchainStorage::load_recent_headers()
+    {
+        auto db_tx = m_db_env->transaction(true);
+
+        db_tx->set_database(m_block_headers);
+
+        const auto [count_error, count] = db_tx->count();
+
+        if (count_error)
+        {
+            return count_error;
+        }
+
+        if (count == 0)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        const auto first_block_index = (count > m_recent_headers.size()) ? count - m_recent_headers.size() : 0;
+
+        const auto [error, headers] = get_block_headers(db_tx, first_block_index, count - 1);
+
+        if (error)
+        {
+            return error;
+        }
+
+        remember_headers(headers);
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    void BlockchainStorage::maintain_compression_dictionary()
+    {
+        if (m_transaction_dictionary_trained
+            || m_transactions->count() < Configuration::Database::COMPRESSION_TRAINING_SAMPLES)
+        {
+            return;
+        }
+
+        // should training fail, the transactions remain readable and training is retried after the next block
+        [[maybe_unused]] const auto error = train_dictionary(m_transactions);
+    }
+
+    void BlockchainStorage::maintain_key_image_filter()
+    {
+        if (!m_key_image_filter.saturated() || m_key_image_filter_rebuilding)
+        {
+            return;
+        }
+
+        if (m_key_image_filter_thread.joinable())
+        {
+            m_key_image_filter_thread.join();
+        }
+
+        m_key_image_filter_rebuilding = true;
+
+        // no key image is waiting to commit under the write mutex, so every one inserted from here on is replayed
+        m_key_image_filter.begin_rebuild();
+
+        const auto capacity = m_key_images->count() * 2;
+
+        // the saturated filter keeps answering lookups (with more false positives) until the new one is swapped in
+        m_key_image_filter_thread = std::thread(
+            [this, capacity]()
+            {
+                // should the rebuild fail, the current filter is kept and the rebuild is retried after the next block
+                [[maybe_unused]] const auto error = m_key_image_filter.rebuild(m_key_images, capacity);
+
+                m_key_image_filter_rebuilding = false;
+            });
+    }
+
+    Database::LMDB::growth_stats_t BlockchainStorage::map_growth_stats() const
+    {
+        return m_db_env->growth_stats();
+    }
+
+    Error BlockchainStorage::migrate_block_headers()
+    {
+        {
+            auto db_tx = m_db_env->transaction(true);
+
+            db_tx->set_database(m_block_indexes);
+
+            const auto [block_error, block_count] = db_tx->count();
+
+            if (block_error)
+            {
+                return block_error;
+            }
+
+            db_tx->set_database(m_block_headers);
+
+            const auto [header_error, header_count] = db_tx->count();
+
+            if (header_error)
+            {
+                return header_error;
+            }
+
+            if (header_count == block_count)
+            {
+                return MAKE_ERROR(SUCCESS);
+            }
+        }
+
+        // discard anything left behind by a previously interrupted migration
+        for (const auto &db : {m_block_headers, m_block_hash_indexes})
+        {
+            const auto error = db->drop(false);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        uint64_t next_block_index = 0;
+
+        bool complete = false;
+
+        while (!complete)
+        {
+        try_again:
+
+            auto db_tx = m_db_env->transaction();
+
+            uint64_t block_index = next_block_index;
+
+            for (size_t copied = 0; copied < Configuration::Database::MIGRATION_RECORDS_PER_WRITE_TRANSACTION;
+                 ++copied, ++block_index)
+            {
+                db_tx->set_database(m_block_indexes);
+
+                const auto [hash_error, block_hash] = db_tx->get<crypto_hash_t>(block_index);
+
+                if (hash_error == LMDB_NOTFOUND)
+                {
+                    complete = true;
+
+                    break;
+                }
+                else if (hash_error)
+                {
+                    return hash_error;
+                }
+
+                db_tx->set_database(m_blocks);
+
+                const auto [block_error, block] = db_tx->get<crypto_hash_t, Types::Blockchain::block_t>(block_hash);
+
+                if (block_error)
+                {
+                    return block_error;
+                }
+
+                db_tx->set_database(m_block_headers);
+
+                auto error = db_tx->append(block_index, block_header_t(block, block_hash).serialize());
+
+                MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+                if (error)
+                {
+                    return error;
+                }
+
+                db_tx->set_database(m_block_hash_indexes);
+
+                error = db_tx->put(block_hash, Database::encode_key_bytes(block_index, Database::KEY_ENCODING_NATIVE));
+
+                MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+                if (error)
+                {
+                    return error;
+                }
+            }
+
+            const auto error = db_tx->commit();
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+
+            next_block_index = block_index;
+        }
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    Error BlockchainStorage::migrate_block_timestamps()
+    {
+        if (!m_db_env->has_database("block_timestamps"))
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        auto legacy_db = m_db_env->open_database("block_timestamps");
+
+        // discard anything left behind by a previously interrupted migration
+        auto error = m_block_timestamps->drop(false);
+
+        if (error)
+        {
+            return error;
+        }
+
+        uint64_t next_block_index = 0;
+
+        bool complete = false;
+
+        while (!complete)
+        {
+        try_again:
+
+            auto db_tx = m_db_env->transaction();
+
+            uint64_t block_index = next_block_index;
+
+            for (size_t copied = 0; copied < Configuration::Database::MIGRATION_RECORDS_PER_WRITE_TRANSACTION;
+                 ++copied, ++block_index)
+            {
+                db_tx->set_database(m_block_indexes);
+
+                const auto [hash_error, block_hash] = db_tx->get<crypto_hash_t>(block_index);
+
+                if (hash_error == LMDB_NOTFOUND)
+                {
+                    complete = true;
+
+                    break;
+                }
+                else if (hash_error)
+                {
+                    return hash_error;
+                }
+
+                db_tx->set_database(m_blocks);
+
+                const auto [block_error, block] = db_tx->get<crypto_hash_t, Types::Blockchain::block_t>(block_hash);
+
+                if (block_error)
+                {
+                    return block_error;
+                }
+
+                db_tx->set_database(m_block_timestamps);
+
+                error = db_tx->put(
+                    block.timestamp, Database::encode_key_bytes(block_index, Database::KEY_ENCODING_BIG_ENDIAN));
+
+                MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+                if (error)
+                {
+                    return error;
+                }
+            }
+
+            error = db_tx->commit();
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+
+            next_block_index = block_index;
+        }
+
+        return legacy_db->drop(true);
+    }
+
+    Error BlockchainStorage::migrate_compressed_database(
+        const std::shared_ptr<Database::LMDBDatabase> &db,
+        const std::string &legacy_name)
+    {
+        if (!m_db_env->has_database(legacy_name))
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        auto legacy_db = m_db_env->open_database(legacy_name);
+
+        // training from the legacy records lets the migrated records be compressed with a trained dictionary
+        if (!m_transaction_dictionary_trained
+            && legacy_db->count() >= Configuration::Database::COMPRESSION_TRAINING_SAMPLES)
+        {
+            const auto error = train_dictionary(legacy_db);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        return migrate_database(
+            legacy_db,
+            db,
+            [](std::unique_ptr<Database::LMDBTransaction> &db_tx,
+               const Database::LMDBValueView &key,
+               const Database::LMDBValueView &value) { return db_tx->put(key, value); });
+    }
+
+    Error BlockchainStorage::migrate_database(
+        const std::shared_ptr<Database::LMDBDatabase> &legacy_db,
+        const std::shared_ptr<Database::LMDBDatabase> &db,
+        const migrate_record_t &put_record)
+    {
+        // discard anything left behind by a previously interrupted migration
+        auto error = db->drop(false);
+
+        if (error)
+        {
+            return error;
+        }
+
+        /**
+         * The legacy keys are compared byte-wise and may not be in the order of the destination
+         * table, so records cannot be appended; we track our position in the legacy table by the
+         * last key copied instead
+         */
+        std::vector<uint8_t> last_key;
+
+        bool complete = false;
+
+        while (!complete)
+        {
+        try_again:
+
+            auto db_tx = m_db_env->transaction();
+
+            db_tx->set_database(legacy_db);
+
+            auto cursor = db_tx->cursor();
+
+            db_tx->set_database(db);
+
+            Error cursor_error;
+
+            Database::LMDBValueView key, value;
+
+            if (last_key.empty())
+            {
+                std::tie(cursor_error, key, value) = cursor->get_view(MDB_FIRST);
+            }
+            else
+            {
+                // the cursor lands on the last key we copied, so step past it
+                std::tie(cursor_error, key, value) = cursor->get_view(last_key, MDB_SET_RANGE);
+
+                if (!cursor_error)
+                {
+                    std::tie(cursor_error, key, value) = cursor->get_view(MDB_NEXT);
+                }
+            }
+
+            std::vector<uint8_t> batch_last_key = last_key;
+
+            for (size_t copied = 0;
+                 !cursor_error && copied < Configuration::Database::MIGRATION_RECORDS_PER_WRITE_TRANSACTION;
+                 ++copied)
+            {
+                error = put_record(db_tx, key, value);
+
+                MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+                if (error)
+                {
+                    return error;
+                }
+
+                batch_last_key = key.to_vector();
+
+                std::tie(cursor_error, key, value) = cursor->get_view(MDB_NEXT);
+            }
+
+            if (cursor_error && cursor_error != LMDB_NOTFOUND)
+            {
+                return cursor_error;
+            }
+
+            complete = cursor_error == LMDB_NOTFOUND;
+
+            error = db_tx->commit();
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+
+            last_key = batch_last_key;
+        }
+
+        return legacy_db->drop(true);
+    }
+
+    Error BlockchainStorage::migrate_sequential_database(
+        const std::shared_ptr<Database::LMDBDatabase> &db,
+        const std::string &legacy_name)
+    {
+        if (!m_db_env->has_database(legacy_name))
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        // the legacy keys are little-endian encoded integers that are re-keyed as native integers
+        return migrate_database(
+            m_db_env->open_database(legacy_name),
+            db,
+            [](std::unique_ptr<Database::LMDBTransaction> &db_tx,
+               const Database::LMDBValueView &key,
+               const Database::LMDBValueView &value) -> Error
+            {
+                if (key.size() != sizeof(uint64_t))
+                {
+                    return MAKE_ERROR_MSG(LMDB_BAD_VALSIZE, "Legacy table contains a key that is not an integer");
+                }
+
+                uint64_t index;
+
+                std::memcpy(&index, key.data(), sizeof(index));
+
+                return db_tx->put(index, value);
+            });
+    }
+
+    std::tuple<Error, BlockchainStorage::block_undo_t> BlockchainStorage::pop_block(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &block_index)
+    {
+        block_undo_t undo;
+
+        {
+            db_tx->set_database(m_block_undo);
+
+            const auto [error, value] = db_tx->get_view(block_index);
+
+            if (error == LMDB_NOTFOUND)
+            {
+                return {MAKE_ERROR(DB_BLOCK_UNDO_NOT_FOUND), {}};
+            }
+            else if (error)
+            {
+                return {error, {}};
+            }
+
+            undo = value.decode<block_undo_t>();
+        }
+
+        // records that a block may legitimately not have added are simply skipped
+        const auto check = [](const Error &error) { return (error == LMDB_NOTFOUND) ? MAKE_ERROR(SUCCESS) : error; };
+
+        db_tx->set_database(m_key_images);
+
+        for (const auto &key_image : undo.key_images)
+        {
+            const auto error = check(db_tx->del(key_image));
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        for (const auto &txn_hash : undo.transactions)
+        {
+            for (const auto &db : {m_transactions, m_transaction_indexes, m_transaction_block_hashes})
+            {
+                db_tx->set_database(db);
+
+                const auto error = check(db_tx->del(txn_hash));
+
+                if (error)
+                {
+                    return {error, {}};
+                }
+            }
+        }
+
+        // outputs are removed from the end of the table, which winds the next global index back with them
+        db_tx->set_database(m_global_indexes);
+
+        for (uint64_t i = undo.output_count; i > 0; --i)
+        {
+            const auto error = db_tx->del(undo.first_global_index + i - 1);
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        {
+            db_tx->set_database(m_block_timestamps);
+
+            const auto error = check(db_tx->del(
+                undo.timestamp, Database::encode_key_bytes(block_index, Database::KEY_ENCODING_BIG_ENDIAN)));
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        for (const auto &db : {m_blocks, m_block_hash_indexes})
+        {
+            db_tx->set_database(db);
+
+            const auto error = check(db_tx->del(undo.block_hash));
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        for (const auto &db : {m_block_indexes, m_block_headers, m_block_undo})
+        {
+            db_tx->set_database(db);
+
+            const auto error = check(db_tx->del(block_index));
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), undo};
+    }
+
+    Error BlockchainStorage::pop_blocks(size_t count)
+    {
+        if (count == 0)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        std::scoped_lock lock(write_mutex);
+
+        std::vector<block_undo_t> removed;
+
+        uint64_t block_count = 0;
+
+    try_again:
+
+        removed.clear();
+
+        auto db_tx = m_db_env->transaction();
+
+        {
+            db_tx->set_database(m_block_indexes);
+
+            const auto [error, stored] = db_tx->count();
+
+            if (error)
+            {
+                return error;
+            }
+
+            if (count > stored)
+            {
+                return MAKE_ERROR(DB_POP_TOO_MANY_BLOCKS);
+            }
+
+            block_count = stored;
+        }
+
+        for (uint64_t block_index = block_count; block_index > block_count - count; --block_index)
+        {
+            auto [error, undo] = pop_block(db_tx, block_index - 1);
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+
+            removed.push_back(std::move(undo));
+        }
+
+        // the snapshots taken once this write transaction commits are the first without the removed blocks
+        const auto [id_error, popped_snapshot] = db_tx->id();
+
+        if (id_error)
+        {
+            return id_error;
+        }
+
+        auto error = db_tx->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+        if (error)
+        {
+            return error;
+        }
+
+        // readers holding older snapshots may no longer add to the caches, which must happen before they are erased
+        m_cache_floor = popped_snapshot;
+
+        /**
+         * The removed blocks and transactions must not be served from memory any longer. The key
+         * images stay in the key image filter, which only costs a database lookup if they are seen
+         * again as the filter never claims that a key image is absent when it is not.
+         */
+        for (const auto &undo : removed)
+        {
+            m_block_cache.erase(undo.block_hash);
+
+            for (const auto &txn_hash : undo.transactions)
+            {
+                m_transaction_cache.erase(txn_hash);
+            }
+        }
+
+        forget_headers(block_count - count);
+
+        return MAKE_ERROR(SUCCESS);
     }
 
     Error BlockchainStorage::put_block(
@@ -310,113 +2304,331 @@ namespace Core
          * Sanity check transaction order before write
          */
         {
-            // verify that the number of transactions match what is expected
-            if (transactions.size() != block.transactions.size())
-            {
-                return MAKE_ERROR(BLOCK_TXN_MISMATCH);
-            }
+            const auto error = check_block_transactions(block, transactions);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        std::scoped_lock lock(write_mutex);
+
+        const auto block_hash = block.hash();
+
+    try_again:
+
+        auto db_tx = m_db_env->transaction();
+
+        uint64_t global_index = 0;
+
+        pending_cache_entries_t cache_entries;
+
+        // the next global index is the number of outputs already stored
+        {
+            db_tx->set_database(m_global_indexes);
+
+            const auto [error, count] = db_tx->count();
+
+            if (error)
+            {
+                return error;
+            }
+
+            global_index = count;
+        }
+
+        {
+            auto error = put_block(db_tx, block, block_hash, transactions, global_index, cache_entries);
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        auto error = db_tx->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+        if (!error)
+        {
+            cache_committed(cache_entries);
+
+            maintain_key_image_filter();
+
+            maintain_compression_dictionary();
+
+            // growing the memory map now keeps the next write transaction from running out of room
+            m_db_env->maintain_map_size();
+        }
+
+        return error;
+    }
+
+    Error BlockchainStorage::put_block(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const Types::Blockchain::block_t &block,
+        const crypto_hash_t &block_hash,
+        const std::vector<Types::Blockchain::transaction_t> &transactions,
+        uint64_t &global_index,
+        pending_cache_entries_t &cache_entries)
+    {
+        // the block indexes are appended, so a block that does not follow the last stored block would leave a gap
+        {
+            db_tx->set_database(m_block_indexes);
+
+            const auto [error, count] = db_tx->count();
+
+            if (error)
+            {
+                return error;
+            }
+
+            if (block.block_index != count)
+            {
+                return MAKE_ERROR(DB_BLOCK_INDEX_NOT_NEXT);
+            }
+        }
+
+        block_undo_t undo;
+
+        undo.block_hash = block_hash;
+
+        undo.timestamp = block.timestamp;
+
+        undo.first_global_index = global_index;
+
+        // Push the block reward transaction into the database
+        {
+            const auto reward_tx = std::visit(
+                [](auto &&arg) { return Types::Blockchain::transaction_t(arg); }, block.reward_tx);
+
+            auto [error, txn_hash, txn_size] = put_transaction(db_tx, reward_tx, global_index);
+
+            if (error)
+            {
+                return error;
+            }
+
+            auto txn_error = put_transaction_block_hash(db_tx, txn_hash, block_hash);
+
+            if (txn_error)
+            {
+                return txn_error;
+            }
+
+            cache_entries.transactions.emplace_back(txn_hash, reward_tx, block_hash, txn_size);
+
+            undo.transactions.push_back(txn_hash);
+        }
+
+        // loop through the individual transactions in the block and push them into the database
+        for (const auto &transaction : transactions)
+        {
+            auto [error, txn_hash, txn_size] = put_transaction(db_tx, transaction, global_index);
+
+            if (error)
+            {
+                return error;
+            }
+
+            auto txn_error = put_transaction_block_hash(db_tx, txn_hash, block_hash);
+
+            if (txn_error)
+            {
+                return txn_error;
+            }
+
+            cache_entries.transactions.emplace_back(txn_hash, transaction, block_hash, txn_size);
+
+            undo.transactions.push_back(txn_hash);
+
+            for (const auto &key_image : transaction_key_images(transaction))
+            {
+                undo.key_images.push_back(key_image);
+            }
+        }
+
+        // push the block itself into the database
+        {
+            db_tx->set_database(m_blocks);
+
+            const auto block_data = block.serialize();
+
+            auto error = db_tx->put(block_hash, block_data);
+
+            if (error)
+            {
+                return error;
+            }
+
+            cache_entries.blocks.emplace_back(block_hash, block, block_data.size());
+        }
+
+        // push the block index into the database for easy retrieval later
+        {
+            db_tx->set_database(m_block_indexes);
+
+            auto error = db_tx->append(block.block_index, block_hash);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        // push the compact header of the block into the database so that it can be read without the block
+        {
+            const block_header_t header(block, block_hash);
+
+            db_tx->set_database(m_block_headers);
+
+            auto error = db_tx->append(block.block_index, header.serialize());
+
+            if (error)
+            {
+                return error;
+            }
+
+            db_tx->set_database(m_block_hash_indexes);
+
+            error = db_tx->put(
+                block_hash, Database::encode_key_bytes(block.block_index, Database::KEY_ENCODING_NATIVE));
+
+            if (error)
+            {
+                return error;
+            }
+
+            cache_entries.headers.push_back(header);
+        }
+
+        // push the block timestamp into the database for easy retrieval later
+        {
+            db_tx->set_database(m_block_timestamps);
 
-            // dump the transaction hashes into two vectors so that we can easily compare them
-            std::vector<crypto_hash_t> block_tx_hashes, txn_hashes;
+            const auto block_index = Database::encode_key_bytes(block.block_index, Database::KEY_ENCODING_BIG_ENDIAN);
 
-            for (const auto &tx : block.transactions)
-            {
-                block_tx_hashes.push_back(tx);
-            }
+            auto error = db_tx->put(block.timestamp, block_index);
 
-            for (const auto &tx : transactions)
+            if (error)
             {
-                std::visit([&txn_hashes](auto &&arg) { txn_hashes.push_back(arg.hash()); }, tx);
+                return error;
             }
+        }
 
-            // hash the vectors to get a result that we can match against
-            const auto block_hashes = Crypto::Hashing::sha3(block_tx_hashes);
+        // save what the block added so that it can be removed again by pop_blocks()
+        {
+            undo.output_count = global_index - undo.first_global_index;
 
-            const auto tx_hashes = Crypto::Hashing::sha3(txn_hashes);
+            db_tx->set_database(m_block_undo);
 
-            /**
-             * Compare the resulting hashes and if they do not match, then kick back out.
-             * The reason that we do this is that it guarantees that the order of the transactions
-             * are processed in is the same at each node so that the global indexes match across
-             * multiple nodes
-             */
-            if (block_hashes != tx_hashes)
+            auto error = db_tx->append(block.block_index, undo.serialize());
+
+            if (error)
             {
-                return MAKE_ERROR(BLOCK_TXN_ORDER);
+                return error;
             }
         }
 
-        std::scoped_lock lock(write_mutex);
+        return MAKE_ERROR(SUCCESS);
+    }
 
-        const auto block_hash = block.hash();
+    Error BlockchainStorage::put_blocks(
+        const std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>>
+            &blocks,
+        size_t blocks_per_transaction)
+    {
+        if (blocks_per_transaction == 0)
+        {
+            blocks_per_transaction = 1;
+        }
 
-    try_again:
+        std::vector<crypto_hash_t> block_hashes;
 
-        auto db_tx = m_db_env->transaction();
+        block_hashes.reserve(blocks.size());
 
-        // Push the block reward transaction into the database
-        {
-            auto [error, txn_hash] =
-                std::visit([this, &db_tx](auto &&arg) { return put_transaction(db_tx, arg); }, block.reward_tx);
+        size_t expected_size = 0;
 
-            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+        /**
+         * Sanity check the transaction order of every block before we write anything and
+         * calculate each block hash once so that it is not recomputed if we need to retry
+         */
+        for (const auto &[block, transactions] : blocks)
+        {
+            const auto error = check_block_transactions(block, transactions);
 
             if (error)
             {
                 return error;
             }
 
-            auto txn_error = put_transaction_block_hash(db_tx, txn_hash, block_hash);
+            block_hashes.push_back(block.hash());
 
-            MDB_CHECK_TXN_EXPAND(txn_error, m_db_env, db_tx, try_again);
+            expected_size += block.size();
 
-            if (txn_error)
+            for (const auto &transaction : transactions)
             {
-                return txn_error;
+                std::visit([&expected_size](auto &&arg) { expected_size += arg.size(); }, transaction);
             }
         }
 
-        // loop through the individual transactions in the block and push them into the database
-        for (const auto &transaction : transactions)
+        std::scoped_lock lock(write_mutex);
+
+        /**
+         * Size the memory map for the whole import up front rather than discovering that it is full
+         * part way through a write transaction; if this fails, the write transactions still expand
+         * the memory map as they require
+         */
+        m_db_env->reserve(expected_size * Configuration::Database::MAP_RESERVE_FACTOR);
+
+        for (size_t start = 0; start < blocks.size(); start += blocks_per_transaction)
         {
-            auto [error, txn_hash] = put_transaction(db_tx, transaction);
+            const auto end = std::min(start + blocks_per_transaction, blocks.size());
 
-            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+        try_again:
 
-            if (error)
-            {
-                return error;
-            }
+            auto db_tx = m_db_env->transaction();
 
-            auto txn_error = put_transaction_block_hash(db_tx, txn_hash, block_hash);
+            /**
+             * The global index counter is read once per write transaction and then carried
+             * forward locally as each block in the batch is written
+             */
+            uint64_t global_index = 0;
 
-            MDB_CHECK_TXN_EXPAND(txn_error, m_db_env, db_tx, try_again);
+            pending_cache_entries_t cache_entries;
 
-            if (txn_error)
             {
-                return txn_error;
-            }
-        }
+                db_tx->set_database(m_global_indexes);
 
-        // push the block itself into the database
-        {
-            db_tx->set_database(m_blocks);
+                const auto [error, count] = db_tx->count();
 
-            auto error = db_tx->put(block_hash, block.serialize());
+                if (error)
+                {
+                    return error;
+                }
 
-            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+                global_index = count;
+            }
 
-            if (error)
+            for (size_t i = start; i < end; ++i)
             {
-                return error;
-            }
-        }
+                const auto &[block, transactions] = blocks[i];
 
-        // push the block index into the database for easy retrieval later
-        {
-            db_tx->set_database(m_block_indexes);
+                auto error = put_block(db_tx, block, block_hashes[i], transactions, global_index, cache_entries);
+
+                MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
 
-            auto error = db_tx->put(block.block_index, block_hash);
+                if (error)
+                {
+                    return error;
+                }
+            }
+
+            auto error = db_tx->commit();
 
             MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
 
@@ -424,27 +2636,39 @@ namespace Core
             {
                 return error;
             }
-        }
 
-        // push the block timestamp into the database for easy retrieval later
-        {
-            db_tx->set_database(m_block_timestamps);
+            cache_committed(cache_entries);
 
-            auto error = db_tx->put(block.timestamp, block_hash);
+            maintain_key_image_filter();
 
-            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+            maintain_compression_dictionary();
 
-            if (error)
-            {
-                return error;
-            }
+            m_db_env->maintain_map_size();
         }
 
-        auto error = db_tx->commit();
+        return MAKE_ERROR(SUCCESS);
+    }
 
-        MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+    std::unique_ptr<BlockchainReadSession> BlockchainStorage::read_session() const
+    {
+        return std::make_unique<BlockchainReadSession>(*this, m_db_env->transaction(true));
+    }
 
-        return error;
+    Error BlockchainStorage::set_sync_on_commit(bool enabled)
+    {
+        return m_db_env->set_flags(MDB_NOSYNC, !enabled);
+    }
+
+    transaction_cache_t::stats_t BlockchainStorage::transaction_cache_stats() const
+    {
+        return m_transaction_cache.stats();
+    }
+
+    Error BlockchainStorage::train_transaction_dictionary()
+    {
+        std::scoped_lock lock(write_mutex);
+
+        return train_dictionary(m_transactions);
     }
 
     Error BlockchainStorage::put_key_image(
@@ -453,32 +2677,50 @@ namespace Core
     {
         db_tx->set_database(m_key_images);
 
-        return db_tx->put<crypto_key_image_t, std::vector<uint8_t>>(key_image, {});
+        const auto error = db_tx->put<crypto_key_image_t, std::vector<uint8_t>>(key_image, {});
+
+        /**
+         * The filter is updated before the write transaction commits. Should the transaction be rolled
+         * back, the filter is only left with an extra key image which costs us a false positive.
+         */
+        if (!error)
+        {
+            m_key_image_filter.insert(key_image);
+        }
+
+        return error;
     }
 
-    std::tuple<Error, crypto_hash_t> BlockchainStorage::put_transaction(
+    std::tuple<Error, crypto_hash_t, size_t> BlockchainStorage::put_transaction(
         std::unique_ptr<Database::LMDBTransaction> &db_tx,
-        const Types::Blockchain::transaction_t &transaction)
+        const Types::Blockchain::transaction_t &transaction,
+        uint64_t &global_index)
     {
         db_tx->set_database(m_transactions);
 
         crypto_hash_t txn_hash;
 
+        size_t txn_size = 0;
+
         /**
          * The reason that this looks so convoluted is because of the use
          * of std::variant for the different types of transactions
          */
         {
             auto error = std::visit(
-                [this, &db_tx, &txn_hash](auto &&arg)
+                [this, &db_tx, &txn_hash, &txn_size](auto &&arg)
                 {
                     using T = std::decay_t<decltype(arg)>;
 
                     {
                         txn_hash = arg.hash();
 
+                        const auto txn_data = arg.serialize();
+
+                        txn_size = txn_data.size();
+
                         // push the transaction itself into the database
-                        auto error = db_tx->put(txn_hash, arg.serialize());
+                        auto error = db_tx->put(txn_hash, txn_data);
 
                         if (error)
                         {
@@ -511,19 +2753,17 @@ namespace Core
 
             if (error)
             {
-                return {error, txn_hash};
+                return {error, txn_hash, txn_size};
             }
         }
 
-        uint64_t count = m_global_indexes->count();
-
         /**
          * The reason that this looks so convoluted is because of the use
          * of std::variant for the different types of transactions
          */
         {
             auto error = std::visit(
-                [this, &count, &db_tx](auto &&arg)
+                [this, &global_index, &db_tx](auto &&arg)
                 {
                     using T = std::decay_t<decltype(arg)>;
 
@@ -542,14 +2782,14 @@ namespace Core
                         // loop through the outputs and push them into the database for the global indexes
                         for (const auto &output : arg.outputs)
                         {
-                            auto [error, index] = put_transaction_output(db_tx, count, output);
+                            auto [error, index] = put_transaction_output(db_tx, global_index, output);
 
                             if (error)
                             {
                                 return error;
                             }
 
-                            count++;
+                            global_index++;
 
                             transaction_output_indexes.push_back(index);
                         }
@@ -580,14 +2820,14 @@ namespace Core
                             Types::Blockchain::transaction_output_t(arg.public_ephemeral, 0, arg.commitment);
 
                         // push the output into the database
-                        auto [error, index] = put_transaction_output(db_tx, count, output);
+                        auto [error, index] = put_transaction_output(db_tx, global_index, output);
 
                         if (error)
                         {
                             return error;
                         }
 
-                        count++;
+                        global_index++;
 
                         transaction_output_indexes.push_back(index);
 
@@ -606,11 +2846,11 @@ namespace Core
 
             if (error)
             {
-                return {error, txn_hash};
+                return {error, txn_hash, txn_size};
             }
         }
 
-        return {MAKE_ERROR(SUCCESS), txn_hash};
+        return {MAKE_ERROR(SUCCESS), txn_hash, txn_size};
     }
 
     Error BlockchainStorage::put_transaction_block_hash(
@@ -654,7 +2894,7 @@ namespace Core
          */
         const auto temp = Types::Blockchain::transaction_output_t(output.public_ephemeral, 0, output.commitment);
 
-        auto error = db_tx->put(index, temp.serialize_output());
+        auto error = db_tx->append(index, temp.serialize_output());
 
         if (error)
         {
@@ -663,4 +2903,282 @@ namespace Core
 
         return {MAKE_ERROR(SUCCESS), index};
     }
+
+    void BlockchainStorage::forget_headers(const uint64_t &block_count)
+    {
+        std::unique_lock lock(m_recent_headers_mutex);
+
+        if (block_count < m_recent_headers_first)
+        {
+            m_recent_headers_first = block_count;
+        }
+
+        m_recent_headers_end = std::min(m_recent_headers_end, block_count);
+    }
+
+    std::optional<block_header_t> BlockchainStorage::recent_header(const uint64_t &block_index) const
+    {
+        std::shared_lock lock(m_recent_headers_mutex);
+
+        if (block_index < m_recent_headers_first || block_index >= m_recent_headers_end)
+        {
+            return std::nullopt;
+        }
+
+        return m_recent_headers[block_index % m_recent_headers.size()];
+    }
+
+    void BlockchainStorage::remember_headers(const std::vector<block_header_t> &headers)
+    {
+        if (m_recent_headers.empty())
+        {
+            return;
+        }
+
+        std::unique_lock lock(m_recent_headers_mutex);
+
+        for (const auto &header : headers)
+        {
+            // the ring only ever holds a contiguous run of blocks so anything else starts it over
+            if (header.block_index != m_recent_headers_end)
+            {
+                m_recent_headers_first = header.block_index;
+
+                m_recent_headers_end = header.block_index;
+            }
+
+            m_recent_headers[header.block_index % m_recent_headers.size()] = header;
+
+            m_recent_headers_end++;
+
+            if (m_recent_headers_end - m_recent_headers_first > m_recent_headers.size())
+            {
+                m_recent_headers_first = m_recent_headers_end - m_recent_headers.size();
+            }
+        }
+    }
+
+    void BlockchainStorage::save_key_image_filter() const
+    {
+        if (!m_key_image_filter_valid)
+        {
+            return;
+        }
+
+        const auto [error, info] = m_db_env->info();
+
+        if (!error)
+        {
+            [[maybe_unused]] const auto save_error =
+                m_key_image_filter.save(m_key_image_filter_path, info.me_last_txnid, m_key_images->count());
+        }
+    }
+
+    Error BlockchainStorage::train_dictionary(const std::shared_ptr<Database::LMDBDatabase> &source)
+    {
+        std::vector<std::vector<uint8_t>> samples;
+
+        samples.reserve(Configuration::Database::COMPRESSION_TRAINING_SAMPLES);
+
+        {
+            // transactions are keyed by their hashes so the first of them in key order are a random sample
+            auto transactions = source->range<crypto_hash_t, std::vector<uint8_t>>();
+
+            for (auto it = transactions.begin();
+                 it != transactions.end() && samples.size() < Configuration::Database::COMPRESSION_TRAINING_SAMPLES;
+                 ++it)
+            {
+                samples.push_back(it.value());
+            }
+
+            if (transactions.error())
+            {
+                return transactions.error();
+            }
+        }
+
+        const auto id = m_compression_dictionaries->count() + 1;
+
+        const auto dictionary = Database::CompressionDictionary::train(
+            id, samples, Configuration::Database::COMPRESSION_DICTIONARY_SIZE);
+
+        // the dictionary is stored before it is used so that everything compressed with it stays readable
+        auto error = m_compression_dictionaries->put(id, dictionary->data());
+
+        if (error)
+        {
+            return error;
+        }
+
+        error = m_transactions->set_compression(dictionary);
+
+        if (!error)
+        {
+            m_transaction_dictionary_trained = true;
+        }
+
+        return error;
+    }
+
+    std::tuple<Error, block_verification_t> BlockchainStorage::verify_block(
+        std::unique_ptr<Database::LMDBTransaction> &db_tx,
+        const uint64_t &block_index,
+        bool validate_construction) const
+    {
+        block_verification_t result;
+
+        const auto [hash_error, block_hash] = get_block_hash(db_tx, block_index);
+
+        if (hash_error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), result};
+        }
+
+        // the block is read from the database rather than the block cache as it is the stored copy being checked
+        db_tx->set_database(m_blocks);
+
+        const auto [block_error, block] = db_tx->get<crypto_hash_t, Types::Blockchain::block_t>(block_hash);
+
+        if (block_error)
+        {
+            return {MAKE_ERROR(DB_BLOCK_NOT_FOUND), result};
+        }
+
+        if (block.hash() != block_hash || block.block_index != block_index)
+        {
+            return {
+                MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block does not match the hash it is stored under."), result};
+        }
+
+        if (block_index != 0)
+        {
+            const auto [previous_error, previous_hash] = get_block_hash(db_tx, block_index - 1);
+
+            if (previous_error || previous_hash != block.previous_blockhash)
+            {
+                return {MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block does not link to the previous block."), result};
+            }
+        }
+
+        {
+            const auto [header_error, header] = get_block_header(db_tx, block_index);
+
+            if (header_error || header.serialize() != block_header_t(block, block_hash).serialize())
+            {
+                return {
+                    MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block header record does not match the block."), result};
+            }
+        }
+
+        if (validate_construction && !block.validate_construction())
+        {
+            return {MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block is not constructed correctly."), result};
+        }
+
+        auto transaction_hashes = block.transactions;
+
+        transaction_hashes.insert(
+            transaction_hashes.begin(), std::visit([](auto &&arg) { return arg.hash(); }, block.reward_tx));
+
+        std::vector<uint64_t> global_indexes;
+
+        std::vector<crypto_key_image_t> key_images;
+
+        for (const auto &txn_hash : transaction_hashes)
+        {
+            // as with the block, the stored copy is checked and the working set of the cache is left alone
+            const auto [txn_error, transaction, txn_block_hash] = get_transaction(db_tx, txn_hash, false);
+
+            if (txn_error)
+            {
+                return {MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block transaction is not stored."), result};
+            }
+
+            if (std::visit([](auto &&arg) { return arg.hash(); }, transaction) != txn_hash
+                || txn_block_hash != block_hash)
+            {
+                return {
+                    MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Stored transaction does not match the block."), result};
+            }
+
+            const auto [indexed, outputs] = transaction_outputs(transaction);
+
+            if (indexed)
+            {
+                const auto [index_error, indexes] = get_transaction_indexes(db_tx, txn_hash);
+
+                if (index_error || indexes.size() != outputs.size())
+                {
+                    return {
+                        MAKE_ERROR_MSG(
+                            DB_VERIFICATION_FAILED, "Transaction global indexes do not match its outputs."),
+                        result};
+                }
+
+                for (size_t i = 0; i < indexes.size(); ++i)
+                {
+                    const auto [output_error, output] = get_output_by_global_index(db_tx, indexes[i]);
+
+                    if (output_error || output.serialize_output() != outputs[i].serialize_output())
+                    {
+                        return {
+                            MAKE_ERROR_MSG(
+                                DB_VERIFICATION_FAILED, "Transaction global index leads to another output."),
+                            result};
+                    }
+                }
+
+                global_indexes.insert(global_indexes.end(), indexes.begin(), indexes.end());
+            }
+
+            for (const auto &key_image : transaction_key_images(transaction))
+            {
+                key_images.push_back(key_image);
+            }
+
+            result.transactions++;
+        }
+
+        // the outputs of a block are given a contiguous run of global indexes in transaction order
+        for (size_t i = 1; i < global_indexes.size(); ++i)
+        {
+            if (global_indexes[i] != global_indexes[i - 1] + 1)
+            {
+                return {MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block global indexes are not contiguous."), result};
+            }
+        }
+
+        result.outputs = global_indexes.size();
+
+        db_tx->set_database(m_key_images);
+
+        for (const auto &key_image : key_images)
+        {
+            if (!db_tx->exists(key_image))
+            {
+                return {MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Spent key image is not stored."), result};
+            }
+        }
+
+        result.key_images = key_images.size();
+
+        // blocks stored before undo records existed do not have one
+        db_tx->set_database(m_block_undo);
+
+        const auto [undo_error, undo_data] = db_tx->get_view(block_index);
+
+        if (!undo_error)
+        {
+            const auto undo = undo_data.decode<block_undo_t>();
+
+            if (undo.block_hash != block_hash || undo.transactions != transaction_hashes
+                || undo.output_count != global_indexes.size()
+                || (!global_indexes.empty() && undo.first_global_index != global_indexes.front()))
+            {
+                return {MAKE_ERROR_MSG(DB_VERIFICATION_FAILED, "Block undo record does not match the block."), result};
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), result};
+    }
 } // namespace Core
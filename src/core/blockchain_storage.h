@@ -5,167 +5,1066 @@
 #ifndef CORE_BLOCKCHAIN_STORAGE_H
 #define CORE_BLOCKCHAIN_STORAGE_H
 
+#include <cstring>
 #include <db_lmdb.h>
+#include <functional>
+#include <key_image_filter.h>
+#include <optional>
+#include <shared_mutex>
+#include <tools/thread_safe_lru_cache.h>
 #include <types.h>
 
 namespace Core
 {
+    // forward declarations
+    class BlockchainStorage;
+
+    /**
+     * Selects a cache shard using the leading bytes of a hash as they are already uniformly distributed
+     */
+    struct hash_shard_t
+    {
+        size_t operator()(const crypto_hash_t &hash) const
+        {
+            size_t result = 0;
+
+            std::memcpy(&result, hash.data(), sizeof(result));
+
+            return result;
+        }
+    };
+
+    /**
+     * The fixed-width summary of a block held in the block header table, which allows the header
+     * chain to be walked (and timestamps or block indexes to be looked up) without decoding blocks
+     */
+    struct block_header_t
+    {
+        /**
+         * The size (in bytes) of every record in the block header table
+         */
+        static const size_t SIZE = 120;
+
+        block_header_t() = default;
+
+        block_header_t(const Types::Blockchain::block_t &block, const crypto_hash_t &block_hash);
+
+        block_header_t(const std::vector<uint8_t> &data);
+
+        /**
+         * Serializes the header to its fixed-width record
+         *
+         * @return
+         */
+        [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+        uint64_t block_index = 0;
+
+        crypto_hash_t block_hash;
+
+        crypto_hash_t previous_blockhash;
+
+        uint64_t timestamp = 0;
+
+        uint64_t transaction_count = 0;
+
+        crypto_public_key_t producer_public_key;
+    };
+
+    /**
+     * The number of records checked while verifying a stored block
+     */
+    struct block_verification_t
+    {
+        size_t transactions = 0;
+
+        size_t outputs = 0;
+
+        size_t key_images = 0;
+    };
+
+    /**
+     * An output as a wallet needs it to find (and later spend) the outputs that it owns
+     */
+    struct wallet_sync_output_t
+    {
+        uint64_t global_index = 0;
+
+        crypto_public_key_t public_ephemeral;
+
+        crypto_pedersen_commitment_t commitment;
+    };
+
+    /**
+     * A transaction as a wallet needs it to scan for the outputs that it owns
+     */
+    struct wallet_sync_transaction_t
+    {
+        crypto_hash_t txn_hash;
+
+        crypto_public_key_t tx_public_key;
+
+        std::vector<wallet_sync_output_t> outputs;
+    };
+
+    /**
+     * The compact record of a block handed to wallets while they sync, which holds only the
+     * transactions of the block that create outputs
+     */
+    struct wallet_sync_block_t
+    {
+        /**
+         * Returns the number of bytes of keys and numbers held by the record, which is what the
+         * byte budget of a wallet sync request is measured in
+         *
+         * @return
+         */
+        [[nodiscard]] size_t size() const;
+
+        uint64_t block_index = 0;
+
+        crypto_hash_t block_hash;
+
+        uint64_t timestamp = 0;
+
+        std::vector<wallet_sync_transaction_t> transactions;
+    };
+
+    typedef ThreadSafeLRUCache<crypto_hash_t, Types::Blockchain::block_t, hash_shard_t> block_cache_t;
+
+    typedef ThreadSafeLRUCache<
+        crypto_hash_t,
+        std::tuple<Types::Blockchain::transaction_t, crypto_hash_t>,
+        hash_shard_t>
+        transaction_cache_t;
+
+    typedef std::function<Error(
+        std::unique_ptr<Database::LMDBTransaction> &,
+        const Database::LMDBValueView &,
+        const Database::LMDBValueView &)>
+        migrate_record_t;
+
+    /**
+     * Provides a read-only view of the blockchain storage where every query is answered from a
+     * single LMDB read transaction spanning all of the named databases. As a result, multi-record
+     * queries are served from one consistent MVCC snapshot and a concurrent put_block() can never
+     * produce a torn view for the lifetime of the session.
+     *
+     * Please note: the session should be short-lived as LMDB cannot reclaim pages that are still
+     * referenced by an open read transaction.
+     */
+    class BlockchainReadSession
+    {
+      public:
+        /**
+         * Creates a new read session over the given blockchain storage
+         *
+         * DO NOT CALL THIS METHOD DIRECTLY! Use BlockchainStorage::read_session() instead
+         *
+         * @param storage
+         * @param db_tx
+         */
+        BlockchainReadSession(const BlockchainStorage &storage, std::unique_ptr<Database::LMDBTransaction> db_tx);
+
+        /**
+         * Checks whether the block with the given hash exists in the database
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] bool block_exists(const crypto_hash_t &block_hash);
+
+        /**
+         * Checks whether the block with the given index exists in the database
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] bool block_exists(const uint64_t &block_index);
+
+        /**
+         * Retrieves the block and transactions within that block using the specified block hash
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+            get_block(const crypto_hash_t &block_hash);
+
+        /**
+         * Retrieves the block and transactions within that block using the specified block index
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+            get_block(const uint64_t &block_index);
+
+        /**
+         * Retrieve the NEXT closest block hash by timestamp using the specified timestamp
+         *
+         * @param timestamp
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, uint64_t, crypto_hash_t> get_block_by_timestamp(const uint64_t &timestamp);
+
+        /**
+         * Retrieve the total number of blocks stored in the database
+         *
+         * @return
+         */
+        [[nodiscard]] size_t get_block_count();
+
+        /**
+         * Retrieve the block hash for the given block index
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, crypto_hash_t> get_block_hash(const uint64_t &block_index);
+
+        /**
+         * Retrieve the block hashes for the inclusive range of block indexes specified
+         *
+         * @param first_block_index
+         * @param last_block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<crypto_hash_t>>
+            get_block_hashes(const uint64_t &first_block_index, const uint64_t &last_block_index);
+
+        /**
+         * Retrieve the header of the block with the given block hash
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, block_header_t> get_block_header(const crypto_hash_t &block_hash);
+
+        /**
+         * Retrieve the header of the block with the given block index
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, block_header_t> get_block_header(const uint64_t &block_index);
+
+        /**
+         * Retrieve the block headers for the inclusive range of block indexes specified
+         *
+         * @param first_block_index
+         * @param last_block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<block_header_t>>
+            get_block_headers(const uint64_t &first_block_index, const uint64_t &last_block_index);
+
+        /**
+         * Retrieve the block index for the given block hash
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, uint64_t> get_block_index(const crypto_hash_t &block_hash);
+
+        /**
+         * Retrieve the [timestamp, block index] of every block with a timestamp within the inclusive
+         * range specified in timestamp order (blocks sharing a timestamp are in block index order)
+         *
+         * @param first_timestamp
+         * @param last_timestamp
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<std::tuple<uint64_t, uint64_t>>>
+            get_block_indexes_by_timestamp(const uint64_t &first_timestamp, const uint64_t &last_timestamp);
+
+        /**
+         * Retrieves the maximum transaction output global index from the database
+         *
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, uint64_t> get_maximum_global_index();
+
+        /**
+         * Retrieves the transaction output for the specified global index
+         *
+         * @param global_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_output_t>
+            get_output_by_global_index(const uint64_t &global_index);
+
+        /**
+         * Retrieve the transaction outputs for the specified global indexes
+         *
+         * @param global_indexes
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
+            get_outputs_by_global_indexes(const std::vector<uint64_t> &global_indexes);
+
+        /**
+         * Retrieve the transaction outputs for the specified global indexes in the order requested
+         *
+         * @param global_indexes
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<Types::Blockchain::transaction_output_t>>
+            get_ring_outputs(const std::vector<uint64_t> &global_indexes);
+
+        /**
+         * Retrieve the transaction outputs for each of the specified sets of global indexes
+         *
+         * @param rings
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<std::vector<Types::Blockchain::transaction_output_t>>>
+            get_ring_outputs(const std::vector<std::vector<uint64_t>> &rings);
+
+        /**
+         * Retrieves the transaction with the specified hash
+         *
+         * @param txn_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t>
+            get_transaction(const crypto_hash_t &txn_hash);
+
+        /**
+         * Retrieves the global indexes for the transaction with the specified hash
+         *
+         * @param txn_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<uint64_t>> get_transaction_indexes(const crypto_hash_t &txn_hash);
+
+        /**
+         * Retrieves the compact wallet sync records for the range of blocks specified
+         *
+         * @param start_height
+         * @param count
+         * @param maximum_bytes
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<wallet_sync_block_t>> get_wallet_sync_data(
+            const uint64_t &start_height,
+            const uint64_t &count,
+            size_t maximum_bytes = Configuration::Database::WALLET_SYNC_MAXIMUM_BYTES);
+
+        /**
+         * Checks if the specified key image exists in the database
+         *
+         * @param key_image
+         * @return
+         */
+        [[nodiscard]] bool key_image_exists(const crypto_key_image_t &key_image);
+
+        /**
+         * Checks if the specified key images exist in the database
+         *
+         * @param key_images
+         * @return
+         */
+        [[nodiscard]] std::map<crypto_key_image_t, bool>
+            key_image_exists(const std::vector<crypto_key_image_t> &key_images);
+
+        /**
+         * Re-verifies the stored block with the given block index against every record derived from it
+         *
+         * Checks that the block hashes to the hash it is stored under and links to the hash stored for
+         * the previous block, that its header record matches it, that each of its transactions is
+         * stored under its own hash (and against the block), that the global indexes of each transaction
+         * lead back to its own outputs, and that every key image spent within it is stored. The key
+         * image table is read directly so that the key image filter is not trusted.
+         *
+         * @param block_index
+         * @param validate_construction whether block_t::validate_construction() is also run
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, block_verification_t>
+            verify_block(const uint64_t &block_index, bool validate_construction = false);
+
+      private:
+        const BlockchainStorage &m_storage;
+
+        std::unique_ptr<Database::LMDBTransaction> m_db_tx;
+    };
+
     class BlockchainStorage
     {
       public:
         /**
-         * Create new instance of the blockchain storage in the specified path
+         * Create new instance of the blockchain storage in the specified path
+         *
+         * The cache size is the total amount of memory (in bytes) that may be used to hold decoded
+         * blocks and transactions. It is split evenly between blocks and transactions.
+         *
+         * @param db_path
+         * @param cache_size
+         */
+        BlockchainStorage(
+            const std::string &db_path,
+            size_t cache_size = Configuration::Database::DEFAULT_CACHE_SIZE);
+
+        ~BlockchainStorage();
+
+        /**
+         * Retrieves a singleton instance of the class
+         *
+         * @param db_path
+         * @param cache_size
+         * @return
+         */
+        static std::shared_ptr<BlockchainStorage>
+            getInstance(const std::string &db_path, size_t cache_size = Configuration::Database::DEFAULT_CACHE_SIZE);
+
+        /**
+         * Retrieves the usage statistics of the decoded block cache
+         *
+         * @return
+         */
+        [[nodiscard]] block_cache_t::stats_t block_cache_stats() const;
+
+        /**
+         * Checks whether the block with the given hash exists in the database
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] bool block_exists(const crypto_hash_t &block_hash) const;
+
+        /**
+         * Checks whether the block with the given index exists in the database
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] bool block_exists(const uint64_t &block_index) const;
+
+        /**
+         * Returns the LMDB environment holding the blockchain, which other stores (ie. the staking
+         * engine) may open their tables in so that they can be written atomically with a block
+         *
+         * @return
+         */
+        [[nodiscard]] std::shared_ptr<Database::LMDB> environment() const;
+
+        /**
+         * Flushes the data buffers of the database to disk
+         *
+         * @param force whether to flush even if the environment does not sync on commit
+         * @return
+         */
+        Error flush(bool force = true) const;
+
+        /**
+         * Retrieves the block and transactions within that block using the specified block hash
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+            get_block(const crypto_hash_t &block_hash) const;
+
+        /**
+         * Retrieves the block and transactions within that block using the specified block index
+         *
+         * @param block_height
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+            get_block(const uint64_t &block_index) const;
+
+        /**
+         * Retrieve the NEXT closest block hash by timestamp using the specified timestamp
+         *
+         * @param timestamp
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, uint64_t, crypto_hash_t>
+            get_block_by_timestamp(const uint64_t &timestamp) const;
+
+        /**
+         * Retrieve the total number of blocks stored in the database
+         *
+         * @return
+         */
+        [[nodiscard]] size_t get_block_count() const;
+
+        /**
+         * Retrieve the block hash for the given block index
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, crypto_hash_t> get_block_hash(const uint64_t &block_index) const;
+
+        /**
+         * Retrieve the block hashes for the inclusive range of block indexes specified
+         *
+         * @param first_block_index
+         * @param last_block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<crypto_hash_t>>
+            get_block_hashes(const uint64_t &first_block_index, const uint64_t &last_block_index) const;
+
+        /**
+         * Retrieve the header of the block with the given block hash
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, block_header_t> get_block_header(const crypto_hash_t &block_hash) const;
+
+        /**
+         * Retrieve the header of the block with the given block index
+         *
+         * Headers of the most recent blocks are answered from memory.
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, block_header_t> get_block_header(const uint64_t &block_index) const;
+
+        /**
+         * Retrieve the block headers for the inclusive range of block indexes specified
+         *
+         * @param first_block_index
+         * @param last_block_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<block_header_t>>
+            get_block_headers(const uint64_t &first_block_index, const uint64_t &last_block_index) const;
+
+        /**
+         * Retrieve the block index for the given block hash
+         *
+         * @param block_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, uint64_t> get_block_index(const crypto_hash_t &block_hash) const;
+
+        /**
+         * Retrieve the [timestamp, block index] of every block with a timestamp within the inclusive
+         * range specified in timestamp order (blocks sharing a timestamp are in block index order)
+         *
+         * @param first_timestamp
+         * @param last_timestamp
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<std::tuple<uint64_t, uint64_t>>>
+            get_block_indexes_by_timestamp(const uint64_t &first_timestamp, const uint64_t &last_timestamp) const;
+
+        /**
+         * Retrieves the maximum transaction output global index from the database
+         *
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, uint64_t> get_maximum_global_index() const;
+
+        /**
+         * Retrieves the transaction output for the specified global index
+         *
+         * @param global_index
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_output_t>
+            get_output_by_global_index(const uint64_t &global_index) const;
+
+        /**
+         * Retrieve the transaction outputs for the specified global indexes
+         *
+         * @param global_indexes
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
+            get_outputs_by_global_indexes(const std::vector<uint64_t> &global_indexes) const;
+
+        /**
+         * Retrieve the transaction outputs for the specified global indexes (such as the members
+         * of a ring) with the results aligned to the order of the request
+         *
+         * The indexes are sorted and deduplicated, then fetched using a single cursor that moves
+         * through the database in key order within one read transaction
+         *
+         * @param global_indexes
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<Types::Blockchain::transaction_output_t>>
+            get_ring_outputs(const std::vector<uint64_t> &global_indexes) const;
+
+        /**
+         * Retrieve the transaction outputs for each of the specified sets of global indexes with
+         * each set of results aligned to the order of its request
          *
-         * @param db_path
+         * All of the requests are merged so that an output shared by more than one ring (such as
+         * when verifying every input of every transaction in a block) is only read once
+         *
+         * @param rings
+         * @return
          */
-        BlockchainStorage(const std::string &db_path);
+        [[nodiscard]] std::tuple<Error, std::vector<std::vector<Types::Blockchain::transaction_output_t>>>
+            get_ring_outputs(const std::vector<std::vector<uint64_t>> &rings) const;
 
         /**
-         * Retrieves a singleton instance of the class
+         * Retrieves the transaction with the specified hash
          *
-         * @param db_path
+         * @param txn_hash
          * @return
          */
-        static std::shared_ptr<BlockchainStorage> getInstance(const std::string &db_path);
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t>
+            get_transaction(const crypto_hash_t &txn_hash) const;
 
         /**
-         * Checks whether the block with the given hash exists in the database
+         * Retrieves the global indexes for the transaction with the specified hash
          *
-         * @param block_hash
+         * @param txn_hash
          * @return
          */
-        [[nodiscard]] bool block_exists(const crypto_hash_t &block_hash) const;
+        [[nodiscard]] std::tuple<Error, std::vector<uint64_t>>
+            get_transaction_indexes(const crypto_hash_t &txn_hash) const;
 
         /**
-         * Checks whether the block with the given index exists in the database
+         * Retrieves what a wallet needs to scan the range of blocks specified: for each block, the
+         * public key, outputs and output global indexes of every transaction that creates outputs
          *
-         * @param block_index
+         * All of the blocks are read from a single read transaction and each transaction is only
+         * decoded as far as its outputs. Blocks are added until the count is reached, the top of
+         * the chain is reached, or the records returned reach the maximum number of bytes (as
+         * measured by wallet_sync_block_t::size()); however, at least one block is always returned
+         * so that the caller can continue from the block after the last one returned.
+         *
+         * @param start_height
+         * @param count
+         * @param maximum_bytes
          * @return
          */
-        [[nodiscard]] bool block_exists(const uint64_t &block_index) const;
+        [[nodiscard]] std::tuple<Error, std::vector<wallet_sync_block_t>> get_wallet_sync_data(
+            const uint64_t &start_height,
+            const uint64_t &count,
+            size_t maximum_bytes = Configuration::Database::WALLET_SYNC_MAXIMUM_BYTES) const;
 
         /**
-         * Retrieves the block and transactions within that block using the specified block hash
+         * Checks if the specified key image exists in the database
          *
-         * @param block_hash
+         * @param key_image
          * @return
          */
-        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
-            get_block(const crypto_hash_t &block_hash) const;
+        [[nodiscard]] bool key_image_exists(const crypto_key_image_t &key_image) const;
 
         /**
-         * Retrieves the block and transactions within that block using the specified block index
+         * Checks if the specified key image exists in the database
          *
-         * @param block_height
+         * @param key_images
          * @return
          */
-        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
-            get_block(const uint64_t &block_index) const;
+        [[nodiscard]] std::map<crypto_key_image_t, bool>
+            key_image_exists(const std::vector<crypto_key_image_t> &key_images) const;
 
         /**
-         * Retrieve the NEXT closest block hash by timestamp using the specified timestamp
+         * Retrieves the memory map growth counters of the database environment
          *
-         * @param timestamp
          * @return
          */
-        [[nodiscard]] std::tuple<Error, uint64_t, crypto_hash_t>
-            get_block_by_timestamp(const uint64_t &timestamp) const;
+        [[nodiscard]] Database::LMDB::growth_stats_t map_growth_stats() const;
 
         /**
-         * Retrieve the total number of blocks stored in the database
+         * Removes the specified number of blocks from the top of the chain, along with their
+         * transactions, outputs, key images and index entries, within a single write transaction
          *
+         * Each block is reversed using the undo record that put_block() saved with it, so the cost
+         * is proportional to the number of records the blocks added rather than to the size of the
+         * chain. Blocks stored before undo records were kept cannot be removed.
+         *
+         * @param count
          * @return
          */
-        [[nodiscard]] size_t get_block_count() const;
+        Error pop_blocks(size_t count);
 
         /**
-         * Retrieve the block hash for the given block index
+         * Saves the block with the transactions specified in the database
          *
-         * @param block_index
+         * Blocks must be saved in ascending block index order as block indexes are appended
+         * to the end of their table; a block whose index is not the number of blocks already
+         * stored is rejected with DB_BLOCK_INDEX_NOT_NEXT.
+         *
+         * @param block
+         * @param transactions
          * @return
          */
-        [[nodiscard]] std::tuple<Error, crypto_hash_t> get_block_hash(const uint64_t &block_index) const;
+        Error put_block(
+            const Types::Blockchain::block_t &block,
+            const std::vector<Types::Blockchain::transaction_t> &transactions);
 
         /**
-         * Retrieve the block hash for the given block hash
+         * Saves the blocks with the transactions specified in the database, writing up to the
+         * specified number of blocks within each LMDB write transaction. This greatly reduces the
+         * number of commits (and therefore disk syncs) required when importing many blocks at once
+         * such as during the initial synchronization of the chain.
          *
-         * @param block_hash
+         * The blocks must be supplied in the order in which they are to be stored. If an error is
+         * encountered, the blocks in the current write transaction are rolled back; however, any
+         * blocks committed in previous write transactions remain in the database.
+         *
+         * @param blocks
+         * @param blocks_per_transaction
          * @return
          */
-        [[nodiscard]] std::tuple<Error, uint64_t> get_block_index(const crypto_hash_t &block_hash) const;
+        Error put_blocks(
+            const std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>>
+                &blocks,
+            size_t blocks_per_transaction = Configuration::Database::BLOCKS_PER_WRITE_TRANSACTION);
 
         /**
-         * Retrieves the maximum transaction output global index from the database
+         * Opens a read session that answers all of its queries from a single, consistent
+         * snapshot of the database
          *
          * @return
          */
-        [[nodiscard]] std::tuple<Error, uint64_t> get_maximum_global_index() const;
+        [[nodiscard]] std::unique_ptr<BlockchainReadSession> read_session() const;
 
         /**
-         * Retrieves the transaction output for the specified global index
+         * Sets whether every write transaction is synced to disk as it commits
          *
-         * @param global_index
+         * When disabled, committed blocks survive a crash of the process but may be lost if the
+         * system crashes before the next flush().
+         *
+         * @param enabled
          * @return
          */
-        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_output_t>
-            get_output_by_global_index(const uint64_t &global_index) const;
+        Error set_sync_on_commit(bool enabled);
 
         /**
-         * Retrieve the transaction outputs for the specified global indexes
+         * Retrieves the usage statistics of the decoded transaction cache
+         *
+         * @return
+         */
+        [[nodiscard]] transaction_cache_t::stats_t transaction_cache_stats() const;
+
+        /**
+         * Trains a new compression dictionary from a sample of the stored transactions, which
+         * compresses every transaction stored from then on
+         *
+         * The transactions already stored keep the dictionary they were compressed with (every
+         * dictionary is kept so that they remain readable). The first dictionary is trained
+         * automatically once COMPRESSION_TRAINING_SAMPLES transactions have been stored.
          *
-         * @param global_indexes
          * @return
          */
+        Error train_transaction_dictionary();
+
+      private:
+        friend class BlockchainReadSession;
+
+        /**
+         * The decoded blocks and transactions written within a write transaction, which are
+         * added to the caches once (and only if) the write transaction commits
+         */
+        struct pending_cache_entries_t
+        {
+            std::vector<std::tuple<crypto_hash_t, Types::Blockchain::block_t, size_t>> blocks;
+
+            std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_t, crypto_hash_t, size_t>>
+                transactions;
+
+            std::vector<block_header_t> headers;
+        };
+
+        /**
+         * The records added by a block beyond those found through its block index, which are saved
+         * with the block so that it can be removed again without decoding it or its transactions
+         */
+        struct block_undo_t
+        {
+            block_undo_t() = default;
+
+            block_undo_t(const std::vector<uint8_t> &data);
+
+            [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+            crypto_hash_t block_hash;
+
+            uint64_t timestamp = 0;
+
+            uint64_t first_global_index = 0;
+
+            uint64_t output_count = 0;
+
+            std::vector<crypto_hash_t> transactions;
+
+            std::vector<crypto_key_image_t> key_images;
+        };
+
+        /**
+         * The following methods mirror the public getters of the same name; however, they perform
+         * their work within the supplied transaction so that multiple queries may share a snapshot
+         */
+
+        [[nodiscard]] bool block_exists(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const crypto_hash_t &block_hash) const;
+
+        [[nodiscard]] bool
+            block_exists(std::unique_ptr<Database::LMDBTransaction> &db_tx, const uint64_t &block_index) const;
+
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+            get_block(std::unique_ptr<Database::LMDBTransaction> &db_tx, const crypto_hash_t &block_hash) const;
+
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>
+            get_block(std::unique_ptr<Database::LMDBTransaction> &db_tx, const uint64_t &block_index) const;
+
+        [[nodiscard]] std::tuple<Error, uint64_t, crypto_hash_t> get_block_by_timestamp(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &timestamp) const;
+
+        [[nodiscard]] size_t get_block_count(std::unique_ptr<Database::LMDBTransaction> &db_tx) const;
+
+        [[nodiscard]] std::tuple<Error, crypto_hash_t>
+            get_block_hash(std::unique_ptr<Database::LMDBTransaction> &db_tx, const uint64_t &block_index) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<crypto_hash_t>> get_block_hashes(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &first_block_index,
+            const uint64_t &last_block_index) const;
+
+        [[nodiscard]] std::tuple<Error, block_header_t> get_block_header(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const crypto_hash_t &block_hash) const;
+
+        [[nodiscard]] std::tuple<Error, block_header_t>
+            get_block_header(std::unique_ptr<Database::LMDBTransaction> &db_tx, const uint64_t &block_index) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<block_header_t>> get_block_headers(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &first_block_index,
+            const uint64_t &last_block_index) const;
+
+        [[nodiscard]] std::tuple<Error, uint64_t>
+            get_block_index(std::unique_ptr<Database::LMDBTransaction> &db_tx, const crypto_hash_t &block_hash) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<std::tuple<uint64_t, uint64_t>>> get_block_indexes_by_timestamp(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &first_timestamp,
+            const uint64_t &last_timestamp) const;
+
+        [[nodiscard]] std::tuple<Error, uint64_t>
+            get_maximum_global_index(std::unique_ptr<Database::LMDBTransaction> &db_tx) const;
+
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_output_t> get_output_by_global_index(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &global_index) const;
+
         [[nodiscard]] std::tuple<Error, std::map<uint64_t, Types::Blockchain::transaction_output_t>>
-            get_outputs_by_global_indexes(const std::vector<uint64_t> &global_indexes) const;
+            get_outputs_by_global_indexes(
+                std::unique_ptr<Database::LMDBTransaction> &db_tx,
+                const std::vector<uint64_t> &global_indexes) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<Types::Blockchain::transaction_output_t>> get_ring_outputs(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const std::vector<uint64_t> &global_indexes) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<std::vector<Types::Blockchain::transaction_output_t>>>
+            get_ring_outputs(
+                std::unique_ptr<Database::LMDBTransaction> &db_tx,
+                const std::vector<std::vector<uint64_t>> &rings) const;
 
         /**
-         * Retrieves the transaction with the specified hash
+         * Retrieves the transaction and the hash of the block containing it within the transaction
+         * supplied, serving it from (and adding it to) the transaction cache unless told otherwise
          *
+         * @param db_tx
          * @param txn_hash
+         * @param use_cache false to decode the transaction exactly as it is stored, leaving the cache as is
          * @return
          */
-        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t>
-            get_transaction(const crypto_hash_t &txn_hash) const;
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_t, crypto_hash_t> get_transaction(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const crypto_hash_t &txn_hash,
+            bool use_cache = true) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<uint64_t>> get_transaction_indexes(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const crypto_hash_t &txn_hash) const;
+
+        [[nodiscard]] std::tuple<Error, std::vector<wallet_sync_block_t>> get_wallet_sync_data(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &start_height,
+            const uint64_t &count,
+            size_t maximum_bytes) const;
+
+        [[nodiscard]] bool key_image_exists(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const crypto_key_image_t &key_image) const;
+
+        [[nodiscard]] std::map<crypto_key_image_t, bool> key_image_exists(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const std::vector<crypto_key_image_t> &key_images) const;
 
         /**
-         * Retrieves the global indexes for the transaction with the specified hash
+         * Returns the snapshot (transaction ID) of the read transaction if the values read within it
+         * may be added to the caches, which is only the case for snapshots taken since the last time
+         * that blocks were popped
          *
-         * @param txn_hash
+         * @param db_tx
          * @return
          */
-        [[nodiscard]] std::tuple<Error, std::vector<uint64_t>>
-            get_transaction_indexes(const crypto_hash_t &txn_hash) const;
+        [[nodiscard]] std::optional<size_t> cache_snapshot(std::unique_ptr<Database::LMDBTransaction> &db_tx) const;
 
         /**
-         * Checks if the specified key image exists in the database
+         * Adds the blocks and transactions from a committed write transaction to the caches
          *
-         * @param key_image
+         * @param cache_entries
+         */
+        void cache_committed(const pending_cache_entries_t &cache_entries);
+
+        /**
+         * Checks that the transactions supplied match the transactions listed in the block
+         * in both number and order
+         *
+         * @param block
+         * @param transactions
          * @return
          */
-        [[nodiscard]] bool key_image_exists(const crypto_key_image_t &key_image) const;
+        static Error check_block_transactions(
+            const Types::Blockchain::block_t &block,
+            const std::vector<Types::Blockchain::transaction_t> &transactions);
 
         /**
-         * Checks if the specified key image exists in the database
+         * Loads the stored compression dictionaries, oldest to newest, into the transaction table
+         * (or the empty dictionary if none has been trained yet)
          *
-         * @param key_images
          * @return
          */
-        [[nodiscard]] std::map<crypto_key_image_t, bool>
-            key_image_exists(const std::vector<crypto_key_image_t> &key_images) const;
+        Error load_compression_dictionaries();
 
         /**
-         * Saves the block with the transactions specified in the database
+         * Loads the key image filter from its file if it matches the database, otherwise rebuilds
+         * it from the key image database
+         */
+        void load_key_image_filter();
+
+        /**
+         * Loads the headers of the most recent blocks into memory
+         *
+         * @return
+         */
+        Error load_recent_headers();
+
+        /**
+         * Trains the first transaction compression dictionary once enough transactions are stored
+         *
+         * Must be called while holding the write mutex.
+         */
+        void maintain_compression_dictionary();
+
+        /**
+         * Starts rebuilding the key image filter with room to grow, on a background thread, once it
+         * holds more key images than it was sized for
+         *
+         * Must be called while holding the write mutex.
+         */
+        void maintain_key_image_filter();
+
+        /**
+         * Builds the block header and block hash tables from the stored blocks when they do not hold
+         * a record for every stored block (ie. the environment predates them or a previous build of
+         * them was interrupted)
+         *
+         * @return
+         */
+        Error migrate_block_headers();
+
+        /**
+         * Rebuilds the block timestamp table from the stored blocks when the environment still
+         * holds the legacy timestamp table, which was keyed by little-endian timestamps (and
+         * therefore did not sort numerically) and kept only one block per timestamp
+         *
+         * @return
+         */
+        Error migrate_block_timestamps();
+
+        /**
+         * Moves the records of a legacy uncompressed table into the compressed table that replaces
+         * it (training the first compression dictionary from the legacy records if there are
+         * enough of them) and then deletes the legacy table
+         *
+         * Records are copied in batches of write transactions. The legacy table is only deleted
+         * once every record has been copied, so an interrupted migration is restarted from the
+         * beginning the next time the storage is opened.
+         *
+         * @param db
+         * @param legacy_name
+         * @return
+         */
+        Error migrate_compressed_database(
+            const std::shared_ptr<Database::LMDBDatabase> &db,
+            const std::string &legacy_name);
+
+        /**
+         * Copies every record of the legacy table into the destination table using the supplied
+         * callback to write each record and then deletes the legacy table
+         *
+         * Records are copied in batches of write transactions. The destination table is emptied
+         * first, so an interrupted migration is restarted from the beginning.
+         *
+         * @param legacy_db
+         * @param db
+         * @param put_record
+         * @return
+         */
+        Error migrate_database(
+            const std::shared_ptr<Database::LMDBDatabase> &legacy_db,
+            const std::shared_ptr<Database::LMDBDatabase> &db,
+            const migrate_record_t &put_record);
+
+        /**
+         * Moves the records of a legacy byte-keyed table into the sequential (integer keyed)
+         * table that replaces it and then deletes the legacy table
+         *
+         * Records are copied in batches of write transactions. The legacy table is only deleted
+         * once every record has been copied, so an interrupted migration is restarted from the
+         * beginning the next time the storage is opened.
+         *
+         * @param db
+         * @param legacy_name
+         * @return
+         */
+        Error migrate_sequential_database(
+            const std::shared_ptr<Database::LMDBDatabase> &db,
+            const std::string &legacy_name);
+
+        /**
+         * Removes the block with the given block index, which must be the top block, within the
+         * supplied write transaction
+         *
+         * @param db_tx
+         * @param block_index
+         * @return [error, undo record of the removed block]
+         */
+        std::tuple<Error, block_undo_t>
+            pop_block(std::unique_ptr<Database::LMDBTransaction> &db_tx, const uint64_t &block_index);
+
+        /**
+         * Saves the block with the transactions specified within the supplied write transaction
+         * assigning output global indexes starting at, and advancing, the global index provided
          *
+         * @param db_tx
          * @param block
+         * @param block_hash
          * @param transactions
+         * @param global_index
+         * @param cache_entries
          * @return
          */
         Error put_block(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
             const Types::Blockchain::block_t &block,
-            const std::vector<Types::Blockchain::transaction_t> &transactions);
+            const crypto_hash_t &block_hash,
+            const std::vector<Types::Blockchain::transaction_t> &transactions,
+            uint64_t &global_index,
+            pending_cache_entries_t &cache_entries);
 
-      private:
         /**
          * Saves the specified key image to the database
          *
@@ -176,15 +1075,18 @@ namespace Core
         Error put_key_image(std::unique_ptr<Database::LMDBTransaction> &db_tx, const crypto_key_image_t &key_image);
 
         /**
-         * Saves the specified transaction to the database
+         * Saves the specified transaction to the database assigning its outputs global indexes
+         * starting at, and advancing, the global index provided
          *
          * @param db_tx
          * @param transaction
-         * @return
+         * @param global_index
+         * @return [error, transaction hash, serialized size]
          */
-        std::tuple<Error, crypto_hash_t> put_transaction(
+        std::tuple<Error, crypto_hash_t, size_t> put_transaction(
             std::unique_ptr<Database::LMDBTransaction> &db_tx,
-            const Types::Blockchain::transaction_t &transaction);
+            const Types::Blockchain::transaction_t &transaction,
+            uint64_t &global_index);
 
         /**
          * Saves the specified block hash for the specified transaction hash
@@ -225,12 +1127,88 @@ namespace Core
             const uint64_t &index,
             const Types::Blockchain::transaction_output_t &output);
 
+        /**
+         * Retrieves the header of the block with the given block index if it is held in memory
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] std::optional<block_header_t> recent_header(const uint64_t &block_index) const;
+
+        /**
+         * Drops the headers of removed blocks from the recent headers held in memory
+         *
+         * @param block_count the number of blocks remaining in the database
+         */
+        void forget_headers(const uint64_t &block_count);
+
+        /**
+         * Adds the headers of newly committed blocks to the recent headers held in memory
+         *
+         * @param headers
+         */
+        void remember_headers(const std::vector<block_header_t> &headers);
+
+        /**
+         * Saves the key image filter to its file so that it does not need to be rebuilt at startup
+         */
+        void save_key_image_filter() const;
+
+        /**
+         * Trains a new transaction compression dictionary from the records of the table specified,
+         * stores it, and compresses the transactions written from now on with it
+         *
+         * Must be called while holding the write mutex (or from the constructor).
+         *
+         * @param source
+         * @return
+         */
+        Error train_dictionary(const std::shared_ptr<Database::LMDBDatabase> &source);
+
+        [[nodiscard]] std::tuple<Error, block_verification_t> verify_block(
+            std::unique_ptr<Database::LMDBTransaction> &db_tx,
+            const uint64_t &block_index,
+            bool validate_construction) const;
+
         std::shared_ptr<Database::LMDB> m_db_env;
 
         std::shared_ptr<Database::LMDBDatabase> m_blocks, m_block_indexes, m_block_timestamps, m_transactions,
-            m_key_images, m_global_indexes, m_transaction_indexes, m_transaction_block_hashes;
+            m_key_images, m_global_indexes, m_transaction_indexes, m_transaction_block_hashes, m_block_headers,
+            m_block_hash_indexes, m_block_undo, m_compression_dictionaries;
 
         std::mutex write_mutex;
+
+        mutable block_cache_t m_block_cache;
+
+        mutable transaction_cache_t m_transaction_cache;
+
+        /**
+         * The first snapshot (transaction ID) taken after blocks were last popped; values read from
+         * older snapshots may include the popped blocks and are not added to the caches
+         */
+        std::atomic<size_t> m_cache_floor;
+
+        KeyImageFilter m_key_image_filter;
+
+        std::string m_key_image_filter_path;
+
+        std::atomic<bool> m_key_image_filter_valid;
+
+        std::atomic<bool> m_key_image_filter_rebuilding;
+
+        std::thread m_key_image_filter_thread;
+
+        /**
+         * The headers of the most recent blocks, each held at its block index modulo the size of
+         * the ring, covering the block indexes from the first (inclusive) to the end (exclusive)
+         */
+        mutable std::shared_mutex m_recent_headers_mutex;
+
+        std::vector<block_header_t> m_recent_headers;
+
+        uint64_t m_recent_headers_first, m_recent_headers_end;
+
+        bool m_transaction_dictionary_trained;
     };
 } // namespace Core
 
@@ -0,0 +1,106 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "chain_verifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace Core
+{
+    verification_info_t verify_blockchain(
+        const std::shared_ptr<BlockchainStorage> &storage,
+        size_t threads,
+        bool validate_construction,
+        const verification_progress_t &progress)
+    {
+        verification_info_t info;
+
+        // blocks stored once the verification has started are not verified
+        const uint64_t block_count = storage->get_block_count();
+
+        info.block_count = block_count;
+
+        std::atomic<uint64_t> next_block(0);
+
+        std::mutex info_mutex;
+
+        const auto worker = [&]()
+        {
+            while (true)
+            {
+                const uint64_t first = next_block.fetch_add(Configuration::Database::VERIFY_BLOCKS_PER_CHUNK);
+
+                if (first >= block_count)
+                {
+                    break;
+                }
+
+                const auto last =
+                    std::min<uint64_t>(first + Configuration::Database::VERIFY_BLOCKS_PER_CHUNK, block_count);
+
+                verification_info_t chunk;
+
+                {
+                    auto session = storage->read_session();
+
+                    for (auto block_index = first; block_index < last; ++block_index)
+                    {
+                        const auto [error, counts] = session->verify_block(block_index, validate_construction);
+
+                        if (error)
+                        {
+                            chunk.failures.emplace_back(block_index, error);
+                        }
+
+                        chunk.blocks++;
+
+                        chunk.transactions += counts.transactions;
+
+                        chunk.outputs += counts.outputs;
+
+                        chunk.key_images += counts.key_images;
+                    }
+                }
+
+                std::scoped_lock lock(info_mutex);
+
+                info.blocks += chunk.blocks;
+
+                info.transactions += chunk.transactions;
+
+                info.outputs += chunk.outputs;
+
+                info.key_images += chunk.key_images;
+
+                info.failures.insert(info.failures.end(), chunk.failures.begin(), chunk.failures.end());
+
+                if (progress)
+                {
+                    progress(info);
+                }
+            }
+        };
+
+        std::vector<std::thread> workers;
+
+        for (size_t i = 0; i < std::max(threads, size_t(1)); ++i)
+        {
+            workers.emplace_back(worker);
+        }
+
+        for (auto &thread : workers)
+        {
+            thread.join();
+        }
+
+        std::sort(
+            info.failures.begin(),
+            info.failures.end(),
+            [](const auto &a, const auto &b) { return std::get<0>(a) < std::get<0>(b); });
+
+        return info;
+    }
+} // namespace Core
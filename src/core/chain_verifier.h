@@ -0,0 +1,62 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_CHAIN_VERIFIER_H
+#define CORE_CHAIN_VERIFIER_H
+
+#include <blockchain_storage.h>
+#include <functional>
+#include <thread>
+
+namespace Core
+{
+    /**
+     * The running totals of a verification of the stored blockchain
+     */
+    struct verification_info_t
+    {
+        uint64_t block_count = 0;
+
+        uint64_t blocks = 0;
+
+        uint64_t transactions = 0;
+
+        uint64_t outputs = 0;
+
+        uint64_t key_images = 0;
+
+        /**
+         * The block index and error of every block that failed verification
+         */
+        std::vector<std::tuple<uint64_t, Error>> failures;
+    };
+
+    /**
+     * Called with the running totals of a verification each time a chunk of blocks is verified
+     */
+    typedef std::function<void(const verification_info_t &)> verification_progress_t;
+
+    /**
+     * Re-verifies every block held in the blockchain storage (see BlockchainReadSession::verify_block)
+     *
+     * The block indexes are split into chunks of VERIFY_BLOCKS_PER_CHUNK blocks that are handed to the
+     * worker threads as they finish their previous chunk. Each chunk is verified within its own read
+     * session, so every block is checked against a consistent snapshot of the database without a
+     * single read transaction being held open for the whole run, which allows the verification to run
+     * against the database of a running node.
+     *
+     * @param storage
+     * @param threads
+     * @param validate_construction
+     * @param progress
+     * @return the totals of the verification with its failures in block index order
+     */
+    verification_info_t verify_blockchain(
+        const std::shared_ptr<BlockchainStorage> &storage,
+        size_t threads = std::thread::hardware_concurrency(),
+        bool validate_construction = false,
+        const verification_progress_t &progress = nullptr);
+} // namespace Core
+
+#endif // CORE_CHAIN_VERIFIER_H
@@ -0,0 +1,353 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "election_scheduler.h"
+
+namespace Core
+{
+    ElectionScheduler::ElectionScheduler(
+        std::shared_ptr<BlockchainStorage> storage,
+        std::shared_ptr<StakingEngine> staking,
+        size_t cache_rounds):
+        m_storage(std::move(storage)),
+        m_staking(std::move(staking)),
+        m_cache(cache_rounds, 1),
+        m_generation(0),
+        m_queued_count(0),
+        m_elected_count(0),
+        m_running(true),
+        m_elections(0),
+        m_failed(0),
+        m_hits(0),
+        m_misses(0)
+    {
+        m_thread = std::thread(&ElectionScheduler::election_thread, this);
+    }
+
+    ElectionScheduler::~ElectionScheduler()
+    {
+        stop();
+    }
+
+    void ElectionScheduler::blocks_popped(const uint64_t &from_index)
+    {
+        // the seeds (and tallies) of the rounds after the round of the first popped block no longer exist
+        const auto last_round = round_of(from_index);
+
+        {
+            std::scoped_lock lock(m_mutex);
+
+            const auto queued = m_queue.size();
+
+            m_queue.erase(
+                std::remove_if(
+                    m_queue.begin(), m_queue.end(), [last_round](const auto &round) { return round > last_round; }),
+                m_queue.end());
+
+            // the dropped elections are counted as run so that flush() does not wait on them
+            m_elected_count += queued - m_queue.size();
+        }
+
+        m_elected.notify_all();
+
+        std::unique_lock lock(m_recent_mutex);
+
+        // elections already running were elected from the popped blocks and must not fill the slots
+        m_generation++;
+
+        for (auto &slot : m_recent)
+        {
+            if (slot && slot->round > last_round)
+            {
+                slot = nullptr;
+            }
+        }
+    }
+
+    void ElectionScheduler::block_stored(const uint64_t &block_index)
+    {
+        // only the final block of a round completes the seed of the next round
+        if ((block_index + 1) % Configuration::Consensus::BLOCKS_PER_ROUND != 0)
+        {
+            return;
+        }
+
+        {
+            std::scoped_lock lock(m_mutex);
+
+            if (!m_running)
+            {
+                return;
+            }
+
+            m_queue.push_back(round_of(block_index) + 1);
+
+            m_queued_count++;
+        }
+
+        m_queued.notify_one();
+    }
+
+    std::tuple<Error, std::shared_ptr<const election_result_t>> ElectionScheduler::elect(const uint64_t &round)
+    {
+        auto result = std::make_shared<election_result_t>();
+
+        result->round = round;
+
+        // the first round has no preceding round to elect from and is left to the permanent candidates
+        if (round == 0)
+        {
+            result->producers = Configuration::Consensus::PERMANENT_CANDIDATES;
+
+            result->validators = Configuration::Consensus::PERMANENT_CANDIDATES;
+        }
+        else
+        {
+            // the seed is accumulated by the staking engine as the blocks of the preceding round are applied
+            auto [seed_error, seed] = m_staking->get_round_seed(round - 1);
+
+            // the engine did not see every block of the round (ie. it started part way through it)
+            if (seed_error == STAKING_ROUND_INCOMPLETE)
+            {
+                const auto first_block_index = (round - 1) * Configuration::Consensus::BLOCKS_PER_ROUND;
+
+                const auto last_block_index = first_block_index + Configuration::Consensus::BLOCKS_PER_ROUND - 1;
+
+                const auto [error, block_hashes] = m_storage->get_block_hashes(first_block_index, last_block_index);
+
+                if (error)
+                {
+                    return {error, nullptr};
+                }
+
+                const auto restore_error = m_staking->restore_round_seed(round - 1, block_hashes);
+
+                if (restore_error)
+                {
+                    return {restore_error, nullptr};
+                }
+
+                std::tie(seed_error, seed) = m_staking->get_round_seed(round - 1);
+            }
+
+            if (seed_error)
+            {
+                return {seed_error, nullptr};
+            }
+
+            result->seed = seed;
+
+            // the round may already have been elected and been evicted from its slot by a later round
+            if (const auto cached = m_cache.get(result->seed))
+            {
+                return {MAKE_ERROR(SUCCESS), *cached};
+            }
+
+            // the tallies are those saved at the final block of the preceding round, not the current tallies
+            const auto [tally_error, tallies] = m_staking->get_round_tallies(round - 1);
+
+            if (tally_error)
+            {
+                return {tally_error, nullptr};
+            }
+
+            std::tie(result->producers, result->validators) = m_staking->run_election(result->seed, tallies);
+
+            m_elections++;
+        }
+
+        result->producer_keys.insert(result->producers.begin(), result->producers.end());
+
+        result->validator_keys.insert(result->validators.begin(), result->validators.end());
+
+        return {MAKE_ERROR(SUCCESS), result};
+    }
+
+    void ElectionScheduler::election_thread()
+    {
+        while (true)
+        {
+            uint64_t round;
+
+            {
+                std::unique_lock lock(m_mutex);
+
+                m_queued.wait(lock, [this] { return !m_queue.empty() || !m_running; });
+
+                if (m_queue.empty())
+                {
+                    break;
+                }
+
+                round = m_queue.front();
+
+                m_queue.pop_front();
+            }
+
+            const auto [error, result] = get_election(round);
+
+            if (error)
+            {
+                m_failed++;
+            }
+
+            {
+                std::scoped_lock lock(m_mutex);
+
+                m_elected_count++;
+            }
+
+            m_elected.notify_all();
+        }
+    }
+
+    void ElectionScheduler::flush()
+    {
+        std::unique_lock lock(m_mutex);
+
+        const auto target = m_queued_count;
+
+        m_elected.wait(lock, [this, target] { return m_elected_count >= target; });
+    }
+
+    std::tuple<Error, std::shared_ptr<const election_result_t>> ElectionScheduler::get_election(const uint64_t &round)
+    {
+        if (auto result = recent(round))
+        {
+            m_hits++;
+
+            return {MAKE_ERROR(SUCCESS), result};
+        }
+
+        m_misses++;
+
+        const auto generation = current_generation();
+
+        const auto [error, result] = elect(round);
+
+        if (error)
+        {
+            return {error, nullptr};
+        }
+
+        remember(result, generation);
+
+        return {MAKE_ERROR(SUCCESS), result};
+    }
+
+    std::shared_ptr<const election_result_t> ElectionScheduler::get_election_by_seed(const crypto_hash_t &seed)
+    {
+        if (const auto result = m_cache.get(seed))
+        {
+            return *result;
+        }
+
+        return nullptr;
+    }
+
+    bool ElectionScheduler::is_producer(const uint64_t &round, const crypto_public_key_t &key)
+    {
+        const auto [error, result] = get_election(round);
+
+        return !error && result->is_producer(key);
+    }
+
+    bool ElectionScheduler::is_validator(const uint64_t &round, const crypto_public_key_t &key)
+    {
+        const auto [error, result] = get_election(round);
+
+        return !error && result->is_validator(key);
+    }
+
+    size_t ElectionScheduler::pending() const
+    {
+        std::scoped_lock lock(m_mutex);
+
+        return m_queue.size();
+    }
+
+    std::shared_ptr<const election_result_t> ElectionScheduler::recent(const uint64_t &round) const
+    {
+        std::shared_lock lock(m_recent_mutex);
+
+        const auto &result = m_recent[round % 2];
+
+        if (result && result->round == round)
+        {
+            return result;
+        }
+
+        return nullptr;
+    }
+
+    void ElectionScheduler::remember(const std::shared_ptr<const election_result_t> &result, uint64_t generation)
+    {
+        // the round seed of the first round is not derived from any blocks and is not worth caching
+        if (result->round != 0)
+        {
+            m_cache.insert(result->seed, result, 1);
+        }
+
+        std::unique_lock lock(m_recent_mutex);
+
+        // blocks were popped while the round was being elected, so its seed may no longer be current
+        if (generation != m_generation)
+        {
+            return;
+        }
+
+        auto &slot = m_recent[result->round % 2];
+
+        // a past round elected on demand does not displace a later round from the slot
+        if (!slot || slot->round <= result->round)
+        {
+            slot = result;
+        }
+    }
+
+    uint64_t ElectionScheduler::current_generation() const
+    {
+        std::shared_lock lock(m_recent_mutex);
+
+        return m_generation;
+    }
+
+    uint64_t ElectionScheduler::round_of(const uint64_t &block_index)
+    {
+        return block_index / Configuration::Consensus::BLOCKS_PER_ROUND;
+    }
+
+    ElectionScheduler::stats_t ElectionScheduler::stats() const
+    {
+        stats_t result;
+
+        result.elections = m_elections;
+
+        result.failed = m_failed;
+
+        result.hits = m_hits;
+
+        result.misses = m_misses;
+
+        return result;
+    }
+
+    void ElectionScheduler::stop()
+    {
+        {
+            std::scoped_lock lock(m_mutex);
+
+            m_running = false;
+        }
+
+        m_queued.notify_all();
+
+        m_elected.notify_all();
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+} // namespace Core
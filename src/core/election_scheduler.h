@@ -0,0 +1,279 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_ELECTION_SCHEDULER_H
+#define CORE_ELECTION_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <blockchain_storage.h>
+#include <condition_variable>
+#include <config.h>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <staking_engine.h>
+#include <thread>
+#include <unordered_set>
+
+namespace Core
+{
+    /**
+     * Hashes a public key using its leading bytes as they are already uniformly distributed
+     */
+    struct public_key_hash_t
+    {
+        size_t operator()(const crypto_public_key_t &key) const
+        {
+            size_t result = 0;
+
+            std::memcpy(&result, key.data(), sizeof(result));
+
+            return result;
+        }
+    };
+
+    /**
+     * The producers and validators elected for a round along with the round seed (M) from which
+     * they were elected
+     */
+    struct election_result_t
+    {
+        /**
+         * Checks whether the given key was elected as a producer for the round
+         *
+         * @param key
+         * @return
+         */
+        [[nodiscard]] bool is_producer(const crypto_public_key_t &key) const
+        {
+            return producer_keys.find(key) != producer_keys.end();
+        }
+
+        /**
+         * Checks whether the given key was elected as a validator for the round
+         *
+         * @param key
+         * @return
+         */
+        [[nodiscard]] bool is_validator(const crypto_public_key_t &key) const
+        {
+            return validator_keys.find(key) != validator_keys.end();
+        }
+
+        uint64_t round = 0;
+
+        crypto_hash_t seed;
+
+        std::vector<crypto_public_key_t> producers, validators;
+
+        std::unordered_set<crypto_public_key_t, public_key_hash_t> producer_keys, validator_keys;
+    };
+
+    typedef ThreadSafeLRUCache<crypto_hash_t, std::shared_ptr<const election_result_t>, hash_shard_t>
+        election_cache_t;
+
+    /**
+     * Elects the producers and validators of each round ahead of time so that they do not have
+     * to be elected on the block validation path
+     *
+     * Once the final block of a round is stored, block_stored() queues the election of the next
+     * round which is then run on a background thread. The two most recently elected rounds are
+     * held in slots indexed by the round number, which answers the producer and validator
+     * lookups of the current and next rounds in constant time, and every result is also held in
+     * an LRU cache keyed by its round seed for peers asking about the elections of past rounds.
+     *
+     * Every election uses the vote tallies saved by the staking engine at the final block of the
+     * preceding round, so the result of a round does not depend on when its election is run.
+     *
+     * Please note: blocks_popped() must be called when blocks are popped from the chain so that
+     * the elections of the rounds whose seeds were popped are dropped; the slots are not checked
+     * against the current round seeds when they are read.
+     */
+    class ElectionScheduler
+    {
+      public:
+        struct stats_t
+        {
+            size_t elections = 0;
+
+            size_t failed = 0;
+
+            size_t hits = 0;
+
+            size_t misses = 0;
+        };
+
+        /**
+         * Creates a new election scheduler and starts its election thread
+         *
+         * @param storage the blocks of rounds the staking engine did not see from their start are read from
+         * @param staking
+         * @param cache_rounds the number of election results held in the cache
+         */
+        ElectionScheduler(
+            std::shared_ptr<BlockchainStorage> storage,
+            std::shared_ptr<StakingEngine> staking,
+            size_t cache_rounds = Configuration::Database::ELECTION_CACHE_ROUNDS);
+
+        /**
+         * Destroying the instance stops the election thread after it has run every queued election
+         */
+        ~ElectionScheduler();
+
+        /**
+         * Notifies the scheduler that the blocks from the given index onwards have been popped from
+         * the chain; the queued elections and the slots of the rounds elected from the popped blocks
+         * are dropped
+         *
+         * @param from_index the index of the first block popped
+         */
+        void blocks_popped(const uint64_t &from_index);
+
+        /**
+         * Notifies the scheduler that the block with the given index has been stored; if the block
+         * is the final block of a round, the election of the next round is queued
+         *
+         * @param block_index
+         */
+        void block_stored(const uint64_t &block_index);
+
+        /**
+         * Blocks until every election queued before the call has been run
+         */
+        void flush();
+
+        /**
+         * Retrieves the election result of the given round, running the election if the result is
+         * not already held in memory
+         *
+         * @param round
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::shared_ptr<const election_result_t>> get_election(const uint64_t &round);
+
+        /**
+         * Retrieves the cached election result elected from the given round seed (M)
+         *
+         * @param seed
+         * @return the result, or nullptr if it is no longer held in the cache
+         */
+        [[nodiscard]] std::shared_ptr<const election_result_t> get_election_by_seed(const crypto_hash_t &seed);
+
+        /**
+         * Checks whether the given key was elected as a producer of the given round
+         *
+         * @param round
+         * @param key
+         * @return
+         */
+        [[nodiscard]] bool is_producer(const uint64_t &round, const crypto_public_key_t &key);
+
+        /**
+         * Checks whether the given key was elected as a validator of the given round
+         *
+         * @param round
+         * @param key
+         * @return
+         */
+        [[nodiscard]] bool is_validator(const uint64_t &round, const crypto_public_key_t &key);
+
+        /**
+         * Returns the number of elections waiting to be run
+         *
+         * @return
+         */
+        [[nodiscard]] size_t pending() const;
+
+        /**
+         * Returns the round that the block with the given index belongs to
+         *
+         * @param block_index
+         * @return
+         */
+        [[nodiscard]] static uint64_t round_of(const uint64_t &block_index);
+
+        /**
+         * Retrieves the counters of the scheduler
+         *
+         * @return
+         */
+        [[nodiscard]] stats_t stats() const;
+
+        /**
+         * Stops accepting elections and stops the election thread once every queued election is run
+         */
+        void stop();
+
+      private:
+        /**
+         * Runs the election of the given round from the seed and the vote tallies saved by the
+         * staking engine at the final block of the preceding round; if the engine did not see
+         * every block of the preceding round, its seed is restored from the stored block hashes
+         *
+         * @param round
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::shared_ptr<const election_result_t>> elect(const uint64_t &round);
+
+        /**
+         * Returns the number of times that blocks have been popped, which is taken before a round is
+         * elected so that its result is kept out of the slots if blocks are popped in the meantime
+         *
+         * @return
+         */
+        [[nodiscard]] uint64_t current_generation() const;
+
+        /**
+         * Places the election result in the cache and, unless blocks were popped since the given
+         * generation was taken, in the slot of its round
+         *
+         * @param result
+         * @param generation
+         */
+        void remember(const std::shared_ptr<const election_result_t> &result, uint64_t generation);
+
+        /**
+         * Retrieves the election result of the given round from its slot
+         *
+         * @param round
+         * @return the result, or nullptr if the slot holds a different round
+         */
+        [[nodiscard]] std::shared_ptr<const election_result_t> recent(const uint64_t &round) const;
+
+        /**
+         * The thread that runs the queued elections
+         */
+        void election_thread();
+
+        std::shared_ptr<BlockchainStorage> m_storage;
+
+        std::shared_ptr<StakingEngine> m_staking;
+
+        election_cache_t m_cache;
+
+        mutable std::shared_mutex m_recent_mutex;
+
+        std::shared_ptr<const election_result_t> m_recent[2];
+
+        uint64_t m_generation;
+
+        mutable std::mutex m_mutex;
+
+        std::condition_variable m_queued, m_elected;
+
+        std::deque<uint64_t> m_queue;
+
+        size_t m_queued_count, m_elected_count;
+
+        std::atomic<bool> m_running;
+
+        std::thread m_thread;
+
+        std::atomic<size_t> m_elections, m_failed, m_hits, m_misses;
+    };
+} // namespace Core
+
+#endif // CORE_ELECTION_SCHEDULER_H
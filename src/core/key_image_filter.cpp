@@ -0,0 +1,343 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "key_image_filter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#define KEY_IMAGE_FILTER_MAGIC 0x524C544649494B54
+#define KEY_IMAGE_FILTER_VERSION 1
+#define KEY_IMAGE_FILTER_BLOCK_BITS 512
+#define KEY_IMAGE_FILTER_WORDS_PER_BLOCK (KEY_IMAGE_FILTER_BLOCK_BITS / 64)
+#define KEY_IMAGE_FILTER_PROBES 8
+
+namespace Core
+{
+    KeyImageFilter::KeyImageFilter(size_t capacity): m_blocks(0), m_capacity(0), m_count(0), m_journaling(false)
+    {
+        resize(capacity);
+    }
+
+    void KeyImageFilter::begin_rebuild()
+    {
+        std::scoped_lock lock(m_journal_mutex);
+
+        m_journaling = true;
+    }
+
+    size_t KeyImageFilter::block_count(size_t capacity)
+    {
+        const auto bits = std::max<size_t>(capacity, 1) * Configuration::Database::KEY_IMAGE_FILTER_BITS_PER_KEY;
+
+        return (bits + KEY_IMAGE_FILTER_BLOCK_BITS - 1) / KEY_IMAGE_FILTER_BLOCK_BITS;
+    }
+
+    size_t KeyImageFilter::capacity() const
+    {
+        return m_capacity;
+    }
+
+    bool KeyImageFilter::contains(const crypto_key_image_t &key_image) const
+    {
+        std::shared_lock lock(m_mutex);
+
+        const auto data = key_image.data();
+
+        uint64_t block, start, stride;
+
+        std::memcpy(&block, data, sizeof(block));
+
+        std::memcpy(&start, data + 8, sizeof(start));
+
+        std::memcpy(&stride, data + 16, sizeof(stride));
+
+        // an odd stride guarantees that every probe lands on a different bit of the block
+        stride |= 1;
+
+        const auto words = &m_words[(block % m_blocks) * KEY_IMAGE_FILTER_WORDS_PER_BLOCK];
+
+        for (size_t i = 0; i < KEY_IMAGE_FILTER_PROBES; ++i)
+        {
+            const auto bit = (start + i * stride) % KEY_IMAGE_FILTER_BLOCK_BITS;
+
+            if ((words[bit / 64].load(std::memory_order_acquire) & (uint64_t(1) << (bit % 64))) == 0)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    size_t KeyImageFilter::count() const
+    {
+        return m_count;
+    }
+
+    void KeyImageFilter::insert(const crypto_key_image_t &key_image)
+    {
+        std::shared_lock lock(m_mutex);
+
+        set_bits(m_words, m_blocks, key_image.data());
+
+        m_count++;
+
+        std::scoped_lock journal_lock(m_journal_mutex);
+
+        if (m_journaling)
+        {
+            m_journal.push_back(key_image);
+        }
+    }
+
+    Error KeyImageFilter::load(const std::string &path, uint64_t txn_id, size_t key_image_count)
+    {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+
+        if (!file)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Could not open key image filter file.");
+        }
+
+        // magic, version, transaction ID, key image count, capacity, inserted count, blocks
+        uint64_t header[7] = {0};
+
+        file.read(reinterpret_cast<char *>(header), sizeof(header));
+
+        if (!file || header[0] != KEY_IMAGE_FILTER_MAGIC || header[1] != KEY_IMAGE_FILTER_VERSION)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Key image filter file is not recognized.");
+        }
+
+        if (header[2] != txn_id || header[3] != key_image_count)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Key image filter file does not match the database.");
+        }
+
+        const auto blocks = header[6];
+
+        if (blocks == 0)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Key image filter file is empty.");
+        }
+
+        std::vector<uint64_t> words(blocks * KEY_IMAGE_FILTER_WORDS_PER_BLOCK);
+
+        file.read(reinterpret_cast<char *>(words.data()), words.size() * sizeof(uint64_t));
+
+        if (!file)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Key image filter file is truncated.");
+        }
+
+        std::unique_lock lock(m_mutex);
+
+        m_words = std::vector<std::atomic<uint64_t>>(words.size());
+
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        m_blocks = blocks;
+
+        m_capacity = header[4];
+
+        m_count = header[5];
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    Error KeyImageFilter::rebuild(
+        const std::shared_ptr<Database::LMDBDatabase> &db,
+        size_t capacity,
+        size_t threads)
+    {
+        std::scoped_lock rebuild_lock(m_rebuild_mutex);
+
+        begin_rebuild();
+
+        capacity = std::max<size_t>(capacity, 1);
+
+        const auto blocks = block_count(capacity);
+
+        std::vector<std::atomic<uint64_t>> words(blocks * KEY_IMAGE_FILTER_WORDS_PER_BLOCK);
+
+        // the key space is split on the leading byte, so there is no use for more than 256 threads
+        threads = std::min<size_t>(std::max<size_t>(threads, 1), 256);
+
+        std::vector<std::thread> workers;
+
+        std::vector<Error> errors(threads);
+
+        std::atomic<size_t> inserted(0);
+
+        for (size_t i = 0; i < threads; ++i)
+        {
+            const size_t first_prefix = (i * 256) / threads, last_prefix = ((i + 1) * 256) / threads;
+
+            workers.emplace_back(
+                [&db, &words, &errors, &inserted, blocks, i, first_prefix, last_prefix]()
+                {
+                    auto txn = db->transaction(true);
+
+                    auto cursor = txn->cursor();
+
+                    // position the cursor at the first key that begins with our first prefix
+                    std::vector<uint8_t> start_key(32, 0);
+
+                    start_key[0] = uint8_t(first_prefix);
+
+                    Error error;
+
+                    Database::LMDBValueView key, value;
+
+                    for (std::tie(error, key, value) = cursor->get_view(start_key, MDB_SET_RANGE); !error;
+                         std::tie(error, key, value) = cursor->get_view(MDB_NEXT))
+                    {
+                        if (key.size() < 24 || key.data()[0] >= last_prefix)
+                        {
+                            break;
+                        }
+
+                        set_bits(words, blocks, key.data());
+
+                        inserted++;
+                    }
+
+                    if (error && error != LMDB_NOTFOUND)
+                    {
+                        errors[i] = error;
+                    }
+                });
+        }
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+
+        for (const auto &error : errors)
+        {
+            if (error)
+            {
+                std::scoped_lock journal_lock(m_journal_mutex);
+
+                m_journal.clear();
+
+                m_journaling = false;
+
+                return error;
+            }
+        }
+
+        std::unique_lock lock(m_mutex);
+
+        std::scoped_lock journal_lock(m_journal_mutex);
+
+        // the key images inserted during the scan may not have been committed when it read the database
+        for (const auto &key_image : m_journal)
+        {
+            set_bits(words, blocks, key_image.data());
+        }
+
+        m_words = std::move(words);
+
+        m_blocks = blocks;
+
+        m_capacity = capacity;
+
+        m_count = inserted.load() + m_journal.size();
+
+        m_journal.clear();
+
+        m_journaling = false;
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    void KeyImageFilter::reset(size_t capacity)
+    {
+        std::unique_lock lock(m_mutex);
+
+        resize(capacity);
+    }
+
+    void KeyImageFilter::resize(size_t capacity)
+    {
+        m_capacity = std::max<size_t>(capacity, 1);
+
+        m_blocks = block_count(m_capacity);
+
+        m_words = std::vector<std::atomic<uint64_t>>(m_blocks * KEY_IMAGE_FILTER_WORDS_PER_BLOCK);
+
+        m_count = 0;
+    }
+
+    bool KeyImageFilter::saturated() const
+    {
+        return m_count > m_capacity;
+    }
+
+    Error KeyImageFilter::save(const std::string &path, uint64_t txn_id, size_t key_image_count) const
+    {
+        std::shared_lock lock(m_mutex);
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!file)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Could not create key image filter file.");
+        }
+
+        const uint64_t header[7] = {KEY_IMAGE_FILTER_MAGIC,
+                                    KEY_IMAGE_FILTER_VERSION,
+                                    txn_id,
+                                    key_image_count,
+                                    m_capacity,
+                                    m_count,
+                                    m_blocks};
+
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+        for (const auto &word : m_words)
+        {
+            const uint64_t value = word.load(std::memory_order_relaxed);
+
+            file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+        }
+
+        if (!file)
+        {
+            return MAKE_ERROR_MSG(DB_KEY_IMAGE_FILTER_INVALID, "Could not write key image filter file.");
+        }
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    void KeyImageFilter::set_bits(std::vector<std::atomic<uint64_t>> &words, size_t blocks, const uint8_t *data)
+    {
+        uint64_t block, start, stride;
+
+        std::memcpy(&block, data, sizeof(block));
+
+        std::memcpy(&start, data + 8, sizeof(start));
+
+        std::memcpy(&stride, data + 16, sizeof(stride));
+
+        // an odd stride guarantees that every probe lands on a different bit of the block
+        stride |= 1;
+
+        const auto block_words = &words[(block % blocks) * KEY_IMAGE_FILTER_WORDS_PER_BLOCK];
+
+        for (size_t i = 0; i < KEY_IMAGE_FILTER_PROBES; ++i)
+        {
+            const auto bit = (start + i * stride) % KEY_IMAGE_FILTER_BLOCK_BITS;
+
+            block_words[bit / 64].fetch_or(uint64_t(1) << (bit % 64), std::memory_order_release);
+        }
+    }
+} // namespace Core
@@ -0,0 +1,181 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_KEY_IMAGE_FILTER_H
+#define CORE_KEY_IMAGE_FILTER_H
+
+#include <atomic>
+#include <config.h>
+#include <db_lmdb.h>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace Core
+{
+    /**
+     * A blocked Bloom filter over key images that sits in front of the key image database
+     *
+     * Every key image sets all of its bits within a single 512-bit (one cache line) block so that
+     * a lookup costs at most one cache miss. As key images are already uniformly distributed, their
+     * own bytes are used as the hash values. The filter never produces a false negative: if it
+     * reports that a key image is not present then the key image has never been inserted.
+     *
+     * Lookups and inserts may be performed concurrently; however, reset() and load() require
+     * exclusive access and will block both. rebuild() builds the new filter alongside the current
+     * one and only blocks lookups and inserts while the new filter is swapped in.
+     */
+    class KeyImageFilter
+    {
+      public:
+        /**
+         * Creates a new empty filter sized for the specified number of key images
+         *
+         * @param capacity
+         */
+        KeyImageFilter(size_t capacity = Configuration::Database::KEY_IMAGE_FILTER_MINIMUM_CAPACITY);
+
+        /**
+         * Returns the number of key images the filter was sized for
+         *
+         * @return
+         */
+        [[nodiscard]] size_t capacity() const;
+
+        /**
+         * Starts recording the key images inserted from now on so that they are replayed into the
+         * filter built by the next call to rebuild()
+         *
+         * Must be called while no inserted key image is waiting to be committed to the database
+         * (ie. while holding the write mutex of the storage) if the rebuild is started later on
+         * another thread, as the key images committed after that thread begins reading the
+         * database are only found in the record.
+         */
+        void begin_rebuild();
+
+        /**
+         * Checks whether the key image may have been inserted into the filter
+         *
+         * @param key_image
+         * @return false if the key image has definitely not been inserted
+         */
+        [[nodiscard]] bool contains(const crypto_key_image_t &key_image) const;
+
+        /**
+         * Returns the number of key images inserted into the filter
+         *
+         * @return
+         */
+        [[nodiscard]] size_t count() const;
+
+        /**
+         * Inserts the key image into the filter
+         *
+         * @param key_image
+         */
+        void insert(const crypto_key_image_t &key_image);
+
+        /**
+         * Loads the filter from the specified file if it was saved at the specified LMDB transaction
+         * ID with the specified number of key images
+         *
+         * @param path
+         * @param txn_id
+         * @param key_image_count
+         * @return
+         */
+        Error load(const std::string &path, uint64_t txn_id, size_t key_image_count);
+
+        /**
+         * Clears the filter and resizes it for the specified number of key images
+         *
+         * @param capacity
+         */
+        void reset(size_t capacity);
+
+        /**
+         * Builds a new filter sized for the specified number of key images from every key image
+         * found in the database and then replaces the current filter with it
+         *
+         * The key space is split by leading byte into ranges that are each scanned by a separate
+         * thread using its own read transaction. The current filter remains in use during the scan;
+         * the key images inserted since begin_rebuild() (which is called here if it was not already)
+         * are replayed into the new filter as it is swapped in. If the scan fails, the current filter
+         * is kept.
+         *
+         * @param db
+         * @param capacity
+         * @param threads
+         * @return
+         */
+        Error rebuild(
+            const std::shared_ptr<Database::LMDBDatabase> &db,
+            size_t capacity,
+            size_t threads = std::thread::hardware_concurrency());
+
+        /**
+         * Returns whether more key images have been inserted than the filter was sized for, at which
+         * point the false positive rate climbs and the filter should be rebuilt with a larger capacity
+         *
+         * @return
+         */
+        [[nodiscard]] bool saturated() const;
+
+        /**
+         * Saves the filter to the specified file tagged with the specified LMDB transaction ID
+         * and number of key images
+         *
+         * @param path
+         * @param txn_id
+         * @param key_image_count
+         * @return
+         */
+        Error save(const std::string &path, uint64_t txn_id, size_t key_image_count) const;
+
+      private:
+        /**
+         * Returns the number of blocks needed for the specified number of key images
+         *
+         * @param capacity
+         * @return
+         */
+        static size_t block_count(size_t capacity);
+
+        /**
+         * Sets the bits for the key image in the given blocks using the first 24 bytes of the key image
+         *
+         * @param words
+         * @param blocks
+         * @param data
+         */
+        static void set_bits(std::vector<std::atomic<uint64_t>> &words, size_t blocks, const uint8_t *data);
+
+        /**
+         * Allocates a zeroed set of blocks sized for the specified number of key images
+         *
+         * @param capacity
+         */
+        void resize(size_t capacity);
+
+        mutable std::shared_mutex m_mutex;
+
+        std::vector<std::atomic<uint64_t>> m_words;
+
+        size_t m_blocks, m_capacity;
+
+        std::atomic<size_t> m_count;
+
+        std::mutex m_rebuild_mutex, m_journal_mutex;
+
+        /**
+         * The key images inserted since begin_rebuild() was called, while m_journaling is set
+         */
+        std::vector<crypto_key_image_t> m_journal;
+
+        bool m_journaling;
+    };
+} // namespace Core
+
+#endif // CORE_KEY_IMAGE_FILTER_H
@@ -0,0 +1,155 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "merkle_frontier.h"
+
+namespace Core
+{
+    /**
+     * Combines two nodes of the tree exactly as root_hash() combines a pair of hashes
+     *
+     * @param left
+     * @param right
+     * @return
+     */
+    static inline crypto_hash_t combine(const crypto_hash_t &left, const crypto_hash_t &right)
+    {
+        return Crypto::Hashing::Merkle::root_hash({left, right});
+    }
+
+    merkle_frontier_t::merkle_frontier_t(size_t leaf_count): leaf_count(leaf_count)
+    {
+        if (leaf_count == 0)
+        {
+            throw std::invalid_argument("merkle frontier must hold at least one hash");
+        }
+
+        const auto [width, depth] = tree();
+
+        levels.resize(depth + 1);
+    }
+
+    merkle_frontier_t::merkle_frontier_t(const std::vector<uint8_t> &data)
+    {
+        deserializer_t reader(data);
+
+        leaf_count = reader.varint<uint64_t>();
+
+        leaves = reader.varint<uint64_t>();
+
+        pending = reader.key<crypto_hash_t>();
+
+        levels = reader.keyV<crypto_hash_t>();
+
+        if (leaf_count == 0 || leaves > leaf_count || levels.size() != std::get<1>(tree()) + 1)
+        {
+            throw std::invalid_argument("merkle frontier record is not valid");
+        }
+    }
+
+    void merkle_frontier_t::append(const crypto_hash_t &hash)
+    {
+        if (complete())
+        {
+            throw std::range_error("merkle frontier already holds every hash");
+        }
+
+        const auto index = leaves++;
+
+        if (index < unpaired())
+        {
+            push(hash);
+        }
+        else if ((index - unpaired()) % 2 == 0)
+        {
+            pending = hash;
+        }
+        else
+        {
+            push(combine(pending, hash));
+
+            pending = crypto_hash_t();
+        }
+    }
+
+    bool merkle_frontier_t::complete() const
+    {
+        return leaves == leaf_count;
+    }
+
+    uint64_t merkle_frontier_t::nodes() const
+    {
+        const auto passed = unpaired();
+
+        return (leaves <= passed) ? leaves : passed + (leaves - passed) / 2;
+    }
+
+    void merkle_frontier_t::push(crypto_hash_t node)
+    {
+        auto count = nodes() - 1;
+
+        size_t level = 0;
+
+        // the occupied levels follow the bits of the number of nodes already accumulated
+        while (count & 1)
+        {
+            node = combine(levels[level], node);
+
+            levels[level] = crypto_hash_t();
+
+            count >>= 1;
+
+            level++;
+        }
+
+        levels[level] = node;
+    }
+
+    crypto_hash_t merkle_frontier_t::root() const
+    {
+        if (!complete())
+        {
+            throw std::runtime_error("merkle frontier does not yet hold every hash");
+        }
+
+        return levels.back();
+    }
+
+    std::vector<uint8_t> merkle_frontier_t::serialize() const
+    {
+        serializer_t writer;
+
+        writer.varint(leaf_count);
+
+        writer.varint(leaves);
+
+        writer.key(pending);
+
+        writer.key(levels);
+
+        return writer.vector();
+    }
+
+    std::tuple<uint64_t, size_t> merkle_frontier_t::tree() const
+    {
+        uint64_t width = 1;
+
+        size_t depth = 0;
+
+        // the perfect tree is as wide as the largest power of two below the number of hashes
+        while (width * 2 < leaf_count)
+        {
+            width *= 2;
+
+            depth++;
+        }
+
+        return {width, depth};
+    }
+
+    uint64_t merkle_frontier_t::unpaired() const
+    {
+        return 2 * std::get<0>(tree()) - leaf_count;
+    }
+} // namespace Core
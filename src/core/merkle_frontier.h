@@ -0,0 +1,98 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_MERKLE_FRONTIER_H
+#define CORE_MERKLE_FRONTIER_H
+
+#include <config.h>
+#include <types.h>
+
+namespace Core
+{
+    /**
+     * Accumulates the Merkle root of a fixed number of hashes as they are appended one at a time,
+     * which yields the same root as Crypto::Hashing::Merkle::root_hash() over the same hashes
+     *
+     * The tree built by root_hash() pairs the trailing hashes so that the nodes above them form
+     * a perfect binary tree; as the number of hashes is known up front, the hashes that are not
+     * paired are passed through as they arrive and the perfect tree is accumulated by keeping
+     * only the rightmost unpaired node at each of its levels (the frontier). Appending a hash
+     * therefore costs at most one hash per level and the frontier never holds more than one
+     * hash per level plus a pending hash waiting for its pair.
+     */
+    struct merkle_frontier_t
+    {
+        /**
+         * Creates an empty frontier for the specified number of hashes
+         *
+         * @param leaf_count
+         */
+        merkle_frontier_t(size_t leaf_count = Configuration::Consensus::BLOCKS_PER_ROUND);
+
+        merkle_frontier_t(const std::vector<uint8_t> &data);
+
+        /**
+         * Appends the next hash to the frontier
+         *
+         * @param hash
+         */
+        void append(const crypto_hash_t &hash);
+
+        /**
+         * Returns whether every hash has been appended to the frontier
+         *
+         * @return
+         */
+        [[nodiscard]] bool complete() const;
+
+        /**
+         * Returns the Merkle root of the hashes once every hash has been appended
+         *
+         * @return
+         */
+        [[nodiscard]] crypto_hash_t root() const;
+
+        [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+        uint64_t leaf_count = 0;
+
+        uint64_t leaves = 0;
+
+        crypto_hash_t pending;
+
+        std::vector<crypto_hash_t> levels;
+
+      private:
+        /**
+         * Returns the number of leading hashes that are passed through without being paired
+         *
+         * @return
+         */
+        [[nodiscard]] uint64_t unpaired() const;
+
+        /**
+         * Returns the number of nodes of the perfect tree accumulated so far
+         *
+         * @return
+         */
+        [[nodiscard]] uint64_t nodes() const;
+
+        /**
+         * Adds the next node of the perfect tree, combining it with the frontier at each level
+         * that already holds a node
+         *
+         * @param node
+         */
+        void push(crypto_hash_t node);
+
+        /**
+         * Returns the number of nodes in the perfect tree, and thus the number of levels it has
+         *
+         * @return [width, depth]
+         */
+        [[nodiscard]] std::tuple<uint64_t, size_t> tree() const;
+    };
+} // namespace Core
+
+#endif // CORE_MERKLE_FRONTIER_H
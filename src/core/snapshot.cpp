@@ -0,0 +1,572 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "snapshot.h"
+
+#include <fstream>
+
+#define SNAPSHOT_MAGIC 0x544F4853504E5354
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BLOCK_INDEX_TABLE "block_indexes_seq"
+#define SNAPSHOT_MAXIMUM_CHUNK_SIZE (size_t(1) << 32)
+
+namespace Core
+{
+    enum snapshot_tag_t
+    {
+        SNAPSHOT_TAG_HEADER,
+        SNAPSHOT_TAG_TABLE,
+        SNAPSHOT_TAG_RECORD,
+        SNAPSHOT_TAG_END
+    };
+
+    /**
+     * The table that the records of the chunk being imported are appended to
+     */
+    struct snapshot_target_t
+    {
+        std::shared_ptr<Database::LMDB> env;
+
+        std::shared_ptr<Database::LMDBDatabase> db;
+
+        bool dupsort = false;
+
+        std::vector<uint8_t> last_key;
+    };
+
+    /**
+     * Chains the hash of the chunk onto the previous checkpoint
+     *
+     * @param previous
+     * @param chunk
+     * @return
+     */
+    static crypto_hash_t next_checkpoint(const crypto_hash_t &previous, const std::vector<uint8_t> &chunk)
+    {
+        serializer_t writer;
+
+        writer.key(previous);
+
+        writer.key(Crypto::Hashing::sha3(chunk.data(), chunk.size()));
+
+        return Crypto::Hashing::sha3(writer.data(), writer.size());
+    }
+
+    /**
+     * Writes the chunk followed by its checkpoint to the file and then empties the chunk
+     *
+     * @param file
+     * @param chunk
+     * @param info
+     * @return
+     */
+    static Error write_chunk(std::ofstream &file, serializer_t &chunk, snapshot_info_t &info)
+    {
+        const auto payload = chunk.vector();
+
+        info.checksum = next_checkpoint(info.checksum, payload);
+
+        info.checkpoints++;
+
+        const uint64_t size = payload.size();
+
+        file.write(reinterpret_cast<const char *>(&size), sizeof(size));
+
+        file.write(reinterpret_cast<const char *>(payload.data()), payload.size());
+
+        file.write(reinterpret_cast<const char *>(info.checksum.data()), info.checksum.size());
+
+        chunk = serializer_t();
+
+        if (!file)
+        {
+            return MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Could not write to snapshot file.");
+        }
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    /**
+     * Loads the entries of a verified chunk into the database
+     *
+     * Every chunk holds the records of a single table (the header and the end of the snapshot each
+     * have a chunk of their own) so that it is written within a single write transaction, and that
+     * transaction is simply retried if the memory map has to be expanded.
+     *
+     * @param chunk
+     * @param environments
+     * @param info
+     * @param target
+     * @param ended
+     * @return
+     */
+    static Error apply_chunk(
+        const std::vector<uint8_t> &chunk,
+        const snapshot_environments_t &environments,
+        snapshot_info_t &info,
+        snapshot_target_t &target,
+        bool &ended)
+    {
+        const auto saved_info = info;
+
+        const auto saved_target = target;
+
+    try_again:
+        info = saved_info;
+
+        target = saved_target;
+
+        deserializer_t reader(chunk);
+
+        auto tag = reader.varint<uint64_t>();
+
+        if (tag == SNAPSHOT_TAG_HEADER)
+        {
+            info.block_count = reader.varint<uint64_t>();
+
+            info.tip_hash = reader.key<crypto_hash_t>();
+
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        if (tag == SNAPSHOT_TAG_END)
+        {
+            const auto records = reader.varint<uint64_t>();
+
+            const auto tables = reader.varint<uint64_t>();
+
+            if (records != info.records || tables != info.tables)
+            {
+                return MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Snapshot is missing records.");
+            }
+
+            ended = true;
+
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        if (tag == SNAPSHOT_TAG_TABLE)
+        {
+            const auto section = reader.bytes(reader.varint<uint64_t>());
+
+            const auto name = reader.bytes(reader.varint<uint64_t>());
+
+            const auto flags = reader.varint<uint64_t>();
+
+            target = snapshot_target_t();
+
+            for (const auto &[section_name, env] : environments)
+            {
+                if (section_name == std::string(section.begin(), section.end()))
+                {
+                    target.env = env;
+                }
+            }
+
+            if (!target.env)
+            {
+                return MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Snapshot contains an unknown section.");
+            }
+
+            // the table is created before the write transaction begins as creating it needs one of its own
+            target.db = target.env->open_database(std::string(name.begin(), name.end()), int(flags));
+
+            target.dupsort = flags & MDB_DUPSORT;
+
+            info.tables++;
+
+            if (reader.unread_bytes() == 0)
+            {
+                return MAKE_ERROR(SUCCESS);
+            }
+
+            tag = reader.varint<uint64_t>();
+        }
+
+        if (!target.db)
+        {
+            return MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Snapshot contains records outside of a table.");
+        }
+
+        target.env->reserve(chunk.size() * Configuration::Database::MAP_RESERVE_FACTOR);
+
+        auto db_tx = target.db->transaction();
+
+        auto cursor = db_tx->cursor();
+
+        while (true)
+        {
+            if (tag != SNAPSHOT_TAG_RECORD)
+            {
+                return MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Snapshot contains an unknown entry.");
+            }
+
+            const auto key = reader.bytes(reader.varint<uint64_t>());
+
+            const auto value = reader.bytes(reader.varint<uint64_t>());
+
+            // records arrive in the order of the table so they always belong at its end
+            const auto flags = (target.dupsort && key == target.last_key) ? MDB_APPENDDUP : MDB_APPEND;
+
+            // values are written exactly as they were stored, bypassing any compression of the table
+            const auto error = cursor->put_stored(key, value, flags);
+
+            MDB_CHECK_TXN_EXPAND(error, target.env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+
+            target.last_key = key;
+
+            info.records++;
+
+            if (reader.unread_bytes() == 0)
+            {
+                break;
+            }
+
+            tag = reader.varint<uint64_t>();
+        }
+
+        const auto error = db_tx->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, target.env, db_tx, try_again);
+
+        return error;
+    }
+
+    std::tuple<Error, snapshot_info_t> export_snapshot(
+        const std::string &path,
+        const snapshot_environments_t &environments,
+        const snapshot_progress_t &progress)
+    {
+        snapshot_info_t info;
+
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+
+        if (!file)
+        {
+            return {MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Could not create snapshot file."), info};
+        }
+
+        const uint64_t header[2] = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION};
+
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+        std::vector<std::vector<std::tuple<std::string, std::shared_ptr<Database::LMDBDatabase>>>> tables;
+
+        std::vector<std::unique_ptr<Database::LMDBTransaction>> transactions;
+
+        /**
+         * Every table is opened and every read transaction is started before anything is written
+         * so that the block count in the header matches the tables that follow it
+         */
+        for (const auto &[section, env] : environments)
+        {
+            const auto [error, names] = env->list_databases();
+
+            if (error)
+            {
+                return {error, info};
+            }
+
+            std::vector<std::tuple<std::string, std::shared_ptr<Database::LMDBDatabase>>> section_tables;
+
+            for (const auto &name : names)
+            {
+                section_tables.emplace_back(name, env->open_database(name));
+            }
+
+            tables.push_back(section_tables);
+
+            transactions.push_back(env->transaction(true));
+        }
+
+        for (size_t i = 0; i < environments.size(); ++i)
+        {
+            for (const auto &[name, db] : tables[i])
+            {
+                if (name != SNAPSHOT_BLOCK_INDEX_TABLE)
+                {
+                    continue;
+                }
+
+                transactions[i]->set_database(db);
+
+                auto cursor = transactions[i]->cursor();
+
+                const auto [error, key, value] = cursor->get_view(MDB_LAST);
+
+                if (!error)
+                {
+                    info.block_count = Database::decode_key(key.data(), key.size(), Database::KEY_ENCODING_INTEGER) + 1;
+
+                    info.tip_hash = value.decode<crypto_hash_t>();
+                }
+            }
+
+            if (info.block_count != 0)
+            {
+                break;
+            }
+        }
+
+        serializer_t chunk;
+
+        chunk.varint(SNAPSHOT_TAG_HEADER);
+
+        chunk.varint(info.block_count);
+
+        chunk.key(info.tip_hash);
+
+        auto error = write_chunk(file, chunk, info);
+
+        if (error)
+        {
+            return {error, info};
+        }
+
+        for (size_t i = 0; i < environments.size(); ++i)
+        {
+            const auto &section = std::get<0>(environments[i]);
+
+            auto &db_tx = transactions[i];
+
+            for (const auto &[name, db] : tables[i])
+            {
+                unsigned int flags = 0;
+
+                const auto result = mdb_dbi_flags(*db_tx, *db, &flags);
+
+                if (result != MDB_SUCCESS)
+                {
+                    return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), info};
+                }
+
+                // every table starts a new chunk so that a chunk is always imported into a single table
+                if (chunk.size() != 0)
+                {
+                    error = write_chunk(file, chunk, info);
+
+                    if (error)
+                    {
+                        return {error, info};
+                    }
+                }
+
+                chunk.varint(SNAPSHOT_TAG_TABLE);
+
+                chunk.varint(section.size());
+
+                chunk.bytes(section.data(), section.size());
+
+                chunk.varint(name.size());
+
+                chunk.bytes(name.data(), name.size());
+
+                chunk.varint(flags);
+
+                info.tables++;
+
+                db_tx->set_database(db);
+
+                auto cursor = db_tx->cursor();
+
+                MDB_val key, value;
+
+                /**
+                 * Records are read directly from the cursor so that the values of compressed tables
+                 * are exported exactly as they are stored (along with the dictionaries that
+                 * compressed them) rather than being decompressed
+                 */
+                int cursor_result;
+
+                for (cursor_result = mdb_cursor_get(*cursor, &key, &value, MDB_FIRST); cursor_result == MDB_SUCCESS;
+                     cursor_result = mdb_cursor_get(*cursor, &key, &value, MDB_NEXT))
+                {
+                    chunk.varint(SNAPSHOT_TAG_RECORD);
+
+                    chunk.varint(key.mv_size);
+
+                    chunk.bytes(key.mv_data, key.mv_size);
+
+                    chunk.varint(value.mv_size);
+
+                    chunk.bytes(value.mv_data, value.mv_size);
+
+                    info.records++;
+
+                    if (chunk.size() < Configuration::Database::SNAPSHOT_CHECKPOINT_BYTES)
+                    {
+                        continue;
+                    }
+
+                    const auto write_error = write_chunk(file, chunk, info);
+
+                    if (write_error)
+                    {
+                        return {write_error, info};
+                    }
+
+                    if (progress)
+                    {
+                        progress(info);
+                    }
+                }
+
+                if (cursor_result != MDB_NOTFOUND)
+                {
+                    return {MAKE_ERROR_MSG(cursor_result, MDB_STR_ERR(cursor_result)), info};
+                }
+            }
+
+            db_tx->abort();
+        }
+
+        if (chunk.size() != 0)
+        {
+            error = write_chunk(file, chunk, info);
+
+            if (error)
+            {
+                return {error, info};
+            }
+        }
+
+        chunk.varint(SNAPSHOT_TAG_END);
+
+        chunk.varint(info.records);
+
+        chunk.varint(info.tables);
+
+        error = write_chunk(file, chunk, info);
+
+        if (error)
+        {
+            return {error, info};
+        }
+
+        if (progress)
+        {
+            progress(info);
+        }
+
+        return {MAKE_ERROR(SUCCESS), info};
+    }
+
+    std::tuple<Error, snapshot_info_t> import_snapshot(
+        const std::string &path,
+        const snapshot_environments_t &environments,
+        const std::optional<crypto_hash_t> &trusted_checksum,
+        const snapshot_progress_t &progress)
+    {
+        snapshot_info_t info;
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+
+        if (!file)
+        {
+            return {MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Could not open snapshot file."), info};
+        }
+
+        uint64_t header[2] = {0};
+
+        file.read(reinterpret_cast<char *>(header), sizeof(header));
+
+        if (!file || header[0] != SNAPSHOT_MAGIC || header[1] != SNAPSHOT_VERSION)
+        {
+            return {MAKE_ERROR(SNAPSHOT_INVALID), info};
+        }
+
+        for (const auto &[section, env] : environments)
+        {
+            const auto [error, names] = env->list_databases();
+
+            if (error)
+            {
+                return {error, info};
+            }
+
+            if (!names.empty())
+            {
+                return {MAKE_ERROR(SNAPSHOT_DESTINATION_NOT_EMPTY), info};
+            }
+        }
+
+        snapshot_target_t target;
+
+        bool ended = false;
+
+        while (!ended)
+        {
+            uint64_t size = 0;
+
+            file.read(reinterpret_cast<char *>(&size), sizeof(size));
+
+            if (!file || size == 0 || size > SNAPSHOT_MAXIMUM_CHUNK_SIZE)
+            {
+                return {MAKE_ERROR(SNAPSHOT_INVALID), info};
+            }
+
+            std::vector<uint8_t> chunk(size);
+
+            file.read(reinterpret_cast<char *>(chunk.data()), chunk.size());
+
+            std::vector<uint8_t> checkpoint(info.checksum.size());
+
+            file.read(reinterpret_cast<char *>(checkpoint.data()), checkpoint.size());
+
+            if (!file)
+            {
+                return {MAKE_ERROR(SNAPSHOT_INVALID), info};
+            }
+
+            // nothing is loaded from a chunk until it is known to be intact
+            const auto expected = next_checkpoint(info.checksum, chunk);
+
+            if (deserializer_t(checkpoint).key<crypto_hash_t>() != expected)
+            {
+                return {MAKE_ERROR(SNAPSHOT_CHECKSUM_MISMATCH), info};
+            }
+
+            info.checksum = expected;
+
+            info.checkpoints++;
+
+            try
+            {
+                const auto error = apply_chunk(chunk, environments, info, target, ended);
+
+                if (error)
+                {
+                    return {error, info};
+                }
+            }
+            catch (const std::exception &e)
+            {
+                return {
+                    MAKE_ERROR_MSG(SNAPSHOT_INVALID, "Snapshot chunk is malformed: " + std::string(e.what())), info};
+            }
+
+            if (progress)
+            {
+                progress(info);
+            }
+        }
+
+        if (trusted_checksum && *trusted_checksum != info.checksum)
+        {
+            return {MAKE_ERROR(SNAPSHOT_UNTRUSTED), info};
+        }
+
+        for (const auto &[section, env] : environments)
+        {
+            env->flush(true);
+        }
+
+        return {MAKE_ERROR(SUCCESS), info};
+    }
+} // namespace Core
@@ -0,0 +1,96 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_SNAPSHOT_H
+#define CORE_SNAPSHOT_H
+
+#include <config.h>
+#include <db_lmdb.h>
+#include <functional>
+#include <optional>
+
+namespace Core
+{
+    /**
+     * A snapshot is a stream of every table of one or more LMDB environments (ie. the blockchain
+     * storage and the staking engine), each walked in key order so that it can be loaded back using
+     * MDB_APPEND without any page splits or per-block validation.
+     *
+     * The stream is split into chunks of roughly SNAPSHOT_CHECKPOINT_BYTES. Every chunk ends with a
+     * checkpoint hash that chains the hash of the chunk onto the previous checkpoint, so corruption
+     * is detected as soon as the damaged chunk is read and the final checkpoint (the checksum of
+     * the snapshot) commits to the entire stream. Only a single chunk is held in memory at a time
+     * in either direction.
+     */
+    struct snapshot_info_t
+    {
+        uint64_t block_count = 0;
+
+        crypto_hash_t tip_hash;
+
+        uint64_t tables = 0;
+
+        uint64_t records = 0;
+
+        uint64_t checkpoints = 0;
+
+        crypto_hash_t checksum;
+    };
+
+    /**
+     * The environments held in a snapshot, each under the name of its section
+     */
+    typedef std::vector<std::tuple<std::string, std::shared_ptr<Database::LMDB>>> snapshot_environments_t;
+
+    /**
+     * Called with the running totals of a snapshot each time a checkpoint is written or verified
+     */
+    typedef std::function<void(const snapshot_info_t &)> snapshot_progress_t;
+
+    /**
+     * Writes every table of the environments specified to a snapshot file
+     *
+     * Each environment is read from a single read transaction so that its tables are consistent
+     * with one another. The block count and tip hash recorded in the snapshot are taken from the
+     * first environment holding the block index table.
+     *
+     * @param path
+     * @param environments
+     * @param progress
+     * @return
+     */
+    std::tuple<Error, snapshot_info_t> export_snapshot(
+        const std::string &path,
+        const snapshot_environments_t &environments,
+        const snapshot_progress_t &progress = nullptr);
+
+    /**
+     * Loads a snapshot file into the environments specified, which must be empty
+     *
+     * Records are appended (MDB_APPEND) in the order in which they were exported and each chunk
+     * is written within a single write transaction once its checkpoint has been verified. If a
+     * trusted checksum is supplied, the checksum of the snapshot must match it; as the snapshot is
+     * then known to be an exact copy of a trusted database, no block is validated during the import.
+     *
+     * Without a trusted checksum the checkpoints only prove that the snapshot is intact, not that
+     * its blocks are valid, so the caller must verify every imported block (see verify_blockchain)
+     * before the imported environments are put to use.
+     *
+     * Please note: the environments are left partially loaded if an error is returned so the
+     * import should be made into a staging location that is discarded on failure.
+     *
+     * @param path
+     * @param environments
+     * @param trusted_checksum
+     * @param progress
+     * @return
+     */
+    std::tuple<Error, snapshot_info_t> import_snapshot(
+        const std::string &path,
+        const snapshot_environments_t &environments,
+        const std::optional<crypto_hash_t> &trusted_checksum = std::nullopt,
+        const snapshot_progress_t &progress = nullptr);
+} // namespace Core
+
+#endif // CORE_SNAPSHOT_H
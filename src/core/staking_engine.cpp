@@ -4,280 +4,1422 @@
 
 #include "staking_engine.h"
 
+#include <set>
+
 namespace Core
 {
-    StakingEngine::StakingEngine(const std::string &db_path)
+    StakingEngine::StakingEngine(const std::string &db_path): StakingEngine(Database::LMDB::getInstance(db_path)) {}
+
+    StakingEngine::StakingEngine(std::shared_ptr<Database::LMDB> db_env): m_db_env(std::move(db_env))
+    {
+        m_db_candidates = m_db_env->open_database("candidates");
+
+        m_db_stakers = m_db_env->open_database("stakers");
+
+        m_db_stakes = m_db_env->open_database("stakes", MDB_CREATE | MDB_DUPSORT);
+
+        m_db_staker_stakes = m_db_env->open_database("staker_stakes", MDB_CREATE | MDB_DUPSORT);
+
+        m_db_candidate_votes = m_db_env->open_database("candidate_votes");
+
+        m_db_staking_undo = m_db_env->open_sequential_database("staking_undo_seq");
+
+        m_db_round_frontiers = m_db_env->open_sequential_database("round_frontiers_seq");
+
+        m_db_round_tallies = m_db_env->open_sequential_database("round_tallies_seq");
+
+        {
+            const auto error = rebuild_staker_index();
+
+            if (error)
+            {
+                throw std::runtime_error("Could not build the staker index: " + error.to_string());
+            }
+        }
+
+        {
+            const auto error = load_vote_tallies();
+
+            if (error)
+            {
+                throw std::runtime_error("Could not load the vote tallies: " + error.to_string());
+            }
+        }
+    }
+
+    StakingEngine::staker_stake_t::staker_stake_t(
+        const crypto_public_key_t &candidate_key,
+        const Types::Staking::stake_t &stake):
+        candidate_key(candidate_key), stake(stake)
+    {
+    }
+
+    StakingEngine::staker_stake_t::staker_stake_t(const std::vector<uint8_t> &data)
+    {
+        deserializer_t reader(data);
+
+        candidate_key = reader.key<crypto_public_key_t>();
+
+        stake = Types::Staking::stake_t(reader);
+    }
+
+    std::vector<uint8_t> StakingEngine::staker_stake_t::serialize() const
+    {
+        serializer_t writer;
+
+        writer.key(candidate_key);
+
+        stake.serialize(writer);
+
+        return writer.vector();
+    }
+
+    StakingEngine::staking_undo_t::staking_undo_t(const std::vector<uint8_t> &data)
+    {
+        deserializer_t reader(data);
+
+        block_hash = reader.key<crypto_hash_t>();
+
+        added_stakers = reader.keyV<crypto_hash_t>();
+
+        {
+            const auto count = reader.varint<uint64_t>();
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                staking_change_t change;
+
+                change.recalled = reader.varint<uint64_t>() != 0;
+
+                change.candidate_key = reader.key<crypto_public_key_t>();
+
+                change.stake = Types::Staking::stake_t(reader);
+
+                changes.push_back(change);
+            }
+        }
+    }
+
+    std::vector<uint8_t> StakingEngine::staking_undo_t::serialize() const
+    {
+        serializer_t writer;
+
+        writer.key(block_hash);
+
+        writer.key(added_stakers);
+
+        writer.varint(changes.size());
+
+        for (const auto &change : changes)
+        {
+            writer.varint(uint64_t((change.recalled) ? 1 : 0));
+
+            writer.key(change.candidate_key);
+
+            change.stake.serialize(writer);
+        }
+
+        return writer.vector();
+    }
+
+    StakingEngine::round_tallies_t::round_tallies_t(const std::vector<uint8_t> &data)
+    {
+        deserializer_t reader(data);
+
+        const auto count = reader.varint<uint64_t>();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto candidate_key = reader.key<crypto_public_key_t>();
+
+            tallies.emplace_back(candidate_key, reader.uint64());
+        }
+    }
+
+    std::vector<uint8_t> StakingEngine::round_tallies_t::serialize() const
+    {
+        serializer_t writer;
+
+        writer.varint(tallies.size());
+
+        for (const auto &[candidate_key, votes] : tallies)
+        {
+            writer.key(candidate_key);
+
+            writer.uint64(votes);
+        }
+
+        return writer.vector();
+    }
+
+    StakingEngine::vote_tally_t::vote_tally_t(uint64_t votes): votes(votes) {}
+
+    StakingEngine::vote_tally_t::vote_tally_t(const std::vector<uint8_t> &data)
+    {
+        deserializer_t reader(data);
+
+        votes = reader.uint64();
+    }
+
+    std::vector<uint8_t> StakingEngine::vote_tally_t::serialize() const
+    {
+        serializer_t writer;
+
+        writer.uint64(votes);
+
+        return writer.vector();
+    }
+
+    Error StakingEngine::add_candidate(const Types::Staking::candidate_node_t &candidate)
+    {
+        std::scoped_lock lock(candidates_mutex);
+
+        return m_db_candidates->put(candidate.public_signing_key, candidate.serialize());
+    }
+
+    Error StakingEngine::add_staker(const Types::Staking::staker_t &staker)
+    {
+        std::scoped_lock lock(stakers_mutex);
+
+        return m_db_stakers->put(staker.id(), staker.serialize());
+    }
+
+    Error StakingEngine::append_round_block(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const uint64_t &block_index,
+        const crypto_hash_t &block_hash)
+    {
+        constexpr auto blocks_per_round = Configuration::Consensus::BLOCKS_PER_ROUND;
+
+        /**
+         * Completing a round makes the seed of the round before it final. Its per-block frontiers are
+         * pruned as a block that far back is popped so rarely that re-accumulating it is not worth
+         * keeping them; if it ever is, the seed is rebuilt from the stored block hashes instead.
+         */
+        if ((block_index + 1) % blocks_per_round == 0 && block_index + 1 >= 2 * blocks_per_round)
+        {
+            const auto error = prune_round_frontiers(txn, (block_index + 1) / blocks_per_round - 2);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        merkle_frontier_t frontier;
+
+        // every block but the first of a round continues the frontier saved by the block before it
+        if (block_index % blocks_per_round != 0)
+        {
+            txn->set_database(m_db_round_frontiers);
+
+            const auto [error, value] = txn->get_view(block_index - 1);
+
+            if (error == LMDB_NOTFOUND)
+            {
+                return MAKE_ERROR(SUCCESS);
+            }
+
+            if (error)
+            {
+                return error;
+            }
+
+            try
+            {
+                frontier = value.decode<merkle_frontier_t>();
+            }
+            catch (...)
+            {
+                return MAKE_ERROR(DB_DESERIALIZATION_ERROR);
+            }
+        }
+
+        frontier.append(block_hash);
+
+        txn->set_database(m_db_round_frontiers);
+
+        return txn->put(block_index, frontier.serialize());
+    }
+
+    Error StakingEngine::apply_block_staking(
+        const Types::Blockchain::block_t &block,
+        const std::vector<Types::Blockchain::transaction_t> &transactions)
+    {
+        std::scoped_lock lock(stakes_mutex);
+
+    try_again:
+        auto txn = m_db_stakes->transaction();
+
+        auto [error, changed_candidates] = apply_block_staking(txn, block, transactions);
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        if (error)
+        {
+            return error;
+        }
+
+        error = txn->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        if (!error)
+        {
+            refresh_candidate_votes(changed_candidates);
+        }
+
+        return error;
+    }
+
+    std::tuple<Error, std::set<crypto_public_key_t>> StakingEngine::apply_block_staking(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const Types::Blockchain::block_t &block,
+        const std::vector<Types::Blockchain::transaction_t> &transactions)
+    {
+        std::set<crypto_public_key_t> changed_candidates;
+
+        staking_undo_t undo;
+
+        undo.block_hash = block.hash();
+
+        for (const auto &transaction : transactions)
+        {
+            Error error;
+
+            if (const auto stake_tx = std::get_if<Types::Blockchain::committed_stake_transaction_t>(&transaction))
+            {
+                const auto staker =
+                    Types::Staking::staker_t(stake_tx->staker_public_view_key, stake_tx->staker_public_spend_key);
+
+                const auto stake = Types::Staking::stake_t(staker.id(), stake_tx->hash(), stake_tx->stake_amount);
+
+                bool staker_added = false;
+
+                error = record_stake(
+                    txn, staker, stake_tx->candidate_public_key, stake, changed_candidates, staker_added);
+
+                if (staker_added)
+                {
+                    undo.added_stakers.push_back(stake.staker_id);
+                }
+
+                undo.changes.push_back({false, stake_tx->candidate_public_key, stake});
+            }
+            else if (
+                const auto recall_tx =
+                    std::get_if<Types::Blockchain::committed_recall_stake_transaction_t>(&transaction))
+            {
+                // a recall names the staker, candidate and amount rather than the stake, so it recalls the
+                // first (in the order of the staker index) of the staker's stakes with the candidate for that amount
+                const auto [find_error, stake] =
+                    find_stake(txn, recall_tx->staker_id, recall_tx->candidate_public_key, recall_tx->stake_amount);
+
+                error = (find_error) ? find_error
+                                     : recall_stake(txn, recall_tx->candidate_public_key, stake, changed_candidates);
+
+                undo.changes.push_back({true, recall_tx->candidate_public_key, stake});
+            }
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        // the undo record is saved even for blocks without staking changes so that every block is reverted alike
+        txn->set_database(m_db_staking_undo);
+
+        auto error = txn->put(block.block_index, undo.serialize(), MDB_NOOVERWRITE);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        error = append_round_block(txn, block.block_index, undo.block_hash);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        // the next round is elected from the tallies as they stand at the final block of this round
+        if ((block.block_index + 1) % Configuration::Consensus::BLOCKS_PER_ROUND == 0)
+        {
+            error = snapshot_round_tallies(txn, block.block_index / Configuration::Consensus::BLOCKS_PER_ROUND);
+
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), changed_candidates};
+    }
+
+    std::tuple<crypto_public_key_t, uint256_t, bool>
+        StakingEngine::calculate_election_seed(const std::vector<crypto_hash_t> &last_round_blocks)
+    {
+        /**
+         * First, we take the hashes of every block in the now closed round and calculate
+         * the Merkle root for those hashes to establish M as the election seed for the next round
+         */
+        return calculate_election_seed(Crypto::Hashing::Merkle::root_hash(last_round_blocks));
+    }
+
+    std::tuple<crypto_public_key_t, uint256_t, bool> StakingEngine::calculate_election_seed(const crypto_hash_t &M)
+    {
+        /**
+         * Then we take M and convert it to a scalar p via Hs(M) and compute the public key P of p
+         * Note: shortcut used as hash_to_point does just that
+         */
+        const auto P = Crypto::hash_to_point(M);
+
+        // Then we tally the individual bytes of P...
+        uint64_t sum = 0;
+
+        for (int i = 0; i < P.size(); ++i)
+        {
+            sum += P[i];
+        }
+
+        // And determine if the result of that is even or odd (returning true if even)
+        return {P, P.to_uint256_t(), sum % 2 == 0};
+    }
+
+    std::tuple<Error, std::vector<vote_tally_mismatch_t>> StakingEngine::check_vote_tallies()
     {
-        m_db_env = Database::LMDB::getInstance(db_path);
+        // no stake may be recorded or recalled while the tallies held in memory are compared
+        std::scoped_lock lock(stakes_mutex);
+
+        auto txn = m_db_candidate_votes->transaction(true);
+
+        const auto [error, counted] = count_votes(txn);
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        std::map<crypto_public_key_t, uint64_t> stored, cached;
+
+        {
+            txn->set_database(m_db_candidate_votes);
+
+            auto tallies = txn->range<crypto_public_key_t, vote_tally_t>();
+
+            for (auto it = tallies.begin(); it != tallies.end(); ++it)
+            {
+                stored[it.key()] = it.value().votes;
+            }
+
+            if (tallies.error())
+            {
+                return {tallies.error(), {}};
+            }
+        }
+
+        {
+            std::shared_lock votes_lock(m_candidate_votes_mutex);
+
+            cached = m_candidate_votes;
+        }
+
+        std::set<crypto_public_key_t> candidates;
+
+        for (const auto &tallies : {counted, stored, cached})
+        {
+            for (const auto &[candidate_key, votes] : tallies)
+            {
+                candidates.insert(candidate_key);
+            }
+        }
+
+        const auto votes_of = [](const std::map<crypto_public_key_t, uint64_t> &tallies,
+                                 const crypto_public_key_t &candidate_key) -> uint64_t
+        {
+            const auto it = tallies.find(candidate_key);
+
+            return (it != tallies.end()) ? it->second : 0;
+        };
+
+        std::vector<vote_tally_mismatch_t> mismatches;
+
+        for (const auto &candidate_key : candidates)
+        {
+            vote_tally_mismatch_t tally;
+
+            tally.candidate_key = candidate_key;
+
+            tally.stored_votes = votes_of(stored, candidate_key);
+
+            tally.cached_votes = votes_of(cached, candidate_key);
+
+            tally.counted_votes = votes_of(counted, candidate_key);
+
+            if (tally.stored_votes != tally.counted_votes || tally.cached_votes != tally.counted_votes)
+            {
+                mismatches.push_back(tally);
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), mismatches};
+    }
+
+    std::tuple<Error, std::map<crypto_public_key_t, uint64_t>>
+        StakingEngine::count_votes(std::unique_ptr<Database::LMDBTransaction> &txn)
+    {
+        std::map<crypto_public_key_t, uint64_t> results;
+
+        txn->set_database(m_db_stakes);
+
+        auto stakes = txn->range<crypto_public_key_t, Types::Staking::stake_t>();
+
+        for (auto it = stakes.begin(); it != stakes.end(); ++it)
+        {
+            results[it.key()] += it.value().stake;
+        }
+
+        if (stakes.error())
+        {
+            return {stakes.error(), {}};
+        }
+
+        // candidates only hold a tally while they hold votes
+        for (auto it = results.begin(); it != results.end();)
+        {
+            it = (it->second == 0) ? results.erase(it) : std::next(it);
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    Error StakingEngine::delete_candidate(const crypto_public_key_t &candidate_key)
+    {
+        std::scoped_lock lock(candidates_mutex);
+
+        const auto [error, candidate] = get_candidate(candidate_key);
+
+        if (error)
+        {
+            return {MAKE_ERROR(STAKING_CANDIDATE_NOT_FOUND)};
+        }
+
+        return m_db_candidates->del(candidate_key);
+    }
+
+    Error StakingEngine::delete_staker(const crypto_hash_t &staker_id)
+    {
+        std::scoped_lock lock(stakers_mutex);
+
+        const auto [error, staker] = get_staker(staker_id);
+
+        if (error)
+        {
+            return {MAKE_ERROR(STAKING_STAKER_NOT_FOUND)};
+        }
+
+        return m_db_stakers->del(staker_id);
+    }
+
+    std::tuple<Error, Types::Staking::stake_t> StakingEngine::find_stake(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const crypto_hash_t &staker_id,
+        const crypto_public_key_t &candidate_key,
+        uint64_t amount)
+    {
+        txn->set_database(m_db_staker_stakes);
+
+        auto cursor = txn->cursor();
+
+        auto stakes = cursor->dups<staker_stake_t>(staker_id);
+
+        for (auto it = stakes.begin(); it != stakes.end(); ++it)
+        {
+            const auto entry = it.value();
+
+            if (entry.candidate_key == candidate_key && entry.stake.stake == amount)
+            {
+                return {MAKE_ERROR(SUCCESS), entry.stake};
+            }
+        }
+
+        return {MAKE_ERROR(STAKING_STAKE_NOT_FOUND), {}};
+    }
+
+    std::tuple<Error, Types::Staking::candidate_node_t>
+        StakingEngine::get_candidate(const crypto_public_key_t &candidate_key)
+    {
+        const auto [error, candidate] =
+            m_db_candidates->get<crypto_public_key_t, Types::Staking::candidate_node_t>(candidate_key);
+
+        if (error)
+        {
+            return {MAKE_ERROR(STAKING_CANDIDATE_NOT_FOUND), {}};
+        }
+
+        return {error, candidate};
+    }
+
+    std::vector<Types::Staking::stake_t> StakingEngine::get_candidate_stakes(const crypto_public_key_t &candidate_key)
+    {
+        auto txn = m_db_stakes->transaction(true);
+
+        auto cursor = txn->cursor();
+
+        const auto [error, key, stakes] = cursor->get_all<crypto_public_key_t, Types::Staking::stake_t>(candidate_key);
+
+        return stakes;
+    }
+
+    std::vector<std::tuple<crypto_public_key_t, uint64_t>> StakingEngine::get_candidate_tallies()
+    {
+        std::shared_lock lock(m_candidate_votes_mutex);
+
+        return {m_candidate_votes.begin(), m_candidate_votes.end()};
+    }
+
+    uint64_t StakingEngine::get_candidate_votes(const crypto_public_key_t &candidate_key)
+    {
+        std::shared_lock lock(m_candidate_votes_mutex);
+
+        const auto it = m_candidate_votes.find(candidate_key);
+
+        return (it != m_candidate_votes.end()) ? it->second : 0;
+    }
+
+    std::vector<crypto_public_key_t> StakingEngine::get_candidates()
+    {
+        return m_db_candidates->list_keys<crypto_public_key_t>();
+    }
+
+    std::tuple<Error, merkle_frontier_t> StakingEngine::get_round_frontier(const uint64_t &block_index)
+    {
+        try
+        {
+            return m_db_round_frontiers->get<merkle_frontier_t>(block_index);
+        }
+        catch (...)
+        {
+            return {MAKE_ERROR(DB_DESERIALIZATION_ERROR), {}};
+        }
+    }
+
+    std::tuple<Error, crypto_hash_t> StakingEngine::get_round_seed(const uint64_t &round)
+    {
+        const auto last_block_index = (round + 1) * Configuration::Consensus::BLOCKS_PER_ROUND - 1;
+
+        const auto [error, frontier] = get_round_frontier(last_block_index);
+
+        if (error == LMDB_NOTFOUND || (!error && !frontier.complete()))
+        {
+            return {MAKE_ERROR(STAKING_ROUND_INCOMPLETE), {}};
+        }
+
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), frontier.root()};
+    }
+
+    std::tuple<Error, std::vector<std::tuple<crypto_public_key_t, uint64_t>>>
+        StakingEngine::get_round_tallies(const uint64_t &round)
+    {
+        try
+        {
+            const auto [error, snapshot] = m_db_round_tallies->get<round_tallies_t>(round);
+
+            if (error == LMDB_NOTFOUND)
+            {
+                return {MAKE_ERROR(STAKING_ROUND_INCOMPLETE), {}};
+            }
+
+            return {error, snapshot.tallies};
+        }
+        catch (...)
+        {
+            return {MAKE_ERROR(DB_DESERIALIZATION_ERROR), {}};
+        }
+    }
+
+    std::vector<crypto_hash_t> StakingEngine::get_stakers()
+    {
+        return m_db_stakers->list_keys<crypto_hash_t>();
+    }
+
+    std::tuple<Error, Types::Staking::staker_t> StakingEngine::get_staker(const crypto_hash_t &staker_key)
+    {
+        const auto [error, staker] = m_db_stakers->get<crypto_hash_t, Types::Staking::staker_t>(staker_key);
+
+        if (error)
+        {
+            return {MAKE_ERROR(STAKING_STAKER_NOT_FOUND), {}};
+        }
+
+        return {error, staker};
+    }
+
+    uint64_t StakingEngine::get_staker_candidate_votes(
+        const crypto_hash_t &staker_id,
+        const crypto_public_key_t &candidate_key)
+    {
+        uint64_t votes = 0;
+
+        auto txn = m_db_staker_stakes->transaction(true);
+
+        auto cursor = txn->cursor();
+
+        auto stakes = cursor->dups<staker_stake_t>(staker_id);
+
+        for (auto it = stakes.begin(); it != stakes.end(); ++it)
+        {
+            const auto entry = it.value();
+
+            if (entry.candidate_key == candidate_key)
+            {
+                votes += entry.stake.stake;
+            }
+        }
+
+        return votes;
+    }
+
+    std::map<crypto_public_key_t, std::vector<Types::Staking::stake_t>>
+        StakingEngine::get_staker_stakes(const crypto_hash_t &staker_id)
+    {
+        std::map<crypto_public_key_t, std::vector<Types::Staking::stake_t>> results;
+
+        auto txn = m_db_staker_stakes->transaction(true);
+
+        auto cursor = txn->cursor();
+
+        auto stakes = cursor->dups<staker_stake_t>(staker_id);
+
+        for (auto it = stakes.begin(); it != stakes.end(); ++it)
+        {
+            const auto entry = it.value();
+
+            results[entry.candidate_key].push_back(entry.stake);
+        }
+
+        return results;
+    }
+
+    Error StakingEngine::load_vote_tallies()
+    {
+        std::map<crypto_public_key_t, uint64_t> stored;
+
+        {
+            auto txn = m_db_candidate_votes->transaction(true);
+
+            auto tallies = txn->range<crypto_public_key_t, vote_tally_t>();
+
+            for (auto it = tallies.begin(); it != tallies.end(); ++it)
+            {
+                stored[it.key()] = it.value().votes;
+            }
+
+            if (tallies.error())
+            {
+                return tallies.error();
+            }
+        }
+
+        if (stored.empty())
+        {
+            const auto [error, count] = m_db_stakes->transaction(true)->count();
+
+            if (error)
+            {
+                return error;
+            }
+
+            if (count != 0)
+            {
+                return store_vote_tallies();
+            }
+        }
+
+        std::unique_lock lock(m_candidate_votes_mutex);
+
+        m_candidate_votes = stored;
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    Error StakingEngine::prune_round_frontiers(std::unique_ptr<Database::LMDBTransaction> &txn, const uint64_t &round)
+    {
+        const auto first_block_index = round * Configuration::Consensus::BLOCKS_PER_ROUND;
+
+        const auto last_block_index = first_block_index + Configuration::Consensus::BLOCKS_PER_ROUND - 1;
+
+        txn->set_database(m_db_round_frontiers);
+
+        // the round may already have been pruned or may never have been accumulated at all
+        for (auto block_index = first_block_index; block_index < last_block_index; ++block_index)
+        {
+            const auto error = txn->del(block_index);
+
+            if (error && error != LMDB_NOTFOUND)
+            {
+                return error;
+            }
+        }
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    Error StakingEngine::rebuild_vote_tallies()
+    {
+        std::scoped_lock lock(stakes_mutex);
+
+        return store_vote_tallies();
+    }
+
+    Error StakingEngine::recall_stake(
+        const Types::Staking::staker_t &staker,
+        const crypto_hash_t &stake_txn,
+        const crypto_public_key_t &candidate_key,
+        const uint64_t &stake)
+    {
+        std::scoped_lock lock(stakes_mutex);
+
+        // create the stake record
+        const auto stake_record = Types::Staking::stake_t(staker.id(), stake_txn, stake);
+
+    try_again:
+        auto txn = m_db_stakes->transaction();
+
+        std::set<crypto_public_key_t> changed_candidates;
+
+        // now delete it
+        auto error = recall_stake(txn, candidate_key, stake_record, changed_candidates);
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        if (error)
+        {
+            return error;
+        }
+
+        error = txn->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        if (!error)
+        {
+            refresh_candidate_votes(changed_candidates);
+        }
+
+        return error;
+    }
+
+    Error StakingEngine::recall_stake(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const crypto_public_key_t &candidate_key,
+        const Types::Staking::stake_t &stake,
+        std::set<crypto_public_key_t> &changed_candidates)
+    {
+        const auto [votes_error, current_votes] = read_candidate_votes(txn, candidate_key);
+
+        if (votes_error)
+        {
+            return votes_error;
+        }
+
+        txn->set_database(m_db_stakes);
+
+        {
+            const auto error = txn->del(candidate_key, stake.serialize());
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        // along with its entry in the staker index
+        txn->set_database(m_db_staker_stakes);
+
+        {
+            const auto error = txn->del(stake.staker_id, staker_stake_t(candidate_key, stake).serialize());
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        // and take the stake off the vote tally of the candidate; a tally can only hold less than one
+        // of its stakes if it is damaged, which check_vote_tallies() reports
+        const auto votes = (current_votes > stake.stake) ? current_votes - stake.stake : 0;
+
+        txn->set_database(m_db_candidate_votes);
+
+        const auto error =
+            (votes != 0) ? txn->put(candidate_key, vote_tally_t(votes).serialize()) : txn->del(candidate_key);
+
+        if (error && error != LMDB_NOTFOUND)
+        {
+            return error;
+        }
+
+        changed_candidates.insert(candidate_key);
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
+    Error StakingEngine::record_stake(
+        const Types::Staking::staker_t &staker,
+        const crypto_hash_t &stake_txn,
+        const crypto_public_key_t &candidate_key,
+        const uint64_t &stake)
+    {
+        std::scoped_lock lock(stakes_mutex);
+
+        // create the stake record
+        const auto stake_record = Types::Staking::stake_t(staker.id(), stake_txn, stake);
+
+    try_again:
+        auto txn = m_db_stakes->transaction();
+
+        std::set<crypto_public_key_t> changed_candidates;
+
+        bool staker_added = false;
+
+        // the candidate check, the staker and the stake are all written by the one transaction
+        auto error = record_stake(txn, staker, candidate_key, stake_record, changed_candidates, staker_added);
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        if (error)
+        {
+            return error;
+        }
+
+        error = txn->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        if (!error)
+        {
+            refresh_candidate_votes(changed_candidates);
+        }
+
+        return error;
+    }
+
+    Error StakingEngine::record_stake(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const Types::Staking::staker_t &staker,
+        const crypto_public_key_t &candidate_key,
+        const Types::Staking::stake_t &stake,
+        std::set<crypto_public_key_t> &changed_candidates,
+        bool &staker_added)
+    {
+        // can't stake a candidate that does not exist
+        txn->set_database(m_db_candidates);
+
+        if (!txn->exists(candidate_key))
+        {
+            return MAKE_ERROR(STAKING_CANDIDATE_NOT_FOUND);
+        }
+
+        // add the staker to the database
+        txn->set_database(m_db_stakers);
+
+        staker_added = !txn->exists(stake.staker_id);
+
+        if (staker_added)
+        {
+            const auto error = txn->put(stake.staker_id, staker.serialize());
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        const auto [votes_error, current_votes] = read_candidate_votes(txn, candidate_key);
+
+        if (votes_error)
+        {
+            return votes_error;
+        }
+
+        // attempt to write the stake to the database, refusing a stake that is already recorded as
+        // it would otherwise be counted twice by the vote tally
+        txn->set_database(m_db_stakes);
+
+        {
+            const auto error = txn->put(candidate_key, stake.serialize(), MDB_NODUPDATA);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        // along with its entry in the staker index
+        txn->set_database(m_db_staker_stakes);
+
+        {
+            const auto error = txn->put(stake.staker_id, staker_stake_t(candidate_key, stake).serialize());
+
+            if (error)
+            {
+                return error;
+            }
+        }
 
-        m_db_candidates = m_db_env->open_database("candidates");
+        // and add the stake to the vote tally of the candidate
+        txn->set_database(m_db_candidate_votes);
 
-        m_db_stakers = m_db_env->open_database("stakers");
+        const auto error = txn->put(candidate_key, vote_tally_t(current_votes + stake.stake).serialize());
 
-        m_db_stakes = m_db_env->open_database("stakes", MDB_CREATE | MDB_DUPSORT);
+        if (error)
+        {
+            return error;
+        }
+
+        changed_candidates.insert(candidate_key);
+
+        return MAKE_ERROR(SUCCESS);
     }
 
-    Error StakingEngine::add_candidate(const Types::Staking::candidate_node_t &candidate)
+    std::tuple<Error, uint64_t> StakingEngine::read_candidate_votes(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const crypto_public_key_t &candidate_key)
     {
-        std::scoped_lock lock(candidates_mutex);
+        txn->set_database(m_db_candidate_votes);
 
-        return m_db_candidates->put(candidate.public_signing_key, candidate.serialize());
+        const auto [error, tally] = txn->get<crypto_public_key_t, vote_tally_t>(candidate_key);
+
+        if (error == LMDB_NOTFOUND)
+        {
+            return {MAKE_ERROR(SUCCESS), 0};
+        }
+
+        return {error, tally.votes};
     }
 
-    Error StakingEngine::add_staker(const Types::Staking::staker_t &staker)
+    void StakingEngine::refresh_candidate_votes(const std::set<crypto_public_key_t> &candidate_keys)
     {
-        std::scoped_lock lock(stakers_mutex);
+        if (candidate_keys.empty())
+        {
+            return;
+        }
 
-        return m_db_stakers->put(staker.id(), staker.serialize());
+        auto txn = m_db_candidate_votes->transaction(true);
+
+        std::unique_lock lock(m_candidate_votes_mutex);
+
+        // the tallies are read back rather than carried over so that they are always the latest committed
+        for (const auto &candidate_key : candidate_keys)
+        {
+            const auto [error, votes] = read_candidate_votes(txn, candidate_key);
+
+            if (!error && votes != 0)
+            {
+                m_candidate_votes[candidate_key] = votes;
+            }
+            else
+            {
+                m_candidate_votes.erase(candidate_key);
+            }
+        }
     }
 
-    std::tuple<crypto_public_key_t, uint256_t, bool>
-        StakingEngine::calculate_election_seed(const std::vector<crypto_hash_t> &last_round_blocks)
+    Error StakingEngine::restore_round_seed(const uint64_t &round, const std::vector<crypto_hash_t> &block_hashes)
     {
-        /**
-         * First, we take the hashes of every block in the now closed round and calculate
-         * the Merkle root for those hashes to establish M as the election seed for the next round
-         */
-        const auto M = Crypto::Hashing::Merkle::root_hash(last_round_blocks);
+        if (block_hashes.size() != Configuration::Consensus::BLOCKS_PER_ROUND)
+        {
+            return MAKE_ERROR(STAKING_ROUND_INCOMPLETE);
+        }
 
-        /**
-         * Then we take M and convert it to a scalar p via Hs(M) and compute the public key P of p
-         * Note: shortcut used as hash_to_point does just that
-         */
-        const auto P = Crypto::hash_to_point(M);
+        merkle_frontier_t frontier;
 
-        // Then we tally the individual bytes of P...
-        uint64_t sum = 0;
+        for (const auto &block_hash : block_hashes)
+        {
+            frontier.append(block_hash);
+        }
 
-        for (int i = 0; i < P.size(); ++i)
+        const auto last_block_index = (round + 1) * Configuration::Consensus::BLOCKS_PER_ROUND - 1;
+
+        std::scoped_lock lock(stakes_mutex);
+
+    try_again:
+        auto txn = m_db_round_frontiers->transaction();
+
+        // the final block of the round applied to the engine must be the one hashed, or the seed would be stale
         {
-            sum += P[i];
+            txn->set_database(m_db_staking_undo);
+
+            const auto [undo_error, undo] = txn->get<staking_undo_t>(last_block_index);
+
+            if (undo_error || undo.block_hash != block_hashes.back())
+            {
+                return MAKE_ERROR(STAKING_ROUND_INCOMPLETE);
+            }
         }
 
-        // And determine if the result of that is even or odd (returning true if even)
-        return {P, P.to_uint256_t(), sum % 2 == 0};
-    }
+        txn->set_database(m_db_round_frontiers);
 
-    Error StakingEngine::delete_candidate(const crypto_public_key_t &candidate_key)
-    {
-        std::scoped_lock lock(candidates_mutex);
+        auto error = txn->put(last_block_index, frontier.serialize());
 
-        const auto [error, candidate] = get_candidate(candidate_key);
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
 
         if (error)
         {
-            return {MAKE_ERROR(STAKING_CANDIDATE_NOT_FOUND)};
+            return error;
         }
 
-        return m_db_candidates->del(candidate_key);
+        error = txn->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        return error;
     }
 
-    Error StakingEngine::delete_staker(const crypto_hash_t &staker_id)
+    Error StakingEngine::revert_block_staking(const Types::Blockchain::block_t &block)
     {
-        std::scoped_lock lock(stakers_mutex);
+        std::scoped_lock lock(stakes_mutex);
 
-        const auto [error, staker] = get_staker(staker_id);
+    try_again:
+        auto txn = m_db_stakes->transaction();
+
+        auto [error, changed_candidates] = revert_block_staking(txn, block);
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
 
         if (error)
         {
-            return {MAKE_ERROR(STAKING_STAKER_NOT_FOUND)};
+            return error;
         }
 
-        return m_db_stakers->del(staker_id);
-    }
+        error = txn->commit();
 
-    std::tuple<Error, Types::Staking::candidate_node_t>
-        StakingEngine::get_candidate(const crypto_public_key_t &candidate_key)
-    {
-        const auto [error, candidate] =
-            m_db_candidates->get<crypto_public_key_t, Types::Staking::candidate_node_t>(candidate_key);
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
 
-        if (error)
+        if (!error)
         {
-            return {MAKE_ERROR(STAKING_CANDIDATE_NOT_FOUND), {}};
+            refresh_candidate_votes(changed_candidates);
         }
 
-        return {error, candidate};
+        return error;
     }
 
-    std::vector<Types::Staking::stake_t> StakingEngine::get_candidate_stakes(const crypto_public_key_t &candidate_key)
+    std::tuple<Error, std::set<crypto_public_key_t>> StakingEngine::revert_block_staking(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const Types::Blockchain::block_t &block)
     {
-        auto txn = m_db_stakes->transaction(true);
+        std::set<crypto_public_key_t> changed_candidates;
 
-        auto cursor = txn->cursor();
+        txn->set_database(m_db_staking_undo);
 
-        const auto [error, key, stakes] = cursor->get_all<crypto_public_key_t, Types::Staking::stake_t>(candidate_key);
+        const auto [undo_error, undo] = txn->get<staking_undo_t>(block.block_index);
 
-        return stakes;
-    }
+        if (undo_error)
+        {
+            return {MAKE_ERROR(STAKING_UNDO_NOT_FOUND), {}};
+        }
 
-    uint64_t StakingEngine::get_candidate_votes(const crypto_public_key_t &candidate_key)
-    {
-        uint64_t votes = 0;
+        if (undo.block_hash != block.hash())
+        {
+            return {MAKE_ERROR_MSG(STAKING_UNDO_NOT_FOUND, "The staking undo record belongs to another block."), {}};
+        }
 
-        auto txn = m_db_stakes->transaction(true);
+        // the changes are undone in the reverse of the order in which they were applied
+        for (auto it = undo.changes.rbegin(); it != undo.changes.rend(); ++it)
+        {
+            const auto error = (it->recalled) ? restore_stake(txn, it->candidate_key, it->stake, changed_candidates)
+                                              : recall_stake(txn, it->candidate_key, it->stake, changed_candidates);
 
-        auto cursor = txn->cursor();
+            if (error)
+            {
+                return {error, {}};
+            }
+        }
 
-        const auto [error, key, values] = cursor->get_all<crypto_public_key_t, Types::Staking::stake_t>(candidate_key);
+        txn->set_database(m_db_stakers);
 
-        if (!error)
+        for (const auto &staker_id : undo.added_stakers)
         {
-            for (const auto &value : values)
+            const auto error = txn->del(staker_id);
+
+            if (error)
             {
-                votes += value.stake;
+                return {error, {}};
             }
         }
 
-        return votes;
-    }
+        txn->set_database(m_db_staking_undo);
 
-    std::vector<crypto_public_key_t> StakingEngine::get_candidates()
-    {
-        return m_db_candidates->list_keys<crypto_public_key_t>();
-    }
+        auto error = txn->del(block.block_index);
 
-    std::vector<crypto_hash_t> StakingEngine::get_stakers()
-    {
-        return m_db_stakers->list_keys<crypto_hash_t>();
+        if (error)
+        {
+            return {error, {}};
+        }
+
+        // the block may not have a frontier if its round was not accumulated from its first block
+        txn->set_database(m_db_round_frontiers);
+
+        error = txn->del(block.block_index);
+
+        if (error && error != LMDB_NOTFOUND)
+        {
+            return {error, {}};
+        }
+
+        // the tallies saved at the final block of a round are reverted along with it
+        if ((block.block_index + 1) % Configuration::Consensus::BLOCKS_PER_ROUND == 0)
+        {
+            txn->set_database(m_db_round_tallies);
+
+            error = txn->del(block.block_index / Configuration::Consensus::BLOCKS_PER_ROUND);
+
+            if (error && error != LMDB_NOTFOUND)
+            {
+                return {error, {}};
+            }
+        }
+
+        return {MAKE_ERROR(SUCCESS), changed_candidates};
     }
 
-    std::tuple<Error, Types::Staking::staker_t> StakingEngine::get_staker(const crypto_hash_t &staker_key)
+    Error StakingEngine::restore_stake(
+        std::unique_ptr<Database::LMDBTransaction> &txn,
+        const crypto_public_key_t &candidate_key,
+        const Types::Staking::stake_t &stake,
+        std::set<crypto_public_key_t> &changed_candidates)
     {
-        const auto [error, staker] = m_db_stakers->get<crypto_hash_t, Types::Staking::staker_t>(staker_key);
+        // the staker of a recalled stake is already known as stakers are only removed by a revert
+        txn->set_database(m_db_stakers);
 
-        if (error)
+        const auto [staker_error, staker] = txn->get<crypto_hash_t, Types::Staking::staker_t>(stake.staker_id);
+
+        if (staker_error)
         {
-            return {MAKE_ERROR(STAKING_STAKER_NOT_FOUND), {}};
+            return MAKE_ERROR(STAKING_STAKER_NOT_FOUND);
         }
 
-        return {error, staker};
+        bool staker_added = false;
+
+        return record_stake(txn, staker, candidate_key, stake, changed_candidates, staker_added);
     }
 
-    uint64_t StakingEngine::get_staker_candidate_votes(
-        const crypto_hash_t &staker_id,
-        const crypto_public_key_t &candidate_key)
+    Error StakingEngine::rebuild_staker_index()
     {
-        uint64_t votes = 0;
+        {
+            const auto [error, count] = m_db_staker_stakes->transaction(true)->count();
+
+            if (error || count != 0)
+            {
+                return error;
+            }
+        }
+
+        std::vector<std::tuple<crypto_hash_t, std::vector<uint8_t>>> entries;
+
+        {
+            // stream every stake of every candidate in a single pass over the stakes database
+            auto stakes = m_db_stakes->range<crypto_public_key_t, Types::Staking::stake_t>();
 
-        const auto staker_stakes = get_staker_stakes(staker_id);
+            for (auto it = stakes.begin(); it != stakes.end(); ++it)
+            {
+                const auto stake = it.value();
+
+                entries.emplace_back(stake.staker_id, staker_stake_t(it.key(), stake).serialize());
+            }
+
+            if (stakes.error())
+            {
+                return stakes.error();
+            }
+        }
+
+        if (entries.empty())
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
 
-        if (staker_stakes.find(candidate_key) != staker_stakes.end())
+    try_again:
+        auto txn = m_db_staker_stakes->transaction();
+
+        for (const auto &[staker_id, entry] : entries)
         {
-            const auto &stakes = staker_stakes.at(candidate_key);
+            auto error = txn->put(staker_id, entry);
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
 
-            for (const auto &stake : stakes)
+            if (error)
             {
-                votes += stake.stake;
+                return error;
             }
         }
 
-        return votes;
+        auto error = txn->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, txn, try_again);
+
+        return error;
     }
 
-    std::map<crypto_public_key_t, std::vector<Types::Staking::stake_t>>
-        StakingEngine::get_staker_stakes(const crypto_hash_t &staker_id)
+    Error StakingEngine::snapshot_round_tallies(std::unique_ptr<Database::LMDBTransaction> &txn, const uint64_t &round)
     {
-        std::map<crypto_public_key_t, std::vector<Types::Staking::stake_t>> results;
+        round_tallies_t snapshot;
 
-        // get all of the candidate keys
-        const auto candidates = m_db_stakes->list_keys<crypto_public_key_t>();
-
-        // loop through the candidate keys
-        for (const auto &candidate : candidates)
         {
-            // get all of the stakes for the candidate
-            const auto stakes = get_candidate_stakes(candidate);
+            txn->set_database(m_db_candidate_votes);
 
-            std::vector<Types::Staking::stake_t> candidate_stakes;
+            auto tallies = txn->range<crypto_public_key_t, vote_tally_t>();
 
-            // loop through the stakes
-            for (const auto &stake : stakes)
+            for (auto it = tallies.begin(); it != tallies.end(); ++it)
             {
-                // if the staker id of the stake matches what we requested, add it to the results
-                if (stake.staker_id == staker_id)
-                {
-                    candidate_stakes.push_back(stake);
-                }
+                snapshot.tallies.emplace_back(it.key(), it.value().votes);
             }
 
-            if (!candidate_stakes.empty())
+            if (tallies.error())
             {
-                results.insert({candidate, candidate_stakes});
+                return tallies.error();
             }
         }
 
-        return results;
-    }
+        // only the candidates that are still standing take part in the election
+        txn->set_database(m_db_candidates);
 
-    Error StakingEngine::recall_stake(
-        const Types::Staking::staker_t &staker,
-        const crypto_hash_t &stake_txn,
-        const crypto_public_key_t &candidate_key,
-        const uint64_t &stake)
-    {
-        std::scoped_lock lock(stakes_mutex);
+        snapshot.tallies.erase(
+            std::remove_if(
+                snapshot.tallies.begin(),
+                snapshot.tallies.end(),
+                [&txn](const auto &entry) { return !txn->exists(std::get<0>(entry)); }),
+            snapshot.tallies.end());
 
-        // create the stake record
-        const auto stake_record = Types::Staking::stake_t(staker.id(), stake_txn, stake);
+        txn->set_database(m_db_round_tallies);
 
-        // now delete it
-        return m_db_stakes->del(candidate_key, stake_record.serialize());
+        return txn->put(round, snapshot.serialize());
     }
 
-    Error StakingEngine::record_stake(
-        const Types::Staking::staker_t &staker,
-        const crypto_hash_t &stake_txn,
-        const crypto_public_key_t &candidate_key,
-        const uint64_t &stake)
+    Error StakingEngine::store_vote_tallies()
     {
-        std::scoped_lock lock(stakes_mutex);
+    try_again:
+        auto txn = m_db_candidate_votes->transaction();
 
+        const auto [error, votes] = count_votes(txn);
+
+        if (error)
         {
-            // check to see if the candidate exists
-            const auto [error, value] = get_candidate(candidate_key);
+            return error;
+        }
 
-            // can't stake a candidate that does not exist
-            if (error)
+        txn->set_database(m_db_candidate_votes);
+
+        std::vector<crypto_public_key_t> stored;
+
+        {
+            auto tallies = txn->range<crypto_public_key_t, vote_tally_t>();
+
+            for (auto it = tallies.begin(); it != tallies.end(); ++it)
+            {
+                stored.push_back(it.key());
+            }
+
+            if (tallies.error())
             {
-                return MAKE_ERROR(STAKING_CANDIDATE_NOT_FOUND);
+                return tallies.error();
             }
         }
 
+        // the tallies of candidates that no longer hold any votes are removed
+        for (const auto &candidate_key : stored)
         {
-            // add the staker to the database
-            auto error = add_staker(staker);
+            if (votes.find(candidate_key) != votes.end())
+            {
+                continue;
+            }
 
-            if (error)
+            auto del_error = txn->del(candidate_key);
+
+            MDB_CHECK_TXN_EXPAND(del_error, m_db_env, txn, try_again);
+
+            if (del_error)
             {
-                return error;
+                return del_error;
             }
         }
 
-        // create the stake record
-        const auto stake_record = Types::Staking::stake_t(staker.id(), stake_txn, stake);
-
+        for (const auto &[candidate_key, candidate_votes] : votes)
         {
-            const auto [error, value] = get_staker(staker.id());
+            auto put_error = txn->put(candidate_key, vote_tally_t(candidate_votes).serialize());
 
-            if (error)
+            MDB_CHECK_TXN_EXPAND(put_error, m_db_env, txn, try_again);
+
+            if (put_error)
             {
-                return error;
+                return put_error;
             }
         }
 
-        // attempt to write the stake to the database
-        return m_db_stakes->put(candidate_key, stake_record.serialize());
+        auto commit_error = txn->commit();
+
+        MDB_CHECK_TXN_EXPAND(commit_error, m_db_env, txn, try_again);
+
+        if (!commit_error)
+        {
+            std::unique_lock lock(m_candidate_votes_mutex);
+
+            m_candidate_votes = votes;
+        }
+
+        return commit_error;
     }
 
     std::tuple<std::vector<crypto_public_key_t>, std::vector<crypto_public_key_t>>
         StakingEngine::run_election(const std::vector<crypto_hash_t> &last_round_blocks, size_t maximum_keys)
+    {
+        return run_election(Crypto::Hashing::Merkle::root_hash(last_round_blocks), maximum_keys);
+    }
+
+    std::tuple<std::vector<crypto_public_key_t>, std::vector<crypto_public_key_t>>
+        StakingEngine::run_election(const crypto_hash_t &round_seed, size_t maximum_keys)
     {
         // Fetch all of the candidates public keys so we can do some electing
         const auto candidates = get_candidates();
 
+        // Fetch the vote tallies of the candidates holding votes, which are sorted by candidate key
+        const auto tallies = get_candidate_tallies();
+
+        std::vector<std::tuple<crypto_public_key_t, uint64_t>> candidate_votes;
+
+        for (const auto &candidate : candidates)
+        {
+            const auto tally = std::lower_bound(
+                tallies.begin(),
+                tallies.end(),
+                candidate,
+                [](const auto &entry, const crypto_public_key_t &key) { return std::get<0>(entry) < key; });
+
+            // Candidates with no votes don't get to come to the party
+            if (tally != tallies.end() && std::get<0>(*tally) == candidate)
+            {
+                candidate_votes.push_back(*tally);
+            }
+        }
+
+        return run_election(round_seed, candidate_votes, maximum_keys);
+    }
+
+    std::tuple<std::vector<crypto_public_key_t>, std::vector<crypto_public_key_t>> StakingEngine::run_election(
+        const crypto_hash_t &round_seed,
+        const std::vector<std::tuple<crypto_public_key_t, uint64_t>> &candidate_votes,
+        size_t maximum_keys)
+    {
         // Fetch the round seed
-        const auto [P, P_val, P_even] = calculate_election_seed(last_round_blocks);
+        const auto [P, P_val, P_even] = calculate_election_seed(round_seed);
 
         // set up our upper and lower houses (producers & validators)
         std::map<uint256_t, crypto_public_key_t> upper_house, lower_house;
@@ -288,16 +1430,8 @@ namespace Core
         auto &validator_candidates = (P_even) ? upper_house : lower_house;
 
         // Loop through all of the candidates to figure out what house they go into
-        for (const auto &candidate : candidates)
+        for (const auto &[candidate, votes] : candidate_votes)
         {
-            const auto votes = get_candidate_votes(candidate);
-
-            // Candidates with no votes don't get to come to the party
-            if (votes == 0)
-            {
-                continue;
-            }
-
             // If the candidate is less than P, it goes in the lower house; otherwise, in the upper house
             auto &target_house = (candidate <= P) ? lower_house : upper_house;
 
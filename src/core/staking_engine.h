@@ -6,10 +6,28 @@
 #define CORE_STAKING_ENGINE_H
 
 #include <db_lmdb.h>
+#include <merkle_frontier.h>
+#include <set>
+#include <shared_mutex>
 #include <types.h>
 
 namespace Core
 {
+    /**
+     * A candidate whose stored (or in-memory) vote tally differs from the tally counted from
+     * its stakes
+     */
+    struct vote_tally_mismatch_t
+    {
+        crypto_public_key_t candidate_key;
+
+        uint64_t stored_votes = 0;
+
+        uint64_t cached_votes = 0;
+
+        uint64_t counted_votes = 0;
+    };
+
     /**
      * Represents the core staking engine
      */
@@ -23,6 +41,14 @@ namespace Core
          */
         StakingEngine(const std::string &db_path);
 
+        /**
+         * Creates a new instance of the Staking Engine with its tables held in the provided
+         * environment (ie. that of the blockchain storage) so that the staking changes of a
+         * block can be written within the same write transaction as the block
+         * @param db_env
+         */
+        StakingEngine(std::shared_ptr<Database::LMDB> db_env);
+
         /**
          * Adds a new candidate to the database
          * @param candidate the candidate public key
@@ -37,6 +63,38 @@ namespace Core
          */
         Error add_staker(const Types::Staking::staker_t &staker);
 
+        /**
+         * Applies every staker and stake change made by the transactions of a block (stake
+         * transactions record a stake, adding its staker if needed, and recall stake transactions
+         * recall one) within a single write transaction along with an undo record for the block
+         *
+         * Either every change of the block is applied or, if any of them fails, none are.
+         *
+         * @param block
+         * @param transactions
+         * @return
+         */
+        Error apply_block_staking(
+            const Types::Blockchain::block_t &block,
+            const std::vector<Types::Blockchain::transaction_t> &transactions);
+
+        /**
+         * Applies the staking changes of a block within the write transaction supplied, which
+         * must have been opened on the environment of the staking engine
+         *
+         * Once (and only if) the write transaction commits, the caller must pass the candidates
+         * returned to refresh_candidate_votes().
+         *
+         * @param txn
+         * @param block
+         * @param transactions
+         * @return [error, changed_candidates]
+         */
+        std::tuple<Error, std::set<crypto_public_key_t>> apply_block_staking(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const Types::Blockchain::block_t &block,
+            const std::vector<Types::Blockchain::transaction_t> &transactions);
+
         /**
          * Calculates the election seed from the given last blocks presented
          * @param last_round_blocks the hashes of the blocks in the last round
@@ -45,6 +103,24 @@ namespace Core
         std::tuple<crypto_public_key_t, uint256_t, bool>
             calculate_election_seed(const std::vector<crypto_hash_t> &last_round_blocks);
 
+        /**
+         * Calculates the election seed from the Merkle root (M) of the hashes of the blocks in the
+         * last round
+         * @param round_seed the Merkle root of the hashes of the blocks in the last round
+         * @return [seed, seed_uint, evenness]
+         */
+        std::tuple<crypto_public_key_t, uint256_t, bool> calculate_election_seed(const crypto_hash_t &round_seed);
+
+        /**
+         * Counts the votes of every candidate from its stakes and compares the counts against
+         * the stored vote tallies and the vote tallies held in memory
+         *
+         * The stakes and the stored tallies are read from the same read transaction.
+         *
+         * @return [error, mismatches]
+         */
+        std::tuple<Error, std::vector<vote_tally_mismatch_t>> check_vote_tallies();
+
         /**
          * Deletes the candidate from the database
          * @param candidate_key
@@ -73,11 +149,20 @@ namespace Core
          */
         std::vector<Types::Staking::stake_t> get_candidate_stakes(const crypto_public_key_t &candidate_key);
 
+        /**
+         * Retrieves the vote tally of every candidate holding votes, in candidate key order
+         *
+         * @return [candidate_key, votes]
+         */
+        std::vector<std::tuple<crypto_public_key_t, uint64_t>> get_candidate_tallies();
+
         /**
          * Retrieves the number of votes for a specific candidate key
          *
          * Returns 0 if the candidate is unknown
          *
+         * The votes are read from the vote tallies held in memory
+         *
          * @param candidate_key
          * @return
          */
@@ -89,6 +174,36 @@ namespace Core
          */
         std::vector<crypto_public_key_t> get_candidates();
 
+        /**
+         * Retrieves the Merkle frontier of the round of the given block as it stood once the
+         * block was applied
+         *
+         * Only the final block of a round keeps its frontier once the round after it is complete.
+         *
+         * @param block_index
+         * @return
+         */
+        std::tuple<Error, merkle_frontier_t> get_round_frontier(const uint64_t &block_index);
+
+        /**
+         * Retrieves the election seed (M) established by the blocks of the given round, which is
+         * taken from the Merkle frontier accumulated as the blocks of the round were applied
+         *
+         * @param round
+         * @return
+         */
+        std::tuple<Error, crypto_hash_t> get_round_seed(const uint64_t &round);
+
+        /**
+         * Retrieves the vote tallies of the standing candidates as they stood at the final block
+         * of the given round, from which the next round is elected, in candidate key order
+         *
+         * @param round
+         * @return [candidate_key, votes]
+         */
+        std::tuple<Error, std::vector<std::tuple<crypto_public_key_t, uint64_t>>>
+            get_round_tallies(const uint64_t &round);
+
         /**
          * Retrieves the staker record for the given staker key
          * @param staker_key
@@ -98,6 +213,9 @@ namespace Core
 
         /**
          * Retrieves all tally of all of a staker's votes for a particular candidate
+         *
+         * Only the stakes of the staker are visited (through the staker index)
+         *
          * @param staker_id
          * @param candidate_key
          * @return
@@ -112,6 +230,9 @@ namespace Core
 
         /**
          * Retrieve all of the stakes that the given staker has placed
+         *
+         * Only the stakes of the staker are visited (through the staker index)
+         *
          * @param staker_id
          * @return
          */
@@ -120,6 +241,10 @@ namespace Core
 
         /**
          * Recall a the stake with the given parameters
+         *
+         * The stake, its staker index entry and the vote tally of the candidate are updated within
+         * the same write transaction
+         *
          * @param staker
          * @param stake_txn
          * @param candidate_key
@@ -134,6 +259,10 @@ namespace Core
 
         /**
          * Records a stake with the given parameters
+         *
+         * The stake, its staker index entry and the vote tally of the candidate are updated within
+         * the same write transaction
+         *
          * @param staker
          * @param stake_txn
          * @param candidate_key
@@ -146,6 +275,63 @@ namespace Core
             const crypto_public_key_t &candidate_key,
             const uint64_t &stake);
 
+        /**
+         * Reloads the vote tallies held in memory for the candidates specified from the stored
+         * vote tallies, which is required after committing a write transaction passed to
+         * apply_block_staking() or revert_block_staking()
+         *
+         * @param candidate_keys
+         */
+        void refresh_candidate_votes(const std::set<crypto_public_key_t> &candidate_keys);
+
+        /**
+         * Counts the votes of every candidate from its stakes and replaces the stored vote tallies
+         * (and those held in memory) with the counts
+         *
+         * @return
+         */
+        Error rebuild_vote_tallies();
+
+        /**
+         * Saves the completed Merkle frontier of the given round built from the hashes of all of
+         * its blocks (ie. as stored by the blockchain storage) for a round whose frontier was not
+         * accumulated as its blocks were applied, such as when the engine started part way through it
+         *
+         * The final block of the round must have been applied to the engine and its hash must be
+         * the last of the hashes supplied.
+         *
+         * @param round
+         * @param block_hashes
+         * @return
+         */
+        Error restore_round_seed(const uint64_t &round, const std::vector<crypto_hash_t> &block_hashes);
+
+        /**
+         * Reverts the staking changes applied for the block using its undo record within a single
+         * write transaction
+         *
+         * Blocks must be reverted in the reverse of the order in which they were applied.
+         *
+         * @param block
+         * @return
+         */
+        Error revert_block_staking(const Types::Blockchain::block_t &block);
+
+        /**
+         * Reverts the staking changes of a block within the write transaction supplied, which
+         * must have been opened on the environment of the staking engine
+         *
+         * Once (and only if) the write transaction commits, the caller must pass the candidates
+         * returned to refresh_candidate_votes().
+         *
+         * @param txn
+         * @param block
+         * @return [error, changed_candidates]
+         */
+        std::tuple<Error, std::set<crypto_public_key_t>> revert_block_staking(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const Types::Blockchain::block_t &block);
+
         /**
          * Performs the election process to determine the producers and validators for the next
          * round of blocks given the previous round of block hashes and returns, at maximum, the
@@ -158,12 +344,306 @@ namespace Core
             const std::vector<crypto_hash_t> &last_round_blocks,
             size_t maximum_keys = Configuration::Consensus::ELECTOR_TARGET_COUNT);
 
+        /**
+         * Performs the election process using the Merkle root (M) of the hashes of the blocks in
+         * the last round, which allows a caller that already holds M to skip recalculating it
+         * @param round_seed the Merkle root of the hashes of the blocks in the last round
+         * @param maximum_keys the maximum number of producers and validators to return in each set
+         * @return
+         */
+        std::tuple<std::vector<crypto_public_key_t>, std::vector<crypto_public_key_t>> run_election(
+            const crypto_hash_t &round_seed,
+            size_t maximum_keys = Configuration::Consensus::ELECTOR_TARGET_COUNT);
+
+        /**
+         * Performs the election process using the Merkle root (M) of the hashes of the blocks in
+         * the last round and the given vote tallies (ie. those saved at the final block of the last
+         * round) rather than the current vote tallies
+         * @param round_seed the Merkle root of the hashes of the blocks in the last round
+         * @param candidate_votes the votes of the candidates holding votes, in candidate key order
+         * @param maximum_keys the maximum number of producers and validators to return in each set
+         * @return
+         */
+        std::tuple<std::vector<crypto_public_key_t>, std::vector<crypto_public_key_t>> run_election(
+            const crypto_hash_t &round_seed,
+            const std::vector<std::tuple<crypto_public_key_t, uint64_t>> &candidate_votes,
+            size_t maximum_keys = Configuration::Consensus::ELECTOR_TARGET_COUNT);
+
       private:
+        /**
+         * An entry of the staker index, which holds a stake (as held under its candidate in the
+         * stakes database) under the id of the staker that placed it
+         */
+        struct staker_stake_t
+        {
+            staker_stake_t() = default;
+
+            staker_stake_t(const crypto_public_key_t &candidate_key, const Types::Staking::stake_t &stake);
+
+            staker_stake_t(const std::vector<uint8_t> &data);
+
+            [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+            crypto_public_key_t candidate_key;
+
+            Types::Staking::stake_t stake;
+        };
+
+        /**
+         * A stake recorded (or recalled) while applying a block
+         */
+        struct staking_change_t
+        {
+            bool recalled = false;
+
+            crypto_public_key_t candidate_key;
+
+            Types::Staking::stake_t stake;
+        };
+
+        /**
+         * The staking changes made by a block, in the order in which they were applied, along
+         * with the stakers that it added
+         */
+        struct staking_undo_t
+        {
+            staking_undo_t() = default;
+
+            staking_undo_t(const std::vector<uint8_t> &data);
+
+            [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+            crypto_hash_t block_hash;
+
+            std::vector<crypto_hash_t> added_stakers;
+
+            std::vector<staking_change_t> changes;
+        };
+
+        /**
+         * The vote tallies of the candidates holding votes (in candidate key order) as they stood
+         * at the final block of a round
+         */
+        struct round_tallies_t
+        {
+            round_tallies_t() = default;
+
+            round_tallies_t(const std::vector<uint8_t> &data);
+
+            [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+            std::vector<std::tuple<crypto_public_key_t, uint64_t>> tallies;
+        };
+
+        /**
+         * The stored vote tally of a candidate
+         */
+        struct vote_tally_t
+        {
+            vote_tally_t() = default;
+
+            vote_tally_t(uint64_t votes);
+
+            vote_tally_t(const std::vector<uint8_t> &data);
+
+            [[nodiscard]] std::vector<uint8_t> serialize() const;
+
+            uint64_t votes = 0;
+        };
+
+        /**
+         * Appends the hash of the block to the Merkle frontier of its round and saves the frontier
+         * under the block index within the transaction supplied
+         *
+         * The frontier of a round is only accumulated if it was accumulated from the first block
+         * of the round; otherwise the block is skipped. Completing a round prunes the frontiers of
+         * the round before it (see prune_round_frontiers()).
+         *
+         * @param txn
+         * @param block_index
+         * @param block_hash
+         * @return
+         */
+        Error append_round_block(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const uint64_t &block_index,
+            const crypto_hash_t &block_hash);
+
+        /**
+         * Counts the votes of every candidate from the stakes database within the transaction supplied
+         *
+         * @param txn
+         * @return [error, votes]
+         */
+        std::tuple<Error, std::map<crypto_public_key_t, uint64_t>>
+            count_votes(std::unique_ptr<Database::LMDBTransaction> &txn);
+
+        /**
+         * Finds the first stake (in the order of the staker index) that the staker placed with the
+         * candidate for the amount specified
+         *
+         * @param txn
+         * @param staker_id
+         * @param candidate_key
+         * @param amount
+         * @return
+         */
+        std::tuple<Error, Types::Staking::stake_t> find_stake(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const crypto_hash_t &staker_id,
+            const crypto_public_key_t &candidate_key,
+            uint64_t amount);
+
+        /**
+         * Loads the stored vote tallies into memory, counting them from the stakes first if there
+         * are stakes but no tallies, as is the case for databases written before the tallies existed
+         *
+         * @return
+         */
+        Error load_vote_tallies();
+
+        /**
+         * Deletes the frontiers saved by every block of the round but its final block within the
+         * transaction supplied, leaving only the frontier that its election seed is read from
+         *
+         * @param txn
+         * @param round
+         * @return
+         */
+        Error prune_round_frontiers(std::unique_ptr<Database::LMDBTransaction> &txn, const uint64_t &round);
+
+        /**
+         * Reads the stored vote tally of the candidate within the transaction supplied
+         *
+         * @param txn
+         * @param candidate_key
+         * @return [error, votes]
+         */
+        std::tuple<Error, uint64_t> read_candidate_votes(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const crypto_public_key_t &candidate_key);
+
+        /**
+         * Removes the stake, its staker index entry and its votes within the transaction supplied
+         *
+         * @param txn
+         * @param candidate_key
+         * @param stake
+         * @param changed_candidates
+         * @return
+         */
+        Error recall_stake(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const crypto_public_key_t &candidate_key,
+            const Types::Staking::stake_t &stake,
+            std::set<crypto_public_key_t> &changed_candidates);
+
+        /**
+         * Checks that the candidate exists then writes the staker (if it is not yet known), the
+         * stake, its staker index entry and its votes within the transaction supplied
+         *
+         * @param txn
+         * @param staker
+         * @param candidate_key
+         * @param stake
+         * @param changed_candidates
+         * @param staker_added whether the staker was added
+         * @return
+         */
+        Error record_stake(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const Types::Staking::staker_t &staker,
+            const crypto_public_key_t &candidate_key,
+            const Types::Staking::stake_t &stake,
+            std::set<crypto_public_key_t> &changed_candidates,
+            bool &staker_added);
+
+        /**
+         * Records a previously recalled stake again, within the transaction supplied
+         *
+         * @param txn
+         * @param candidate_key
+         * @param stake
+         * @param changed_candidates
+         * @return
+         */
+        Error restore_stake(
+            std::unique_ptr<Database::LMDBTransaction> &txn,
+            const crypto_public_key_t &candidate_key,
+            const Types::Staking::stake_t &stake,
+            std::set<crypto_public_key_t> &changed_candidates);
+
+        /**
+         * Saves the vote tallies of the standing candidates, as they are within the transaction
+         * supplied, as the tallies from which the round after the given round is elected
+         *
+         * @param txn
+         * @param round
+         * @return
+         */
+        Error snapshot_round_tallies(std::unique_ptr<Database::LMDBTransaction> &txn, const uint64_t &round);
+
+        /**
+         * Replaces the stored vote tallies (and those held in memory) with the votes counted from
+         * the stakes database
+         *
+         * Must be called while holding the stakes mutex (or from the constructor).
+         *
+         * @return
+         */
+        Error store_vote_tallies();
+
+        /**
+         * Builds the staker index from the stakes database if the index is empty while there
+         * are stakes, as is the case for databases written before the index existed
+         *
+         * @return
+         */
+        Error rebuild_staker_index();
+
         std::shared_ptr<Database::LMDB> m_db_env;
 
-        std::shared_ptr<Database::LMDBDatabase> m_db_candidates, m_db_stakers, m_db_stakes;
+        /**
+         * The staker index (m_db_staker_stakes) holds every stake of the stakes database keyed
+         * by the id of the staker that placed it so that per staker queries do not need to visit
+         * the stakes of every candidate
+         */
+        std::shared_ptr<Database::LMDBDatabase> m_db_candidates, m_db_stakers, m_db_stakes, m_db_staker_stakes;
+
+        /**
+         * The total of the stakes held by each candidate, which is adjusted as stakes are recorded
+         * and recalled rather than counted for every election
+         */
+        std::shared_ptr<Database::LMDBDatabase> m_db_candidate_votes;
+
+        /**
+         * The staking changes made by each block (by block index) so that they can be reverted
+         */
+        std::shared_ptr<Database::LMDBDatabase> m_db_staking_undo;
+
+        /**
+         * The Merkle frontier of each round (by block index) as it stood once the block was
+         * applied, so that reverting a block only removes its own frontier
+         *
+         * Every frontier of the current and the last completed round is kept so that blocks can be
+         * popped back through them; older rounds only keep the frontier of their final block.
+         */
+        std::shared_ptr<Database::LMDBDatabase> m_db_round_frontiers;
+
+        /**
+         * The vote tallies (by round) as they stood at the final block of each round
+         */
+        std::shared_ptr<Database::LMDBDatabase> m_db_round_tallies;
 
         std::mutex candidates_mutex, stakers_mutex, stakes_mutex;
+
+        /**
+         * The vote tallies held in memory mirror the stored vote tallies; they are only written
+         * once the write transaction that updated the stored tallies has committed
+         */
+        mutable std::shared_mutex m_candidate_votes_mutex;
+
+        std::map<crypto_public_key_t, uint64_t> m_candidate_votes;
     };
 } // namespace Core
 
@@ -0,0 +1,286 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "suffix_archive.h"
+
+#include <algorithm>
+
+namespace Core
+{
+    /**
+     * The largest possible pruning hash, used as the upper bound when paging through the archive
+     */
+    static const crypto_hash_t LAST_PRUNING_HASH =
+        crypto_hash_t("ffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
+
+    SuffixArchive::SuffixArchive(const std::string &db_path, size_t batch_size):
+        m_batch_size(std::max(batch_size, size_t(1))),
+        m_queued_count(0),
+        m_written_count(0),
+        m_running(true),
+        m_archived(0),
+        m_commits(0),
+        m_failed(0)
+    {
+        m_db_env = Database::LMDB::getInstance(
+            db_path, 0, 0600, Configuration::Database::MAP_MINIMUM_INCREMENT / (1024 * 1024));
+
+        m_suffixes = m_db_env->open_database("suffixes");
+
+        m_thread = std::thread(&SuffixArchive::writer_thread, this);
+    }
+
+    SuffixArchive::~SuffixArchive()
+    {
+        stop();
+    }
+
+    void SuffixArchive::archive(const Types::Blockchain::uncommitted_transaction_t &transaction)
+    {
+        // the suffix is hashed and serialized before taking the lock so that producers do not serialize on it
+        auto entry = std::visit(
+            [](auto &&arg)
+            {
+                const Types::Blockchain::transaction_suffix_t &suffix = arg;
+
+                return std::make_tuple(arg.pruning_hash(), suffix.serialize_suffix());
+            },
+            transaction);
+
+        {
+            std::unique_lock lock(m_mutex);
+
+            m_written.wait(
+                lock,
+                [this] { return m_queue.size() < Configuration::Database::SUFFIX_ARCHIVE_MAXIMUM_PENDING || !m_running; });
+
+            if (!m_running)
+            {
+                return;
+            }
+
+            m_queue.push_back(std::move(entry));
+
+            m_queued_count++;
+        }
+
+        m_queued.notify_one();
+    }
+
+    bool SuffixArchive::exists(const crypto_hash_t &pruning_hash) const
+    {
+        return m_suffixes->exists(pruning_hash);
+    }
+
+    std::tuple<Error, std::vector<crypto_hash_t>> SuffixArchive::flush()
+    {
+        Error write_error;
+
+        std::vector<crypto_hash_t> lost;
+
+        {
+            std::unique_lock lock(m_mutex);
+
+            const auto target = m_queued_count;
+
+            m_written.wait(lock, [this, target] { return m_written_count >= target; });
+
+            // each failure is only reported to the first flush() after it
+            std::swap(write_error, m_write_error);
+
+            std::swap(lost, m_lost);
+        }
+
+        const auto error = m_db_env->flush(true);
+
+        return {(write_error) ? write_error : error, lost};
+    }
+
+    std::tuple<Error, Types::Blockchain::transaction_suffix_t>
+        SuffixArchive::get_suffix(const crypto_hash_t &pruning_hash) const
+    {
+        return m_suffixes->get<crypto_hash_t, Types::Blockchain::transaction_suffix_t>(pruning_hash);
+    }
+
+    std::tuple<Error, std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_suffix_t>>>
+        SuffixArchive::get_suffixes(const std::vector<crypto_hash_t> &pruning_hashes) const
+    {
+        auto sorted_hashes = pruning_hashes;
+
+        std::sort(sorted_hashes.begin(), sorted_hashes.end());
+
+        std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_suffix_t>> results;
+
+        results.reserve(sorted_hashes.size());
+
+        auto db_tx = m_suffixes->transaction(true);
+
+        for (const auto &pruning_hash : sorted_hashes)
+        {
+            const auto [error, suffix] = db_tx->get<crypto_hash_t, Types::Blockchain::transaction_suffix_t>(pruning_hash);
+
+            if (error == LMDB_NOTFOUND)
+            {
+                continue;
+            }
+
+            if (error)
+            {
+                return {error, {}};
+            }
+
+            results.emplace_back(pruning_hash, suffix);
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    std::tuple<Error, std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_suffix_t>>>
+        SuffixArchive::get_suffix_range(const crypto_hash_t &start, size_t count) const
+    {
+        std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_suffix_t>> results;
+
+        auto suffixes = m_suffixes->range<crypto_hash_t, Types::Blockchain::transaction_suffix_t>(start, LAST_PRUNING_HASH);
+
+        for (auto it = suffixes.begin(); it != suffixes.end() && results.size() < count; ++it)
+        {
+            results.emplace_back(it.key(), it.value());
+        }
+
+        if (suffixes.error())
+        {
+            return {suffixes.error(), {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), results};
+    }
+
+    size_t SuffixArchive::pending() const
+    {
+        std::scoped_lock lock(m_mutex);
+
+        return m_queue.size();
+    }
+
+    SuffixArchive::stats_t SuffixArchive::stats() const
+    {
+        stats_t result;
+
+        result.archived = m_archived;
+
+        result.commits = m_commits;
+
+        result.failed = m_failed;
+
+        return result;
+    }
+
+    void SuffixArchive::stop()
+    {
+        {
+            std::scoped_lock lock(m_mutex);
+
+            m_running = false;
+        }
+
+        m_queued.notify_all();
+
+        m_written.notify_all();
+
+        if (m_thread.joinable())
+        {
+            m_thread.join();
+        }
+    }
+
+    Error SuffixArchive::write(const std::vector<std::tuple<crypto_hash_t, std::vector<uint8_t>>> &suffixes)
+    {
+    try_again:
+        auto db_tx = m_suffixes->transaction();
+
+        for (const auto &[pruning_hash, suffix] : suffixes)
+        {
+            auto error = db_tx->put(pruning_hash, suffix);
+
+            MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+            if (error)
+            {
+                return error;
+            }
+        }
+
+        auto error = db_tx->commit();
+
+        MDB_CHECK_TXN_EXPAND(error, m_db_env, db_tx, try_again);
+
+        if (!error)
+        {
+            m_db_env->maintain_map_size();
+        }
+
+        return error;
+    }
+
+    void SuffixArchive::writer_thread()
+    {
+        while (true)
+        {
+            std::vector<std::tuple<crypto_hash_t, std::vector<uint8_t>>> suffixes;
+
+            {
+                std::unique_lock lock(m_mutex);
+
+                m_queued.wait(lock, [this] { return !m_queue.empty() || !m_running; });
+
+                if (m_queue.empty())
+                {
+                    break;
+                }
+
+                while (!m_queue.empty() && suffixes.size() < m_batch_size)
+                {
+                    suffixes.push_back(std::move(m_queue.front()));
+
+                    m_queue.pop_front();
+                }
+            }
+
+            const auto error = write(suffixes);
+
+            m_commits++;
+
+            if (error)
+            {
+                m_failed += suffixes.size();
+            }
+            else
+            {
+                m_archived += suffixes.size();
+            }
+
+            {
+                std::scoped_lock lock(m_mutex);
+
+                // the suffixes of a failed batch are lost, which the next flush() reports to its caller
+                if (error)
+                {
+                    if (!m_write_error)
+                    {
+                        m_write_error = error;
+                    }
+
+                    for (const auto &[pruning_hash, suffix] : suffixes)
+                    {
+                        m_lost.push_back(pruning_hash);
+                    }
+                }
+
+                m_written_count += suffixes.size();
+            }
+
+            m_written.notify_all();
+        }
+    }
+} // namespace Core
@@ -0,0 +1,183 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef CORE_SUFFIX_ARCHIVE_H
+#define CORE_SUFFIX_ARCHIVE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <config.h>
+#include <db_lmdb.h>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <types.h>
+
+namespace Core
+{
+    /**
+     * Keeps the suffixes (offsets, signatures and range proof) of transactions that are dropped
+     * when a transaction is committed to the chain, keyed by the pruning hash that replaces them,
+     * so that auditors and archival peers can re-verify the history of the chain
+     *
+     * The archive lives in its own LMDB environment (which may be placed on a separate, slower
+     * disk) so that it does not add to the size of the blockchain storage environment. Suffixes
+     * are queued by archive() and written in batches by a background writer thread so that
+     * archiving never adds to the latency of storing blocks.
+     */
+    class SuffixArchive
+    {
+      public:
+        struct stats_t
+        {
+            size_t archived = 0;
+
+            size_t commits = 0;
+
+            size_t failed = 0;
+        };
+
+        /**
+         * Opens (or creates) the suffix archive at the specified path and starts its writer thread
+         *
+         * @param db_path
+         * @param batch_size the maximum number of suffixes written within a single write transaction
+         */
+        SuffixArchive(
+            const std::string &db_path,
+            size_t batch_size = Configuration::Database::SUFFIX_ARCHIVE_BATCH_SIZE);
+
+        /**
+         * Destroying the instance stops the writer thread after it has written every queued suffix
+         */
+        ~SuffixArchive();
+
+        /**
+         * Queues the suffix of the verified transaction to be written to the archive
+         *
+         * This only blocks if the writer thread has fallen far enough behind that the queue is full.
+         *
+         * @param transaction
+         */
+        void archive(const Types::Blockchain::uncommitted_transaction_t &transaction);
+
+        /**
+         * Checks whether the suffix with the given pruning hash exists in the archive
+         *
+         * @param pruning_hash
+         * @return
+         */
+        [[nodiscard]] bool exists(const crypto_hash_t &pruning_hash) const;
+
+        /**
+         * Blocks until every suffix queued before the call has been written to the archive
+         * and the archive has been synced to disk
+         *
+         * Should any batch of suffixes have failed to be written since the previous call, the error
+         * of the first failed batch is returned along with the pruning hashes of every suffix lost
+         * since the previous call (which are then forgotten, so each failure is reported once).
+         *
+         * @return [error, pruning hashes of the suffixes that are not in the archive]
+         */
+        std::tuple<Error, std::vector<crypto_hash_t>> flush();
+
+        /**
+         * Retrieves the suffix with the given pruning hash
+         *
+         * @param pruning_hash
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, Types::Blockchain::transaction_suffix_t>
+            get_suffix(const crypto_hash_t &pruning_hash) const;
+
+        /**
+         * Retrieves the suffixes with the given pruning hashes using a single read transaction
+         *
+         * The lookups are performed in key order to keep the reads local within the archive.
+         * Pruning hashes that are not found in the archive are omitted from the results.
+         *
+         * @param pruning_hashes
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_suffix_t>>>
+            get_suffixes(const std::vector<crypto_hash_t> &pruning_hashes) const;
+
+        /**
+         * Retrieves up to the specified number of suffixes in pruning hash order beginning with the
+         * first pruning hash at or after the one given, which allows an archival peer to page
+         * through the whole archive by passing the pruning hash after the last one it received
+         *
+         * @param start
+         * @param count
+         * @return
+         */
+        [[nodiscard]] std::tuple<Error, std::vector<std::tuple<crypto_hash_t, Types::Blockchain::transaction_suffix_t>>>
+            get_suffix_range(const crypto_hash_t &start, size_t count) const;
+
+        /**
+         * Returns the number of suffixes waiting to be written
+         *
+         * @return
+         */
+        [[nodiscard]] size_t pending() const;
+
+        /**
+         * Retrieves the write counters of the archive
+         *
+         * @return
+         */
+        [[nodiscard]] stats_t stats() const;
+
+        /**
+         * Stops accepting suffixes and stops the writer thread once every queued suffix is written
+         */
+        void stop();
+
+      private:
+        /**
+         * Writes the suffixes to the archive within a single write transaction
+         *
+         * @param suffixes
+         * @return
+         */
+        Error write(const std::vector<std::tuple<crypto_hash_t, std::vector<uint8_t>>> &suffixes);
+
+        /**
+         * The thread that writes the queued suffixes to the archive
+         */
+        void writer_thread();
+
+        std::shared_ptr<Database::LMDB> m_db_env;
+
+        std::shared_ptr<Database::LMDBDatabase> m_suffixes;
+
+        size_t m_batch_size;
+
+        mutable std::mutex m_mutex;
+
+        std::condition_variable m_queued, m_written;
+
+        std::deque<std::tuple<crypto_hash_t, std::vector<uint8_t>>> m_queue;
+
+        /**
+         * The error of the first batch of suffixes that could not be written since the last flush()
+         */
+        Error m_write_error;
+
+        /**
+         * The pruning hashes of the suffixes that could not be written since the last flush()
+         */
+        std::vector<crypto_hash_t> m_lost;
+
+        size_t m_queued_count, m_written_count;
+
+        std::atomic<bool> m_running;
+
+        std::thread m_thread;
+
+        std::atomic<size_t> m_archived, m_commits, m_failed;
+    };
+} // namespace Core
+
+#endif // CORE_SUFFIX_ARCHIVE_H
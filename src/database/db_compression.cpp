@@ -0,0 +1,473 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include "db_compression.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+#define COMPRESSION_MINIMUM_MATCH 4
+#define COMPRESSION_MAXIMUM_VALUE_SIZE (64 * 1024 * 1024)
+#define COMPRESSION_DICTIONARY_HASH_BITS 16
+#define COMPRESSION_VALUE_HASH_BITS 10
+#define COMPRESSION_MAXIMUM_CHAIN 16
+#define TRAINING_DMER_SIZE 8
+#define TRAINING_SEGMENT_SIZE 64
+#define TRAINING_SEGMENT_STEP 16
+
+namespace Database
+{
+    static inline uint32_t read_uint32(const uint8_t *data)
+    {
+        uint32_t value;
+
+        std::memcpy(&value, data, sizeof(value));
+
+        return value;
+    }
+
+    static inline uint64_t read_uint64(const uint8_t *data)
+    {
+        uint64_t value;
+
+        std::memcpy(&value, data, sizeof(value));
+
+        return value;
+    }
+
+    static inline uint32_t hash_sequence(const uint8_t *data, unsigned int bits)
+    {
+        return (read_uint32(data) * 2654435761u) >> (32 - bits);
+    }
+
+    static inline size_t match_length(const uint8_t *a, const uint8_t *b, size_t limit)
+    {
+        size_t length = 0;
+
+        while (length < limit && a[length] == b[length])
+        {
+            ++length;
+        }
+
+        return length;
+    }
+
+    static inline void write_varint(std::vector<uint8_t> &output, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<uint8_t>(value) | 0x80);
+
+            value >>= 7;
+        }
+
+        output.push_back(static_cast<uint8_t>(value));
+    }
+
+    static inline bool read_varint(const uint8_t *&data, const uint8_t *end, uint64_t &value)
+    {
+        value = 0;
+
+        for (unsigned int shift = 0; data < end && shift < 64; shift += 7)
+        {
+            const auto byte = *data++;
+
+            value |= uint64_t(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    CompressionDictionary::CompressionDictionary(uint64_t id, std::vector<uint8_t> data):
+        m_id(id),
+        m_data(std::move(data)),
+        m_heads(size_t(1) << COMPRESSION_DICTIONARY_HASH_BITS, -1),
+        m_chain(m_data.size(), -1)
+    {
+        // later positions are visited first as they are the cheapest to reference
+        for (size_t i = 0; i + COMPRESSION_MINIMUM_MATCH <= m_data.size(); ++i)
+        {
+            const auto hash = hash_sequence(m_data.data() + i, COMPRESSION_DICTIONARY_HASH_BITS);
+
+            m_chain[i] = m_heads[hash];
+
+            m_heads[hash] = static_cast<int32_t>(i);
+        }
+    }
+
+    std::vector<uint8_t> CompressionDictionary::compress(const uint8_t *data, size_t size) const
+    {
+        std::vector<uint8_t> output;
+
+        // values larger than a decompressor will accept are always held raw
+        if (size > COMPRESSION_MAXIMUM_VALUE_SIZE)
+        {
+            output.reserve(size + 1);
+
+            output.push_back(VALUE_FORMAT_RAW);
+
+            output.insert(output.end(), data, data + size);
+
+            return output;
+        }
+
+        output.reserve(size + 16);
+
+        output.push_back(VALUE_FORMAT_DICTIONARY);
+
+        write_varint(output, m_id);
+
+        write_varint(output, size);
+
+        std::array<int32_t, size_t(1) << COMPRESSION_VALUE_HASH_BITS> heads;
+
+        heads.fill(-1);
+
+        const auto dictionary_size = m_data.size();
+
+        size_t position = 0, literal_start = 0;
+
+        while (position + COMPRESSION_MINIMUM_MATCH <= size)
+        {
+            const auto current = data + position;
+
+            const auto remaining = size - position;
+
+            size_t best_length = 0, best_distance = 0;
+
+            // matches against the earlier bytes of the value itself
+            {
+                const auto hash = hash_sequence(current, COMPRESSION_VALUE_HASH_BITS);
+
+                const auto candidate = heads[hash];
+
+                heads[hash] = static_cast<int32_t>(position);
+
+                if (candidate >= 0)
+                {
+                    const auto length = match_length(data + candidate, current, remaining);
+
+                    if (length >= COMPRESSION_MINIMUM_MATCH)
+                    {
+                        best_length = length;
+
+                        best_distance = position - candidate;
+                    }
+                }
+            }
+
+            // matches against the dictionary, which sits immediately before the value
+            if (dictionary_size != 0)
+            {
+                auto candidate = m_heads[hash_sequence(current, COMPRESSION_DICTIONARY_HASH_BITS)];
+
+                for (size_t depth = 0; candidate >= 0 && depth < COMPRESSION_MAXIMUM_CHAIN;
+                     ++depth, candidate = m_chain[candidate])
+                {
+                    const auto length = match_length(
+                        m_data.data() + candidate, current, std::min(remaining, dictionary_size - candidate));
+
+                    if (length > best_length)
+                    {
+                        best_length = length;
+
+                        best_distance = dictionary_size - candidate + position;
+                    }
+                }
+            }
+
+            if (best_length < COMPRESSION_MINIMUM_MATCH)
+            {
+                ++position;
+
+                continue;
+            }
+
+            write_varint(output, position - literal_start);
+
+            output.insert(output.end(), data + literal_start, data + position);
+
+            write_varint(output, best_length - COMPRESSION_MINIMUM_MATCH);
+
+            write_varint(output, best_distance);
+
+            position += best_length;
+
+            literal_start = position;
+
+            // there is no point in finishing a value that is already no smaller than it started
+            if (output.size() > size)
+            {
+                break;
+            }
+        }
+
+        write_varint(output, size - literal_start);
+
+        output.insert(output.end(), data + literal_start, data + size);
+
+        if (output.size() > size)
+        {
+            output.clear();
+
+            output.push_back(VALUE_FORMAT_RAW);
+
+            output.insert(output.end(), data, data + size);
+        }
+
+        return output;
+    }
+
+    const std::vector<uint8_t> &CompressionDictionary::data() const
+    {
+        return m_data;
+    }
+
+    bool CompressionDictionary::decompress(
+        const uint8_t *data,
+        size_t size,
+        size_t raw_size,
+        std::vector<uint8_t> &output) const
+    {
+        /**
+         * The uncompressed size comes from the stored header and cannot be trusted, so it is capped
+         * before anything is allocated for it. An overlapping match can legitimately expand a few
+         * bytes into a long run, so the cap is a fixed maximum rather than a multiple of the input.
+         */
+        if (raw_size > COMPRESSION_MAXIMUM_VALUE_SIZE)
+        {
+            return false;
+        }
+
+        output.resize(raw_size);
+
+        const auto end = data + size;
+
+        const auto dictionary_size = m_data.size();
+
+        size_t position = 0;
+
+        while (true)
+        {
+            uint64_t literals = 0;
+
+            if (!read_varint(data, end, literals) || literals > size_t(end - data) || literals > raw_size - position)
+            {
+                return false;
+            }
+
+            if (literals != 0)
+            {
+                std::memcpy(output.data() + position, data, literals);
+            }
+
+            data += literals;
+
+            position += literals;
+
+            if (data == end)
+            {
+                return position == raw_size;
+            }
+
+            uint64_t length = 0, distance = 0;
+
+            if (!read_varint(data, end, length) || !read_varint(data, end, distance))
+            {
+                return false;
+            }
+
+            length += COMPRESSION_MINIMUM_MATCH;
+
+            if (distance == 0 || distance > dictionary_size + position || length > raw_size - position)
+            {
+                return false;
+            }
+
+            // copied a byte at a time as a match may run from the dictionary into the value or overlap itself
+            for (size_t i = 0; i < length; ++i, ++position)
+            {
+                const auto source = dictionary_size + position - distance;
+
+                output[position] = (source < dictionary_size) ? m_data[source] : output[source - dictionary_size];
+            }
+        }
+    }
+
+    uint64_t CompressionDictionary::id() const
+    {
+        return m_id;
+    }
+
+    bool CompressionDictionary::read_header(
+        const uint8_t *&data,
+        const uint8_t *end,
+        value_format_t &format,
+        uint64_t &dictionary_id,
+        uint64_t &raw_size)
+    {
+        if (data >= end)
+        {
+            return false;
+        }
+
+        const auto tag = *data++;
+
+        if (tag == VALUE_FORMAT_RAW)
+        {
+            format = VALUE_FORMAT_RAW;
+
+            return true;
+        }
+
+        if (tag != VALUE_FORMAT_DICTIONARY)
+        {
+            return false;
+        }
+
+        format = VALUE_FORMAT_DICTIONARY;
+
+        return read_varint(data, end, dictionary_id) && read_varint(data, end, raw_size);
+    }
+
+    std::shared_ptr<CompressionDictionary>
+        CompressionDictionary::train(uint64_t id, const std::vector<std::vector<uint8_t>> &samples, size_t size)
+    {
+        // the number of samples in which each sequence of bytes appears
+        std::unordered_map<uint64_t, uint32_t> frequencies;
+
+        for (const auto &sample : samples)
+        {
+            std::unordered_set<uint64_t> seen;
+
+            for (size_t i = 0; i + TRAINING_DMER_SIZE <= sample.size(); ++i)
+            {
+                const auto dmer = read_uint64(sample.data() + i);
+
+                if (seen.insert(dmer).second)
+                {
+                    frequencies[dmer]++;
+                }
+            }
+        }
+
+        // a sequence seen in a single sample cannot help to compress any other value
+        const auto score = [&frequencies, &samples](size_t sample, size_t offset, size_t length)
+        {
+            uint64_t result = 0;
+
+            for (size_t i = offset; i + TRAINING_DMER_SIZE <= offset + length; ++i)
+            {
+                const auto it = frequencies.find(read_uint64(samples[sample].data() + i));
+
+                if (it != frequencies.end() && it->second > 1)
+                {
+                    result += it->second;
+                }
+            }
+
+            return result;
+        };
+
+        struct segment_t
+        {
+            uint64_t score;
+
+            size_t sample, offset, length;
+
+            bool operator<(const segment_t &other) const
+            {
+                return score < other.score;
+            }
+        };
+
+        std::priority_queue<segment_t> candidates;
+
+        for (size_t sample = 0; sample < samples.size(); ++sample)
+        {
+            for (size_t offset = 0; offset < samples[sample].size(); offset += TRAINING_SEGMENT_STEP)
+            {
+                const auto length = std::min(size_t(TRAINING_SEGMENT_SIZE), samples[sample].size() - offset);
+
+                if (length < TRAINING_DMER_SIZE)
+                {
+                    continue;
+                }
+
+                const auto value = score(sample, offset, length);
+
+                if (value != 0)
+                {
+                    candidates.push({value, sample, offset, length});
+                }
+            }
+        }
+
+        std::vector<segment_t> selected;
+
+        size_t total = 0;
+
+        while (total < size && !candidates.empty())
+        {
+            auto candidate = candidates.top();
+
+            candidates.pop();
+
+            // scores only ever fall as segments are selected, so they are refreshed lazily
+            candidate.score = score(candidate.sample, candidate.offset, candidate.length);
+
+            if (candidate.score == 0)
+            {
+                continue;
+            }
+
+            if (!candidates.empty() && candidate.score < candidates.top().score)
+            {
+                candidates.push(candidate);
+
+                continue;
+            }
+
+            // the sequences in the segment are now covered by the dictionary
+            const auto begin = samples[candidate.sample].data() + candidate.offset;
+
+            for (size_t i = 0; i + TRAINING_DMER_SIZE <= candidate.length; ++i)
+            {
+                frequencies.erase(read_uint64(begin + i));
+            }
+
+            total += candidate.length;
+
+            selected.push_back(candidate);
+        }
+
+        std::vector<uint8_t> dictionary;
+
+        dictionary.reserve(total);
+
+        for (auto it = selected.rbegin(); it != selected.rend(); ++it)
+        {
+            const auto begin = samples[it->sample].data() + it->offset;
+
+            dictionary.insert(dictionary.end(), begin, begin + it->length);
+        }
+
+        // the least useful segment (at the front) is trimmed if it overflows the dictionary
+        if (dictionary.size() > size)
+        {
+            dictionary.erase(dictionary.begin(), dictionary.begin() + (dictionary.size() - size));
+        }
+
+        return std::make_shared<CompressionDictionary>(id, std::move(dictionary));
+    }
+} // namespace Database
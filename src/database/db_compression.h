@@ -0,0 +1,133 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#ifndef DATABASE_COMPRESSION_H
+#define DATABASE_COMPRESSION_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Database
+{
+    /**
+     * The tag that prefixes every value stored in a compressed database, which allows values
+     * that did not shrink (and are therefore stored raw) to sit alongside compressed values
+     */
+    enum value_format_t
+    {
+        VALUE_FORMAT_RAW = 0,
+        VALUE_FORMAT_DICTIONARY = 1
+    };
+
+    /**
+     * A dictionary of the byte sequences that commonly occur in the values of a database
+     *
+     * Values are compressed using a simple LZ77 scheme where every match may reach back into the
+     * dictionary as well as into the value itself. As the values stored in the database are small
+     * and share the same structure, nearly all of the savings come from the dictionary.
+     *
+     * A compressed value is stored as [format tag][dictionary id][uncompressed size] followed by a
+     * series of [literal length][literals][match length][match distance] tokens (each number a
+     * varint) where the last token ends after its literals. A raw value is stored as [format tag]
+     * followed by the value itself.
+     */
+    class CompressionDictionary
+    {
+      public:
+        /**
+         * Creates a dictionary from its identifier and contents
+         *
+         * @param id
+         * @param data
+         */
+        CompressionDictionary(uint64_t id, std::vector<uint8_t> data);
+
+        /**
+         * Trains a dictionary of (up to) the specified size from a set of sample values
+         *
+         * The samples are split into segments and the segments holding the byte sequences shared
+         * by the most samples are selected until the dictionary is full, with the most useful
+         * segments placed at the end of the dictionary where they are the cheapest to reference.
+         *
+         * @param id
+         * @param samples
+         * @param size
+         * @return
+         */
+        static std::shared_ptr<CompressionDictionary>
+            train(uint64_t id, const std::vector<std::vector<uint8_t>> &samples, size_t size);
+
+        /**
+         * Compresses the value into its tagged form, which holds the value raw if compressing it
+         * would not have made it any smaller or if it is larger than a decompressor will accept
+         *
+         * @param data
+         * @param size
+         * @return
+         */
+        [[nodiscard]] std::vector<uint8_t> compress(const uint8_t *data, size_t size) const;
+
+        /**
+         * Returns the contents of the dictionary
+         *
+         * @return
+         */
+        [[nodiscard]] const std::vector<uint8_t> &data() const;
+
+        /**
+         * Decompresses the payload of a value (following its header) into the output buffer
+         * provided, which is resized to the uncompressed size of the value
+         *
+         * Values claiming an uncompressed size larger than the maximum that compress() will
+         * encode are rejected without allocating anything.
+         *
+         * @param data
+         * @param size
+         * @param raw_size the size of the value before it was compressed
+         * @param output
+         * @return whether the value was well formed
+         */
+        bool decompress(const uint8_t *data, size_t size, size_t raw_size, std::vector<uint8_t> &output) const;
+
+        /**
+         * Returns the identifier of the dictionary
+         *
+         * @return
+         */
+        [[nodiscard]] uint64_t id() const;
+
+        /**
+         * Reads the header of a tagged value, advancing the data pointer to its payload
+         *
+         * The dictionary id and uncompressed size are only read for compressed values.
+         *
+         * @param data
+         * @param end
+         * @param format
+         * @param dictionary_id
+         * @param raw_size
+         * @return whether the header was well formed
+         */
+        static bool read_header(
+            const uint8_t *&data,
+            const uint8_t *end,
+            value_format_t &format,
+            uint64_t &dictionary_id,
+            uint64_t &raw_size);
+
+      private:
+        uint64_t m_id;
+
+        std::vector<uint8_t> m_data;
+
+        /**
+         * Hash chains over every position of the dictionary, which are built once so that
+         * compressing a value never has to index the dictionary
+         */
+        std::vector<int32_t> m_heads, m_chain;
+    };
+} // namespace Database
+
+#endif // DATABASE_COMPRESSION_H
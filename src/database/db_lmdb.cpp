@@ -4,16 +4,67 @@
 
 #include "db_lmdb.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cppfs/FileHandle.h>
 #include <cppfs/fs.h>
+#include <cstring>
 #include <utility>
 
 #define LMDB_SPACE_MULTIPLIER (1024 * 1024) // to MB
+#define LMDB_READ_TXN_POOL_SHARDS 8
+#define LMDB_READ_TXN_POOL_SHARD_SIZE 4
 
 std::map<std::string, std::shared_ptr<Database::LMDB>> l_environments;
 
+/**
+ * The number of transactions registered (by environment) by the calling thread, which lets a
+ * thread already holding a transaction start another one while a resize waits for it to finish
+ */
+thread_local std::map<const Database::LMDB *, size_t> l_thread_txns;
+
 namespace Database
 {
+    LMDBValueView::LMDBValueView(const MDB_val &value):
+        m_data(static_cast<const uint8_t *>(value.mv_data)), m_size(value.mv_size)
+    {
+    }
+
+    const uint8_t *LMDBValueView::data() const
+    {
+        return m_data;
+    }
+
+    bool LMDBValueView::empty() const
+    {
+        return m_size == 0;
+    }
+
+    deserializer_t LMDBValueView::reader() const
+    {
+        return deserializer_t(to_vector());
+    }
+
+    size_t LMDBValueView::size() const
+    {
+        return m_size;
+    }
+
+    const std::vector<uint8_t> &LMDBValueView::stage() const
+    {
+        thread_local std::vector<uint8_t> buffer;
+
+        // assign() reuses the existing capacity of the buffer so this only allocates when it grows
+        buffer.assign(m_data, m_data + m_size);
+
+        return buffer;
+    }
+
+    std::vector<uint8_t> LMDBValueView::to_vector() const
+    {
+        return std::vector<uint8_t>(m_data, m_data + m_size);
+    }
+
     LMDB::~LMDB()
     {
         close();
@@ -42,10 +93,19 @@ namespace Database
             }
         }
 
-        mdb_env_close(m_env);
+        const auto env = m_env;
 
+        /**
+         * The environment is marked closed before the pool is emptied, so a handle checked in from
+         * here on is dropped instead of pooled. The pooled handles are still transactions as far as
+         * LMDB is concerned and must be aborted before the environment is closed.
+         */
         m_env = nullptr;
 
+        read_txn_pool_clear();
+
+        mdb_env_close(env);
+
         if (l_environments.find(m_id) != l_environments.end())
         {
             l_environments.erase(m_id);
@@ -58,19 +118,25 @@ namespace Database
     {
         std::scoped_lock lock(m_mutex);
 
-        if (open_transactions() != 0)
-        {
-            return MAKE_ERROR_MSG(LMDB_ERROR, "Cannot detect LMDB environment map size while transactions are open");
-        }
-
-        const auto result = mdb_env_set_mapsize(m_env, 0);
-
-        return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        return resize(0);
     }
 
     Error LMDB::expand()
     {
-        const auto [error, pages] = memory_to_pages(m_growth_factor * 1024 * 1024);
+        const auto [usage_error, map_size, used_size] = map_usage();
+
+        if (usage_error)
+        {
+            return usage_error;
+        }
+
+        // grow geometrically so that a growing database needs fewer and fewer expansions
+        const auto increment = std::clamp(
+            size_t(double(map_size) * (m_growth_policy.growth_ratio - 1.0)),
+            m_growth_policy.minimum_increment,
+            std::max(m_growth_policy.minimum_increment, m_growth_policy.maximum_increment));
+
+        const auto [error, pages] = memory_to_pages(increment);
 
         if (error)
         {
@@ -84,11 +150,6 @@ namespace Database
     {
         std::scoped_lock lock(m_mutex);
 
-        if (open_transactions() != 0)
-        {
-            return MAKE_ERROR_MSG(LMDB_ERROR, "Cannot expand LMDB environment map size while transactions are open");
-        }
-
         const auto [info_error, l_info] = info();
 
         if (info_error)
@@ -105,9 +166,18 @@ namespace Database
 
         const auto new_size = (l_stats.ms_psize * pages) + l_info.me_mapsize;
 
-        const auto result = mdb_env_set_mapsize(m_env, new_size);
+        const auto error = resize(new_size);
 
-        return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        if (error)
+        {
+            m_failed_expansions++;
+
+            return error;
+        }
+
+        m_expansions++;
+
+        return error;
     }
 
     Error LMDB::flush(bool force)
@@ -122,6 +192,11 @@ namespace Database
         return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
     }
 
+    void LMDB::forget_database(const std::string &id)
+    {
+        m_databases.erase(id);
+    }
+
     std::shared_ptr<LMDBDatabase> LMDB::get_database(const std::string &id)
     {
         if (m_databases.find(id) != m_databases.end())
@@ -174,10 +249,31 @@ namespace Database
 
         db->m_growth_factor = growth_factor;
 
+        db->m_growth_policy.minimum_increment = growth_factor * LMDB_SPACE_MULTIPLIER;
+
         db->m_env = nullptr;
 
         db->m_open_txns = 0;
 
+        db->m_active_txns = 0;
+
+        db->m_resizing = false;
+
+        db->m_expansions = 0;
+
+        db->m_proactive_expansions = 0;
+
+        db->m_failed_expansions = 0;
+
+        db->m_retried_txns = 0;
+
+        for (size_t i = 0; i < LMDB_READ_TXN_POOL_SHARDS; ++i)
+        {
+            db->m_read_txn_pool.push_back(std::make_unique<read_txn_pool_shard_t>());
+        }
+
+        db->m_read_txn_pool_shard_size = LMDB_READ_TXN_POOL_SHARD_SIZE;
+
         db->m_id = id;
 
         auto file = cppfs::fs::open(path);
@@ -241,6 +337,49 @@ namespace Database
         return m_growth_factor;
     }
 
+    LMDB::growth_policy_t LMDB::growth_policy() const
+    {
+        return m_growth_policy;
+    }
+
+    LMDB::growth_stats_t LMDB::growth_stats() const
+    {
+        growth_stats_t result;
+
+        const auto [error, map_size, used_size] = map_usage();
+
+        result.map_size = map_size;
+
+        result.expansions = m_expansions;
+
+        result.proactive_expansions = m_proactive_expansions;
+
+        result.failed_expansions = m_failed_expansions;
+
+        result.retried_transactions = m_retried_txns;
+
+        return result;
+    }
+
+    bool LMDB::has_database(const std::string &name) const
+    {
+        auto txn = transaction(true);
+
+        MDB_dbi main_dbi;
+
+        // the names of the databases are stored as keys in the unnamed (main) database
+        if (mdb_dbi_open(*txn, nullptr, 0, &main_dbi) != MDB_SUCCESS)
+        {
+            return false;
+        }
+
+        MDB_VAL(name, i_key);
+
+        MDB_val value;
+
+        return mdb_get(*txn, main_dbi, &i_key, &value) == MDB_SUCCESS;
+    }
+
     std::string LMDB::id() const
     {
         return m_id;
@@ -260,6 +399,46 @@ namespace Database
         return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), info};
     }
 
+    Error LMDB::maintain_map_size()
+    {
+        const auto [error, map_size, used_size] = map_usage();
+
+        if (error)
+        {
+            return error;
+        }
+
+        const auto free_size = (map_size > used_size) ? map_size - used_size : 0;
+
+        if (double(free_size) >= double(map_size) * m_growth_policy.free_space_threshold)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        m_proactive_expansions++;
+
+        return expand();
+    }
+
+    std::tuple<Error, size_t, size_t> LMDB::map_usage() const
+    {
+        const auto [info_error, l_info] = info();
+
+        if (info_error)
+        {
+            return {info_error, 0, 0};
+        }
+
+        const auto [stats_error, l_stats] = stats();
+
+        if (stats_error)
+        {
+            return {stats_error, 0, 0};
+        }
+
+        return {MAKE_ERROR(SUCCESS), l_info.me_mapsize, (l_info.me_last_pgno + 1) * l_stats.ms_psize};
+    }
+
     std::tuple<Error, size_t> LMDB::memory_to_pages(size_t memory) const
     {
         const auto [error, l_stats] = stats();
@@ -267,6 +446,47 @@ namespace Database
         return {MAKE_ERROR(SUCCESS), size_t(ceil(double(memory) / double(l_stats.ms_psize)))};
     }
 
+    std::tuple<Error, std::vector<std::string>> LMDB::list_databases() const
+    {
+        auto txn = transaction(true);
+
+        MDB_dbi main_dbi;
+
+        auto result = mdb_dbi_open(*txn, nullptr, 0, &main_dbi);
+
+        if (result != MDB_SUCCESS)
+        {
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}};
+        }
+
+        MDB_cursor *cursor;
+
+        result = mdb_cursor_open(*txn, main_dbi, &cursor);
+
+        if (result != MDB_SUCCESS)
+        {
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}};
+        }
+
+        std::vector<std::string> names;
+
+        MDB_val key, value;
+
+        while ((result = mdb_cursor_get(cursor, &key, &value, names.empty() ? MDB_FIRST : MDB_NEXT)) == MDB_SUCCESS)
+        {
+            names.emplace_back(static_cast<const char *>(key.mv_data), key.mv_size);
+        }
+
+        mdb_cursor_close(cursor);
+
+        if (result != MDB_NOTFOUND)
+        {
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), names};
+    }
+
     std::tuple<Error, size_t> LMDB::max_key_size() const
     {
         if (!m_env)
@@ -293,7 +513,7 @@ namespace Database
         return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), readers};
     }
 
-    std::shared_ptr<LMDBDatabase> LMDB::open_database(const std::string &name, int flags)
+    std::shared_ptr<LMDBDatabase> LMDB::open_database(const std::string &name, int flags, key_encoding_t key_encoding)
     {
         auto id = Crypto::Hashing::sha3(name.data(), name.size()).to_string();
 
@@ -304,13 +524,21 @@ namespace Database
 
         auto env = LMDB::get_instance(m_id);
 
-        auto db = std::make_shared<LMDBDatabase>(env, name, flags);
+        auto db = std::make_shared<LMDBDatabase>(env, name, flags, key_encoding);
 
         m_databases.insert({id, db});
 
         return db;
     }
 
+    std::shared_ptr<LMDBDatabase> LMDB::open_sequential_database(const std::string &name, int flags)
+    {
+        // MDB_INTEGERKEY requires that keys are the size of an unsigned int or size_t
+        static_assert(sizeof(size_t) == sizeof(uint64_t), "Sequential databases require 64-bit size_t");
+
+        return open_database(name, flags | MDB_INTEGERKEY, KEY_ENCODING_INTEGER);
+    }
+
     size_t LMDB::open_transactions() const
     {
         std::scoped_lock lock(m_txn_mutex);
@@ -318,6 +546,61 @@ namespace Database
         return m_open_txns;
     }
 
+    Error LMDB::reserve(size_t bytes)
+    {
+        const auto [usage_error, map_size, used_size] = map_usage();
+
+        if (usage_error)
+        {
+            return usage_error;
+        }
+
+        if (map_size >= used_size + bytes)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        const auto [error, pages] = memory_to_pages(used_size + bytes - map_size);
+
+        if (error)
+        {
+            return error;
+        }
+
+        return expand(pages);
+    }
+
+    Error LMDB::resize(size_t map_size) const
+    {
+        int result = MDB_SUCCESS;
+
+        {
+            std::unique_lock lock(m_txn_mutex);
+
+            // the transactions of the calling thread would never finish while it waits for them
+            const auto held = l_thread_txns.find(this);
+
+            if (held != l_thread_txns.end() && held->second != 0)
+            {
+                return MAKE_ERROR_MSG(
+                    LMDB_ERROR, "Cannot resize the LMDB memory map while the calling thread holds a transaction");
+            }
+
+            // close the gate so that no new transactions start while we wait for the open ones to finish
+            m_resizing = true;
+
+            m_txn_cv.wait(lock, [this] { return m_active_txns == 0; });
+
+            result = mdb_env_set_mapsize(m_env, map_size);
+
+            m_resizing = false;
+        }
+
+        m_txn_cv.notify_all();
+
+        return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+    }
+
     Error LMDB::set_flags(int flags, bool flag_state)
     {
         std::scoped_lock lock(m_mutex);
@@ -327,6 +610,11 @@ namespace Database
         return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
     }
 
+    void LMDB::set_growth_policy(const growth_policy_t &policy)
+    {
+        m_growth_policy = policy;
+    }
+
     std::tuple<Error, MDB_stat> LMDB::stats() const
     {
         MDB_stat stats;
@@ -348,31 +636,138 @@ namespace Database
         return std::make_unique<LMDBTransaction>(instance, readonly);
     }
 
-    void LMDB::transaction_register(const LMDBTransaction &txn)
+    void LMDB::read_txn_pool_clear()
     {
-        if (txn.readonly())
+        for (auto &shard : m_read_txn_pool)
         {
-            return;
+            std::scoped_lock lock(shard->mutex);
+
+            for (auto &txn : shard->txns)
+            {
+                mdb_txn_abort(*txn);
+            }
+
+            shard->txns.clear();
         }
+    }
 
-        std::scoped_lock lock(m_txn_mutex);
+    LMDB::read_txn_pool_shard_t &LMDB::read_txn_pool_shard()
+    {
+        const auto index = std::hash<std::thread::id>()(std::this_thread::get_id()) % m_read_txn_pool.size();
 
-        m_open_txns++;
+        return *m_read_txn_pool[index];
     }
 
-    void LMDB::transaction_unregister(const LMDBTransaction &txn)
+    void LMDB::set_read_transaction_pool_size(size_t shard_size)
     {
-        if (txn.readonly())
+        m_read_txn_pool_shard_size = shard_size;
+
+        if (shard_size == 0)
         {
-            return;
+            read_txn_pool_clear();
         }
+    }
 
-        std::scoped_lock lock(m_txn_mutex);
+    std::shared_ptr<MDB_txn *> LMDB::transaction_checkout()
+    {
+        auto &shard = read_txn_pool_shard();
+
+        std::scoped_lock lock(shard.mutex);
 
-        if (m_open_txns > 0)
+        if (shard.txns.empty())
         {
-            m_open_txns--;
+            return nullptr;
         }
+
+        auto txn = std::move(shard.txns.back());
+
+        shard.txns.pop_back();
+
+        return txn;
+    }
+
+    void LMDB::transaction_checkin(std::shared_ptr<MDB_txn *> &txn)
+    {
+        {
+            auto &shard = read_txn_pool_shard();
+
+            std::scoped_lock lock(shard.mutex);
+
+            // the handles of a closed environment were freed along with it, so there is nothing to abort
+            if (!m_env)
+            {
+                txn = nullptr;
+
+                return;
+            }
+
+            if (shard.txns.size() < m_read_txn_pool_shard_size)
+            {
+                shard.txns.push_back(std::move(txn));
+
+                return;
+            }
+        }
+
+        mdb_txn_abort(*txn);
+
+        txn = nullptr;
+    }
+
+    void LMDB::transaction_register(const LMDBTransaction &txn)
+    {
+        std::unique_lock lock(m_txn_mutex);
+
+        auto &held = l_thread_txns[this];
+
+        /**
+         * New transactions are held back while the memory map is being resized, except on threads
+         * that already hold one as the resize is waiting for those threads to finish
+         */
+        if (held == 0)
+        {
+            m_txn_cv.wait(lock, [this] { return !m_resizing; });
+        }
+
+        held++;
+
+        m_active_txns++;
+
+        if (!txn.readonly())
+        {
+            m_open_txns++;
+        }
+    }
+
+    void LMDB::transaction_retried()
+    {
+        m_retried_txns++;
+    }
+
+    void LMDB::transaction_unregister(const LMDBTransaction &txn)
+    {
+        {
+            std::scoped_lock lock(m_txn_mutex);
+
+            auto &held = l_thread_txns[this];
+
+            if (held > 0)
+            {
+                held--;
+            }
+
+            if (m_active_txns > 0)
+            {
+                m_active_txns--;
+            }
+
+            if (!txn.readonly() && m_open_txns > 0)
+            {
+                m_open_txns--;
+            }
+        }
+
+        m_txn_cv.notify_all();
     }
 
     std::tuple<int, int, int> LMDB::version()
@@ -384,7 +779,16 @@ namespace Database
         return {major, minor, patch};
     }
 
-    LMDBDatabase::LMDBDatabase(std::shared_ptr<LMDB> &env, const std::string &name, int flags): m_env(env), m_dbi(0)
+    LMDBDatabase::LMDBDatabase(
+        std::shared_ptr<LMDB> &env,
+        const std::string &name,
+        int flags,
+        key_encoding_t key_encoding):
+        m_env(env),
+        m_dbi(0),
+        m_dbi_open(false),
+        m_key_encoding((flags & MDB_INTEGERKEY) ? KEY_ENCODING_INTEGER : key_encoding),
+        m_compressed(false)
     {
         m_id = Crypto::Hashing::sha3(name.data(), name.size()).to_string();
 
@@ -401,6 +805,8 @@ namespace Database
             throw std::runtime_error("Unable to open LMDB named database: " + MDB_STR_ERR(success));
         }
 
+        m_dbi_open = true;
+
         if (!(env_flags & MDB_RDONLY))
         {
             if (txn->commit() != SUCCESS)
@@ -412,7 +818,11 @@ namespace Database
 
     LMDBDatabase::~LMDBDatabase()
     {
-        mdb_dbi_close(*m_env, m_dbi);
+        // a deleted database's handle was closed by mdb_drop() and its slot may belong to another database
+        if (m_dbi_open)
+        {
+            mdb_dbi_close(*m_env, m_dbi);
+        }
     }
 
     LMDBDatabase::operator MDB_dbi &()
@@ -420,26 +830,80 @@ namespace Database
         return m_dbi;
     }
 
-    size_t LMDBDatabase::count()
+    bool LMDBDatabase::compressed() const
     {
-        auto db = m_env->get_database(m_id);
+        return m_compressed;
+    }
 
-        auto txn = std::make_unique<LMDBTransaction>(m_env, db, true);
+    std::vector<uint8_t> LMDBDatabase::compress_value(const MDB_val &value) const
+    {
+        const auto compression = std::atomic_load(&m_compression);
 
-        auto cursor = txn->cursor();
+        return compression->dictionary->compress(static_cast<const uint8_t *>(value.mv_data), value.mv_size);
+    }
 
-        MDB_val key, value;
+    size_t LMDBDatabase::count()
+    {
+        auto txn = transaction(true);
 
-        size_t count = 0;
+        const auto [error, count] = txn->count();
 
-        while (mdb_cursor_get(*cursor, &key, &value, count ? MDB_NEXT : MDB_FIRST) == MDB_SUCCESS)
+        if (error)
         {
-            count++;
+            return 0;
         }
 
         return count;
     }
 
+    Error LMDBDatabase::decompress_value(MDB_val &value) const
+    {
+        if (!m_compressed)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        auto data = static_cast<const uint8_t *>(value.mv_data);
+
+        const auto end = data + value.mv_size;
+
+        value_format_t format;
+
+        uint64_t dictionary_id = 0, raw_size = 0;
+
+        if (!CompressionDictionary::read_header(data, end, format, dictionary_id, raw_size))
+        {
+            return MAKE_ERROR_MSG(DB_DESERIALIZATION_ERROR, "Stored value has an invalid format tag.");
+        }
+
+        if (format == VALUE_FORMAT_RAW)
+        {
+            value = {size_t(end - data), (void *)data};
+
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        const auto compression = std::atomic_load(&m_compression);
+
+        const auto it = compression->dictionaries.find(dictionary_id);
+
+        if (it == compression->dictionaries.end())
+        {
+            return MAKE_ERROR_MSG(DB_DESERIALIZATION_ERROR, "Stored value was compressed with an unknown dictionary.");
+        }
+
+        thread_local std::vector<uint8_t> l_buffer;
+
+        if (!it->second->decompress(data, size_t(end - data), raw_size, l_buffer))
+        {
+            return MAKE_ERROR_MSG(DB_DESERIALIZATION_ERROR, "Stored value could not be decompressed.");
+        }
+
+        value = {l_buffer.size(), l_buffer.data()};
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
     Error LMDBDatabase::drop(bool delete_db)
     {
         std::scoped_lock lock(m_db_mutex);
@@ -459,7 +923,22 @@ namespace Database
             goto try_again;
         }
 
-        return txn->commit();
+        if (result != MDB_SUCCESS)
+        {
+            return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        }
+
+        const auto error = txn->commit();
+
+        if (!error && delete_db)
+        {
+            // mdb_drop() closed the handle, so it must not be used again nor handed out by open_database()
+            m_dbi_open = false;
+
+            m_env->forget_database(m_id);
+        }
+
+        return error;
     }
 
     std::shared_ptr<LMDB> LMDBDatabase::env() const
@@ -483,6 +962,50 @@ namespace Database
         return m_id;
     }
 
+    key_encoding_t LMDBDatabase::key_encoding() const
+    {
+        return m_key_encoding;
+    }
+
+    Error LMDBDatabase::set_compression(const std::shared_ptr<const CompressionDictionary> &dictionary)
+    {
+        if (!dictionary)
+        {
+            return MAKE_ERROR_MSG(LMDB_INVALID, "A compression dictionary must be supplied.");
+        }
+
+        const auto [error, flags] = get_flags();
+
+        if (error)
+        {
+            return error;
+        }
+
+        if (flags & MDB_DUPSORT)
+        {
+            return MAKE_ERROR_MSG(LMDB_INVALID, "Databases that allow duplicates cannot be compressed.");
+        }
+
+        std::scoped_lock lock(m_db_mutex);
+
+        auto compression = std::make_shared<compression_t>();
+
+        if (const auto current = std::atomic_load(&m_compression))
+        {
+            compression->dictionaries = current->dictionaries;
+        }
+
+        compression->dictionary = dictionary;
+
+        compression->dictionaries[dictionary->id()] = dictionary;
+
+        std::atomic_store(&m_compression, std::shared_ptr<const compression_t>(compression));
+
+        m_compressed = true;
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
     std::unique_ptr<LMDBTransaction> LMDBDatabase::transaction(bool readonly)
     {
         if (m_dbi == 0)
@@ -526,6 +1049,20 @@ namespace Database
             return;
         }
 
+        // read-only handles are reset and handed back to the environment for reuse
+        if (m_readonly)
+        {
+            reset();
+
+            m_env->transaction_checkin(m_txn);
+
+            m_txn = nullptr;
+
+            m_reset = false;
+
+            return;
+        }
+
         mdb_txn_abort(*m_txn);
 
         m_env->transaction_unregister(*this);
@@ -540,6 +1077,14 @@ namespace Database
             return MAKE_ERROR_MSG(LMDB_ERROR, MDB_STR_ERR(MDB_BAD_TXN));
         }
 
+        // there is nothing to commit for a read-only transaction, so its handle is pooled instead
+        if (m_readonly)
+        {
+            abort();
+
+            return MAKE_ERROR(SUCCESS);
+        }
+
         const auto result = mdb_txn_commit(*m_txn);
 
         m_env->transaction_unregister(*this);
@@ -549,6 +1094,25 @@ namespace Database
         return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
     }
 
+    std::tuple<Error, size_t> LMDBTransaction::count()
+    {
+        if (!m_txn || !m_db)
+        {
+            return {MAKE_ERROR_MSG(LMDB_BAD_TXN, "Transaction or database does not exist"), 0};
+        }
+
+        MDB_stat stats;
+
+        const auto result = mdb_stat(*m_txn, *m_db, &stats);
+
+        if (result != MDB_SUCCESS)
+        {
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), 0};
+        }
+
+        return {MAKE_ERROR(SUCCESS), stats.ms_entries};
+    }
+
     std::unique_ptr<LMDBCursor> LMDBTransaction::cursor()
     {
         return std::make_unique<LMDBCursor>(m_txn, m_db, m_readonly);
@@ -561,7 +1125,7 @@ namespace Database
 
     bool LMDBTransaction::exists(const uint64_t &key)
     {
-        MDB_VAL_NUM(key, i_key);
+        MDB_VAL_KEY(key, m_db, i_key);
 
         MDB_val value;
 
@@ -570,6 +1134,29 @@ namespace Database
         return result == MDB_SUCCESS;
     }
 
+    std::tuple<Error, LMDBValueView> LMDBTransaction::get_view(const uint64_t &key)
+    {
+        MDB_VAL_KEY(key, m_db, i_key);
+
+        MDB_val value;
+
+        const auto result = mdb_get(*m_txn, *m_db, &i_key, &value);
+
+        if (result != MDB_SUCCESS)
+        {
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}};
+        }
+
+        const auto decode_error = m_db->decompress_value(value);
+
+        if (decode_error)
+        {
+            return {decode_error, {}};
+        }
+
+        return {MAKE_ERROR(SUCCESS), LMDBValueView(value)};
+    }
+
     std::tuple<Error, size_t> LMDBTransaction::id() const
     {
         if (!m_txn)
@@ -591,37 +1178,92 @@ namespace Database
     {
         if (!m_txn || !m_readonly)
         {
-            return MAKE_ERROR_MSG(LMDB_BAD_TXN, "Transaction does not exist");
+            return MAKE_ERROR_MSG(LMDB_BAD_TXN, "Transaction does not exist or is not readonly");
         }
 
+        if (!m_reset)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
+
+        // registering first waits out any resize of the memory map that is in progress
+        m_env->transaction_register(*this);
+
         const auto result = mdb_txn_renew(*m_txn);
 
-        return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        if (result != MDB_SUCCESS)
+        {
+            m_env->transaction_unregister(*this);
+
+            return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        }
+
+        m_reset = false;
+
+        return MAKE_ERROR(SUCCESS);
     }
 
     Error LMDBTransaction::reset()
     {
         if (!m_txn || !m_readonly)
         {
-            return MAKE_ERROR_MSG(LMDB_BAD_TXN, "Transaction does not exist or is readonly");
+            return MAKE_ERROR_MSG(LMDB_BAD_TXN, "Transaction does not exist or is not readonly");
         }
 
-        const auto result = mdb_txn_renew(*m_txn);
+        if (m_reset)
+        {
+            return MAKE_ERROR(SUCCESS);
+        }
 
-        return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        mdb_txn_reset(*m_txn);
+
+        m_reset = true;
+
+        // a reset transaction no longer references the memory map so it must not hold back a resize
+        m_env->transaction_unregister(*this);
+
+        return MAKE_ERROR(SUCCESS);
     }
 
-    void LMDBTransaction::set_database(std::shared_ptr<LMDBDatabase> &db)
+    void LMDBTransaction::set_database(const std::shared_ptr<LMDBDatabase> &db)
     {
         m_db = db;
     }
 
     void LMDBTransaction::txn_setup()
     {
+        /**
+         * Renewing a pooled handle reuses its reader slot, which skips the reader table lock
+         * and the allocations that mdb_txn_begin() performs for every new read transaction
+         */
+        if (m_readonly)
+        {
+            m_txn = m_env->transaction_checkout();
+
+            if (m_txn)
+            {
+                m_reset = true;
+
+                if (!renew())
+                {
+                    return;
+                }
+
+                mdb_txn_abort(*m_txn);
+
+                m_txn = nullptr;
+
+                m_reset = false;
+            }
+        }
+
         MDB_txn *result;
 
         for (int i = 0; i < 3; ++i)
         {
+            // registering first waits out any resize of the memory map that is in progress
+            m_env->transaction_register(*this);
+
             const auto mdb_result = mdb_txn_begin(*m_env, nullptr, (m_readonly) ? MDB_RDONLY : 0, &result);
 
             if (mdb_result == MDB_SUCCESS)
@@ -629,6 +1271,8 @@ namespace Database
                 break;
             }
 
+            m_env->transaction_unregister(*this);
+
             if (mdb_result == MDB_MAP_RESIZED && i < 2)
             {
                 m_env->detect_map_size();
@@ -640,8 +1284,6 @@ namespace Database
         }
 
         m_txn = std::make_shared<MDB_txn *>(result);
-
-        m_env->transaction_register(*this);
     }
 
     LMDBCursor::LMDBCursor(std::shared_ptr<MDB_txn *> &txn, std::shared_ptr<LMDBDatabase> &db, bool readonly):
@@ -698,7 +1340,72 @@ namespace Database
         return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
     }
 
+    Error LMDBCursor::for_each(
+        const uint64_t &first,
+        const uint64_t &last,
+        const std::function<bool(const uint64_t &, const LMDBValueView &)> &visitor)
+    {
+        if (m_db->key_encoding() == KEY_ENCODING_NATIVE)
+        {
+            return MAKE_ERROR_MSG(LMDB_INCOMPATIBLE, "Range scans require big-endian or integer keys");
+        }
+
+        Error error;
+
+        uint64_t key;
+
+        LMDBValueView value;
+
+        for (std::tie(error, key, value) = get_view(first, MDB_SET_RANGE); !error && key <= last;)
+        {
+            if (!visitor(key, value))
+            {
+                break;
+            }
+
+            LMDBValueView next_key;
+
+            std::tie(error, next_key, value) = get_view(MDB_NEXT);
+
+            if (!error)
+            {
+                key = decode_key(next_key.data(), next_key.size(), m_db->key_encoding());
+            }
+        }
+
+        if (error && error != LMDB_NOTFOUND)
+        {
+            return error;
+        }
+
+        return MAKE_ERROR(SUCCESS);
+    }
+
     std::tuple<Error, std::vector<uint8_t>, std::vector<uint8_t>> LMDBCursor::get(const MDB_cursor_op &op)
+    {
+        const auto [error, r_key, r_value] = get_view(op);
+
+        if (error)
+        {
+            return {error, {}, {}};
+        }
+
+        return {error, r_key.to_vector(), r_value.to_vector()};
+    }
+
+    std::tuple<Error, uint64_t, std::vector<uint8_t>> LMDBCursor::get(const uint64_t &key, const MDB_cursor_op &op)
+    {
+        const auto [error, key_value, r_value] = get_view(key, op);
+
+        if (error)
+        {
+            return {error, 0, {}};
+        }
+
+        return {error, key_value, r_value.to_vector()};
+    }
+
+    std::tuple<Error, LMDBValueView, LMDBValueView> LMDBCursor::get_view(const MDB_cursor_op &op)
     {
         if (m_cursor == nullptr)
         {
@@ -709,19 +1416,22 @@ namespace Database
 
         const auto result = mdb_cursor_get(m_cursor, &i_key, &i_value, op);
 
-        std::vector<uint8_t> r_key, r_value;
-
-        if (result == MDB_SUCCESS)
+        if (result != MDB_SUCCESS)
         {
-            r_key = FROM_MDB_VAL(i_key);
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}, {}};
+        }
 
-            r_value = FROM_MDB_VAL(i_value);
+        const auto decode_error = m_db->decompress_value(i_value);
+
+        if (decode_error)
+        {
+            return {decode_error, {}, {}};
         }
 
-        return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), r_key, r_value};
+        return {MAKE_ERROR(SUCCESS), LMDBValueView(i_key), LMDBValueView(i_value)};
     }
 
-    std::tuple<Error, uint64_t, std::vector<uint8_t>> LMDBCursor::get(const uint64_t &key, const MDB_cursor_op &op)
+    std::tuple<Error, uint64_t, LMDBValueView> LMDBCursor::get_view(const uint64_t &key, const MDB_cursor_op &op)
     {
         if (m_cursor == nullptr)
         {
@@ -730,24 +1440,41 @@ namespace Database
 
         MDB_val i_value;
 
-        MDB_VAL_NUM(key, i_key);
+        MDB_VAL_KEY(key, m_db, i_key);
 
         const auto result = mdb_cursor_get(m_cursor, &i_key, &i_value, op);
 
-        std::vector<uint8_t> r_key, r_value;
+        if (result != MDB_SUCCESS)
+        {
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), 0, {}};
+        }
 
-        uint64_t key_value = 0;
+        const auto decode_error = m_db->decompress_value(i_value);
 
-        if (result == MDB_SUCCESS)
+        if (decode_error)
         {
-            r_key = FROM_MDB_VAL(i_key);
+            return {decode_error, 0, {}};
+        }
 
-            r_value = FROM_MDB_VAL(i_value);
+        const auto key_value = decode_key(i_key.mv_data, i_key.mv_size, m_db->key_encoding());
 
-            std::memcpy(&key_value, r_key.data(), sizeof(key_value));
+        return {MAKE_ERROR(SUCCESS), key_value, LMDBValueView(i_value)};
+    }
+
+    Error LMDBCursor::put_stored(const std::vector<uint8_t> &key, const std::vector<uint8_t> &value, int flags)
+    {
+        if (m_cursor == nullptr)
+        {
+            return MAKE_ERROR_MSG(LMDB_ERROR, "Cursor does not exist");
         }
 
-        return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), key_value, r_value};
+        MDB_VAL(key, i_key);
+
+        MDB_VAL(value, i_value);
+
+        const auto result = mdb_cursor_put(m_cursor, &i_key, &i_value, flags);
+
+        return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
     }
 
     Error LMDBCursor::renew()
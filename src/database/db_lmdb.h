@@ -5,17 +5,38 @@
 #ifndef DATABASE_LMDB_H
 #define DATABASE_LMDB_H
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <crypto.h>
+#include <cstring>
+#include <db_compression.h>
 #include <errors.h>
+#include <functional>
+#include <iterator>
 #include <lmdb.h>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 
 #define MDB_STR_ERR(variable) std::string(mdb_strerror(variable))
 #define MDB_VAL(input, output) MDB_val output = {(input).size(), (void *)(input).data()}
 #define MDB_VAL_NUM(input, output) MDB_val output = {sizeof(input), (void *)&(input)}
+#define MDB_VAL_KEY(input, db, output)                                                  \
+    const uint64_t output##_encoded = Database::encode_key(input, (db)->key_encoding()); \
+    MDB_val output = {sizeof(output##_encoded), (void *)&output##_encoded}
+#define MDB_VAL_VALUE(input, db, output)                             \
+    MDB_VAL(input, output);                                          \
+    std::vector<uint8_t> output##_encoded;                           \
+    if ((db)->compressed())                                          \
+    {                                                                \
+        output##_encoded = (db)->compress_value(output);             \
+        output = {output##_encoded.size(), output##_encoded.data()}; \
+    }
 #define FROM_MDB_VAL(value)                                  \
     std::vector<uint8_t>(                                    \
         static_cast<const unsigned char *>((value).mv_data), \
@@ -29,6 +50,8 @@
                                                           \
         if (!exp_error)                                   \
         {                                                 \
+            env->transaction_retried();                   \
+                                                          \
             goto label;                                   \
         }                                                 \
     }
@@ -39,6 +62,177 @@ namespace Database
     class LMDBDatabase;
     class LMDBTransaction;
     class LMDBCursor;
+    template<typename KeyType, typename ValueType> class LMDBRange;
+
+    /**
+     * How the unsigned 64-bit keys of a database are laid out in bytes
+     *
+     * LMDB compares keys byte-wise unless told otherwise, so native (little-endian) keys do not
+     * sort in numeric order and must not be used for range scans. Big-endian keys sort in numeric
+     * order under the default comparison, which keeps MDB_DUPSORT (with its own fixed size value
+     * comparison) available, while integer keys are compared numerically by LMDB itself.
+     */
+    enum key_encoding_t
+    {
+        KEY_ENCODING_NATIVE,
+        KEY_ENCODING_BIG_ENDIAN,
+        KEY_ENCODING_INTEGER
+    };
+
+    /**
+     * Encodes the key in the specified encoding
+     *
+     * @param key
+     * @param encoding
+     * @return the encoded bytes held in a uint64_t
+     */
+    inline uint64_t encode_key(const uint64_t &key, key_encoding_t encoding)
+    {
+        if (encoding != KEY_ENCODING_BIG_ENDIAN)
+        {
+            return key;
+        }
+
+        uint64_t result;
+
+        auto bytes = reinterpret_cast<uint8_t *>(&result);
+
+        for (size_t i = 0; i < sizeof(key); ++i)
+        {
+            bytes[i] = uint8_t(key >> (8 * (sizeof(key) - 1 - i)));
+        }
+
+        return result;
+    }
+
+    /**
+     * Encodes the key in the specified encoding as bytes (ie. to store an ordered integer as
+     * the value of a MDB_DUPSORT database)
+     *
+     * @param key
+     * @param encoding
+     * @return
+     */
+    inline std::vector<uint8_t> encode_key_bytes(const uint64_t &key, key_encoding_t encoding)
+    {
+        const auto encoded = encode_key(key, encoding);
+
+        const auto bytes = reinterpret_cast<const uint8_t *>(&encoded);
+
+        return std::vector<uint8_t>(bytes, bytes + sizeof(encoded));
+    }
+
+    /**
+     * Decodes a key stored in the specified encoding
+     *
+     * @param data
+     * @param size
+     * @param encoding
+     * @return
+     */
+    inline uint64_t decode_key(const void *data, size_t size, key_encoding_t encoding)
+    {
+        uint64_t result = 0;
+
+        size = std::min(size, sizeof(result));
+
+        if (encoding == KEY_ENCODING_BIG_ENDIAN)
+        {
+            const auto bytes = static_cast<const uint8_t *>(data);
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                result = (result << 8) | bytes[i];
+            }
+
+            return result;
+        }
+
+        std::memcpy(&result, data, size);
+
+        return result;
+    }
+
+    /**
+     * A read-only view of a key or value that lives inside of the LMDB memory map
+     *
+     * The view does not own the memory it points to. It is only valid until the transaction
+     * that produced it is committed, aborted, or reset, or until that transaction writes to
+     * the database the view was read from.
+     *
+     * A value read from a compressed database is decompressed into a scratch buffer owned by
+     * the calling thread rather than the memory map. Such a view is also invalidated by the next
+     * compressed value read on the same thread (including a nested read made while the view is
+     * still in use), so copy it out with to_vector() before reading another compressed value.
+     */
+    class LMDBValueView
+    {
+      public:
+        LMDBValueView() = default;
+
+        LMDBValueView(const MDB_val &value);
+
+        /**
+         * Returns a pointer to the first byte of the value
+         *
+         * @return
+         */
+        [[nodiscard]] const uint8_t *data() const;
+
+        /**
+         * Decodes the value as the specified type
+         *
+         * The bytes are staged in a per-thread scratch buffer that is reused between calls so
+         * that reading a value does not allocate an intermediate vector
+         *
+         * @tparam ValueType
+         * @return
+         */
+        template<typename ValueType> ValueType decode() const
+        {
+            return ValueType(stage());
+        }
+
+        /**
+         * Returns whether the value is empty
+         *
+         * @return
+         */
+        [[nodiscard]] bool empty() const;
+
+        /**
+         * Returns a deserializer loaded with the value
+         *
+         * @return
+         */
+        [[nodiscard]] deserializer_t reader() const;
+
+        /**
+         * Returns the size of the value in bytes
+         *
+         * @return
+         */
+        [[nodiscard]] size_t size() const;
+
+        /**
+         * Returns an owned copy of the value
+         *
+         * @return
+         */
+        [[nodiscard]] std::vector<uint8_t> to_vector() const;
+
+      private:
+        /**
+         * Copies the value into the per-thread scratch buffer and returns it
+         *
+         * @return
+         */
+        const std::vector<uint8_t> &stage() const;
+
+        const uint8_t *m_data = nullptr;
+
+        size_t m_size = 0;
+    };
 
     /**
      * Wraps the LMDB C API into an OOP model that allows for opening and using
@@ -47,6 +241,46 @@ namespace Database
     class LMDB
     {
       public:
+        /**
+         * Controls how the memory map of the environment grows
+         */
+        struct growth_policy_t
+        {
+            /**
+             * The minimum number of bytes added to the memory map by a single expansion
+             */
+            size_t minimum_increment = 8 * 1024 * 1024;
+
+            /**
+             * The maximum number of bytes added to the memory map by a single expansion
+             */
+            size_t maximum_increment = size_t(1024) * 1024 * 1024;
+
+            /**
+             * The factor by which each expansion multiplies the size of the memory map
+             */
+            double growth_ratio = 1.5;
+
+            /**
+             * The fraction of the memory map that should remain unused; once less than this
+             * remains, maintain_map_size() expands the memory map ahead of time
+             */
+            double free_space_threshold = 0.1;
+        };
+
+        struct growth_stats_t
+        {
+            size_t map_size = 0;
+
+            size_t expansions = 0;
+
+            size_t proactive_expansions = 0;
+
+            size_t failed_expansions = 0;
+
+            size_t retried_transactions = 0;
+        };
+
         ~LMDB();
 
         operator MDB_env *&();
@@ -58,22 +292,25 @@ namespace Database
 
         /**
          * Detects the current memory map size if it has been changed elsewhere
-         * This requires that there are no open R/W transactions; otherwise, the method
-         * will throw an exception.
+         *
+         * New transactions are held back while the transactions that are already open are
+         * given the drain timeout of the growth policy to finish; otherwise, an error is returned.
          */
         Error detect_map_size() const;
 
         /**
-         * Expands the memory map by the growth factor supplied to the constructor
-         * This requires that there are no open R/W transactions; otherwise, the method
-         * will throw an exception.
+         * Expands the memory map geometrically as set by the growth policy
+         *
+         * New transactions are held back while the transactions that are already open are
+         * given the drain timeout of the growth policy to finish; otherwise, an error is returned.
          */
         Error expand();
 
         /**
          * Expands the memory map by the number of pages specified.
-         * This requires that there are no open R/W transactions; otherwise, the method
-         * will throw an exception.
+         *
+         * New transactions are held back while the transactions that are already open are
+         * given the drain timeout of the growth policy to finish; otherwise, an error is returned.
          *
          * @param pages
          */
@@ -91,6 +328,16 @@ namespace Database
          */
         Error flush(bool force = false);
 
+        /**
+         * Un-registers a database that has been deleted from the environment so that opening a
+         * database with the same name opens a new handle rather than the closed one
+         *
+         * DO NOT USE THIS METHOD DIRECTLY!
+         *
+         * @param id
+         */
+        void forget_database(const std::string &id);
+
         /**
          * Retrieves an already open database by its ID
          *
@@ -138,6 +385,29 @@ namespace Database
          */
         size_t growth_factor() const;
 
+        /**
+         * Retrieves the growth policy of the memory map
+         *
+         * @return
+         */
+        growth_policy_t growth_policy() const;
+
+        /**
+         * Retrieves the memory map growth counters of the environment
+         *
+         * @return
+         */
+        growth_stats_t growth_stats() const;
+
+        /**
+         * Checks whether a database with the specified name exists in the environment
+         * without creating it
+         *
+         * @param name
+         * @return
+         */
+        bool has_database(const std::string &name) const;
+
         /**
          * Retrieves the environments ID
          *
@@ -152,6 +422,14 @@ namespace Database
          */
         std::tuple<Error, MDB_envinfo> info() const;
 
+        /**
+         * Retrieves the names of the named databases that exist in the environment, including
+         * those that have not been opened by this process
+         *
+         * @return
+         */
+        std::tuple<Error, std::vector<std::string>> list_databases() const;
+
         /**
          * Retrieves the maximum byte size of a key in the LMDB environment
          *
@@ -172,9 +450,35 @@ namespace Database
          *
          * @param name
          * @param flags
+         * @param key_encoding how unsigned 64-bit keys are stored in the database
+         * @return
+         */
+        std::shared_ptr<LMDBDatabase>
+            open_database(const std::string &name, int flags = 0, key_encoding_t key_encoding = KEY_ENCODING_NATIVE);
+
+        /**
+         * Opens a database whose keys are sequential 64-bit unsigned integers
+         *
+         * The database is opened with MDB_INTEGERKEY so that keys are compared numerically
+         * rather than byte-wise, which keeps the key order equal to the insertion order and
+         * allows new records to be written with LMDBTransaction::append()
+         *
+         * @param name
+         * @param flags additional flags (ie. MDB_DUPSORT)
          * @return
          */
-        std::shared_ptr<LMDBDatabase> open_database(const std::string &name, int flags = 0);
+        std::shared_ptr<LMDBDatabase> open_sequential_database(const std::string &name, int flags = 0);
+
+        /**
+         * Expands the memory map ahead of time if less of it remains unused than the free
+         * space threshold of the growth policy allows
+         *
+         * This should be called after committing write transactions so that a growing database
+         * is resized between transactions instead of in the middle of one.
+         *
+         * @return
+         */
+        Error maintain_map_size();
 
         /**
          * Returns the number of open R/W transactions in the environment
@@ -183,6 +487,15 @@ namespace Database
          */
         size_t open_transactions() const;
 
+        /**
+         * Ensures that at least the specified number of bytes of the memory map remain unused,
+         * expanding the memory map if required (ie. before writing a known amount of data)
+         *
+         * @param bytes
+         * @return
+         */
+        Error reserve(size_t bytes);
+
         /**
          * Sets/changes the LMDB environment flags
          *
@@ -191,6 +504,13 @@ namespace Database
          */
         Error set_flags(int flags = 0, bool flag_state = true);
 
+        /**
+         * Sets the growth policy of the memory map
+         *
+         * @param policy
+         */
+        void set_growth_policy(const growth_policy_t &policy);
+
         /**
          * Retrieves the LMDB environment statistics
          *
@@ -206,6 +526,36 @@ namespace Database
          */
         std::unique_ptr<LMDBTransaction> transaction(bool readonly = false) const;
 
+        /**
+         * Takes a previously reset read-only transaction handle from the pool of the calling
+         * thread's shard, or returns nullptr if that shard is empty
+         *
+         * DO NOT USE THIS METHOD DIRECTLY!
+         *
+         * @return
+         */
+        std::shared_ptr<MDB_txn *> transaction_checkout();
+
+        /**
+         * Returns a reset read-only transaction handle to the pool of the calling thread's
+         * shard, aborting the handle instead if the shard is full or the pool is disabled
+         *
+         * DO NOT USE THIS METHOD DIRECTLY!
+         *
+         * @param txn
+         */
+        void transaction_checkin(std::shared_ptr<MDB_txn *> &txn);
+
+        /**
+         * Sets the number of reset read-only transaction handles that each shard of the pool
+         * keeps for reuse. A size of zero disables the pool.
+         *
+         * Every pooled handle holds on to one of the reader slots of the environment.
+         *
+         * @param shard_size
+         */
+        void set_read_transaction_pool_size(size_t shard_size);
+
         /**
          * Registers a new transaction in the environment
          *
@@ -215,6 +565,13 @@ namespace Database
          */
         void transaction_register(const LMDBTransaction &txn);
 
+        /**
+         * Records that a transaction was retried after expanding the memory map
+         *
+         * DO NOT USE THIS METHOD DIRECTLY!
+         */
+        void transaction_retried();
+
         /**
          * Un-registers a transaction from the environment
          *
@@ -240,17 +597,70 @@ namespace Database
          */
         std::tuple<Error, size_t> memory_to_pages(size_t memory) const;
 
+        /**
+         * Retrieves the current size of the memory map and how much of it is in use (in bytes)
+         *
+         * @return [error, map size, used size]
+         */
+        std::tuple<Error, size_t, size_t> map_usage() const;
+
+        /**
+         * Sets the memory map to the specified size (0 adopts the size set by another process)
+         *
+         * New transactions are held back while waiting (for as long as it takes) for the open
+         * transactions to finish so that the memory map can be safely remapped. Threads that already
+         * hold a transaction may still start new ones, as the resize is waiting on them, and the
+         * resize fails straight away if the calling thread itself holds a transaction.
+         *
+         * Please note: a transaction is expected to end on the thread that started it.
+         *
+         * @param map_size
+         * @return
+         */
+        Error resize(size_t map_size) const;
+
+        struct read_txn_pool_shard_t
+        {
+            std::mutex mutex;
+
+            std::vector<std::shared_ptr<MDB_txn *>> txns;
+        };
+
+        /**
+         * Returns the read-only transaction pool shard used by the calling thread
+         *
+         * @return
+         */
+        read_txn_pool_shard_t &read_txn_pool_shard();
+
+        /**
+         * Aborts every read-only transaction handle held in the pool
+         */
+        void read_txn_pool_clear();
+
         std::string m_id;
 
         size_t m_growth_factor;
 
+        growth_policy_t m_growth_policy;
+
         MDB_env *m_env;
 
         mutable std::mutex m_mutex, m_txn_mutex;
 
+        mutable std::condition_variable m_txn_cv;
+
         std::map<std::string, std::shared_ptr<LMDBDatabase>> m_databases;
 
-        size_t m_open_txns;
+        size_t m_open_txns, m_active_txns;
+
+        mutable bool m_resizing;
+
+        mutable std::atomic<size_t> m_expansions, m_proactive_expansions, m_failed_expansions, m_retried_txns;
+
+        std::vector<std::unique_ptr<read_txn_pool_shard_t>> m_read_txn_pool;
+
+        std::atomic<size_t> m_read_txn_pool_shard_size;
     };
 
     /**
@@ -267,8 +677,13 @@ namespace Database
          * @param env
          * @param name
          * @param flags
+         * @param key_encoding
          */
-        LMDBDatabase(std::shared_ptr<LMDB> &env, const std::string &name = "", int flags = MDB_CREATE);
+        LMDBDatabase(
+            std::shared_ptr<LMDB> &env,
+            const std::string &name = "",
+            int flags = MDB_CREATE,
+            key_encoding_t key_encoding = KEY_ENCODING_NATIVE);
 
         ~LMDBDatabase();
 
@@ -277,10 +692,39 @@ namespace Database
         /**
          * Returns how many key/value pairs currently exist in the database
          *
-         * @return
+         * The count is read from the B-tree statistics that LMDB maintains for
+         * the database and is therefore a constant time operation
+         *
+         * @return the number of pairs, or 0 if the statistics could not be read
          */
         size_t count();
 
+        /**
+         * Returns whether the values of the database are compressed
+         *
+         * @return
+         */
+        [[nodiscard]] bool compressed() const;
+
+        /**
+         * Encodes a value (with its format tag) to be written to a compressed database
+         *
+         * @param value
+         * @return
+         */
+        [[nodiscard]] std::vector<uint8_t> compress_value(const MDB_val &value) const;
+
+        /**
+         * Replaces a value read from a compressed database with its decoded value
+         *
+         * Compressed values are decompressed into a buffer owned by the calling thread, so the
+         * decoded value is only valid until the next compressed value is read on the same thread.
+         *
+         * @param value
+         * @return
+         */
+        Error decompress_value(MDB_val &value) const;
+
         /**
          * Simplified deletion of the given key and its value. Automatically opens a
          * transaction, deletes the key, and commits the transaction, then returns.
@@ -380,16 +824,11 @@ namespace Database
         {
             std::vector<ValueType> results;
 
-            const auto keys = list_keys<KeyType>();
+            auto values = range<KeyType, ValueType>();
 
-            for (const auto &key : keys)
+            for (auto it = values.begin(); it != values.end(); ++it)
             {
-                const auto [error, value] = get<KeyType, ValueType>(key);
-
-                if (!error)
-                {
-                    results.push_back(value);
-                }
+                results.push_back(it.value());
             }
 
             return results;
@@ -402,6 +841,34 @@ namespace Database
          */
         std::tuple<Error, unsigned int> get_flags();
 
+        /**
+         * Returns a range that lazily iterates every key/value pair in the database in key order
+         * (or in reverse key order) within a read transaction owned by the range
+         *
+         * @tparam KeyType
+         * @tparam ValueType
+         * @param reverse
+         * @return
+         */
+        template<typename KeyType, typename ValueType> LMDBRange<KeyType, ValueType> range(bool reverse = false);
+
+        /**
+         * Returns a range that lazily iterates the key/value pairs in the database whose keys fall
+         * within the inclusive range specified within a read transaction owned by the range
+         *
+         * Integer bounds require a database that stores its keys big-endian or as integers; on any
+         * other database the range is empty and its error() reports LMDB_INCOMPATIBLE.
+         *
+         * @tparam KeyType
+         * @tparam ValueType
+         * @param from
+         * @param to
+         * @param reverse
+         * @return
+         */
+        template<typename KeyType, typename ValueType>
+        LMDBRange<KeyType, ValueType> range(const KeyType &from, const KeyType &to, bool reverse = false);
+
         /**
          * List all keys in the database
          *
@@ -461,21 +928,65 @@ namespace Database
         std::string id() const;
 
         /**
-         * Opens a transaction in the database
+         * Compresses every value written to the database from now on using the dictionary specified
          *
-         * @param readonly
+         * Every value in a compressed database carries a format tag, so compression must be enabled
+         * every time the database is opened (and before it is first written to). The dictionaries
+         * used previously must be supplied first, oldest to newest, so that the values compressed
+         * with them can still be read; the last dictionary supplied is used for writes.
+         *
+         * Databases that allow duplicates (MDB_DUPSORT) cannot be compressed as LMDB sorts their
+         * values by the bytes stored.
+         *
+         * @param dictionary
          * @return
          */
-        std::unique_ptr<LMDBTransaction> transaction(bool readonly = false);
+        Error set_compression(const std::shared_ptr<const CompressionDictionary> &dictionary);
 
-      private:
+        /**
+         * Returns how unsigned 64-bit keys are stored in the database
+         *
+         * @return
+         */
+        [[nodiscard]] key_encoding_t key_encoding() const;
+
+        /**
+         * Opens a transaction in the database
+         *
+         * @param readonly
+         * @return
+         */
+        std::unique_ptr<LMDBTransaction> transaction(bool readonly = false);
+
+      private:
         std::string m_id;
 
         std::shared_ptr<LMDB> m_env;
 
         MDB_dbi m_dbi;
 
+        /**
+         * Whether the handle is still open, which it is not once the database has been deleted
+         */
+        bool m_dbi_open;
+
+        key_encoding_t m_key_encoding;
+
         mutable std::mutex m_db_mutex;
+
+        struct compression_t
+        {
+            std::shared_ptr<const CompressionDictionary> dictionary;
+
+            std::map<uint64_t, std::shared_ptr<const CompressionDictionary>> dictionaries;
+        };
+
+        std::atomic<bool> m_compressed;
+
+        /**
+         * Replaced (never modified) when a dictionary is added so that readers need not lock
+         */
+        std::shared_ptr<const compression_t> m_compression;
     };
 
     /**
@@ -520,6 +1031,42 @@ namespace Database
          */
         void abort();
 
+        /**
+         * Appends the specified value with the specified key to the end of a sequential database
+         *
+         * The key must be greater than the last key in the database (or, when appending a duplicate,
+         * the value must be greater than the last value of the last key); otherwise, the write
+         * is rejected. Appending skips the B-tree search and fills pages completely rather
+         * than splitting them in half.
+         *
+         * Note: You must check for MDB_MAP_FULL or MDB_TXN_FULL response values and handle those
+         * yourself as you will very likely need to abort the current transaction and expand
+         * the LMDB environment before re-attempting the transaction.
+         *
+         * @tparam ValueType
+         * @param key
+         * @param value
+         * @param duplicate whether the value is a duplicate of the last key in a MDB_DUPSORT database
+         * @return
+         */
+        template<typename ValueType>
+        Error append(const uint64_t &key, const ValueType &value, bool duplicate = false)
+        {
+            MDB_VAL_KEY(key, m_db, i_key);
+
+            MDB_VAL_VALUE(value, m_db, i_value);
+
+            const auto result = mdb_put(*m_txn, *m_db, &i_key, &i_value, (duplicate) ? MDB_APPENDDUP : MDB_APPEND);
+
+            if (result == MDB_KEYEXIST)
+            {
+                return MAKE_ERROR_MSG(
+                    LMDB_KEYEXIST, "Appended key is not greater than the last key in the sequential database");
+            }
+
+            return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
+        }
+
         /**
          * Commits the currently open transaction
          *
@@ -527,6 +1074,17 @@ namespace Database
          */
         Error commit();
 
+        /**
+         * Returns how many key/value pairs exist in the current database as seen
+         * by this transaction (including any uncommitted writes made within it)
+         *
+         * This is a constant time operation as it uses the statistics LMDB
+         * maintains for the database.
+         *
+         * @return
+         */
+        std::tuple<Error, size_t> count();
+
         /**
          * Opens a LMDB cursor within the transaction
          *
@@ -565,7 +1123,7 @@ namespace Database
          */
         Error del(const uint64_t &key)
         {
-            MDB_VAL_NUM(key, i_key);
+            MDB_VAL_KEY(key, m_db, i_key);
 
             const auto result = mdb_del(*m_txn, *m_db, &i_key, nullptr);
 
@@ -610,7 +1168,7 @@ namespace Database
          */
         template<typename ValueType> Error del(const uint64_t &key, const ValueType &value)
         {
-            MDB_VAL_NUM(key, i_key);
+            MDB_VAL_KEY(key, m_db, i_key);
 
             MDB_VAL(value, i_value);
 
@@ -655,16 +1213,14 @@ namespace Database
          */
         template<typename KeyType, typename ValueType> std::tuple<Error, ValueType> get(const KeyType &key)
         {
-            const auto [error, data] = get(key);
+            const auto [error, view] = get_view(key);
 
-            ValueType result;
-
-            if (!error)
+            if (error)
             {
-                result = ValueType(data);
+                return {error, {}};
             }
 
-            return {error, result};
+            return {error, view.template decode<ValueType>()};
         }
 
         /**
@@ -676,34 +1232,60 @@ namespace Database
          */
         template<typename ValueType> std::tuple<Error, ValueType> get(const uint64_t &key)
         {
-            MDB_VAL_NUM(key, i_key);
+            const auto [error, view] = get_view(key);
+
+            if (error)
+            {
+                return {error, {}};
+            }
+
+            return {error, view.template decode<ValueType>()};
+        }
+
+        /**
+         * Retrieves the value stored with the specified key
+         *
+         * @tparam KeyType
+         * @param key
+         * @return [found, value]
+         */
+        template<typename KeyType> std::tuple<Error, std::vector<uint8_t>> get(const KeyType &key)
+        {
+            MDB_VAL(key, i_key);
 
             MDB_val value;
 
             const auto result = mdb_get(*m_txn, *m_db, &i_key, &value);
 
-            std::vector<uint8_t> data;
-
-            ValueType _value;
+            std::vector<uint8_t> results;
 
             if (result == MDB_SUCCESS)
             {
-                data = FROM_MDB_VAL(value);
+                const auto decode_error = m_db->decompress_value(value);
+
+                if (decode_error)
+                {
+                    return {decode_error, {}};
+                }
 
-                _value = ValueType(data);
+                results = FROM_MDB_VAL(value);
             }
 
-            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), _value};
+            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), results};
         }
 
         /**
-         * Retrieves the value stored with the specified key
+         * Retrieves a view of the value stored with the specified key without copying it
+         * out of the memory map
+         *
+         * The view is only valid for the lifetime of this transaction and must not be used
+         * after this transaction writes to the same database
          *
          * @tparam KeyType
          * @param key
          * @return [found, value]
          */
-        template<typename KeyType> std::tuple<Error, std::vector<uint8_t>> get(const KeyType &key)
+        template<typename KeyType> std::tuple<Error, LMDBValueView> get_view(const KeyType &key)
         {
             MDB_VAL(key, i_key);
 
@@ -711,16 +1293,33 @@ namespace Database
 
             const auto result = mdb_get(*m_txn, *m_db, &i_key, &value);
 
-            std::vector<uint8_t> results;
+            if (result != MDB_SUCCESS)
+            {
+                return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}};
+            }
 
-            if (result == MDB_SUCCESS)
+            const auto decode_error = m_db->decompress_value(value);
+
+            if (decode_error)
             {
-                results = FROM_MDB_VAL(value);
+                return {decode_error, {}};
             }
 
-            return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), results};
+            return {MAKE_ERROR(SUCCESS), LMDBValueView(value)};
         }
 
+        /**
+         * Retrieves a view of the value stored with the specified key without copying it
+         * out of the memory map
+         *
+         * The view is only valid for the lifetime of this transaction and must not be used
+         * after this transaction writes to the same database
+         *
+         * @param key
+         * @return [found, value]
+         */
+        std::tuple<Error, LMDBValueView> get_view(const uint64_t &key);
+
         /**
          * Returns the transaction ID
          *
@@ -749,7 +1348,7 @@ namespace Database
         {
             MDB_VAL(key, i_key);
 
-            MDB_VAL(value, i_value);
+            MDB_VAL_VALUE(value, m_db, i_value);
 
             const auto result = mdb_put(*m_txn, *m_db, &i_key, &i_value, flags);
 
@@ -771,15 +1370,43 @@ namespace Database
          */
         template<typename ValueType> Error put(const uint64_t &key, const ValueType &value, int flags = 0)
         {
-            MDB_VAL_NUM(key, i_key);
+            MDB_VAL_KEY(key, m_db, i_key);
 
-            MDB_VAL(value, i_value);
+            MDB_VAL_VALUE(value, m_db, i_value);
 
             const auto result = mdb_put(*m_txn, *m_db, &i_key, &i_value, flags);
 
             return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
         }
 
+        /**
+         * Returns a range that lazily iterates every key/value pair in the current database in key
+         * order (or in reverse key order) within this transaction
+         *
+         * @tparam KeyType
+         * @tparam ValueType
+         * @param reverse
+         * @return
+         */
+        template<typename KeyType, typename ValueType> LMDBRange<KeyType, ValueType> range(bool reverse = false);
+
+        /**
+         * Returns a range that lazily iterates the key/value pairs in the current database whose
+         * keys fall within the inclusive range specified within this transaction
+         *
+         * Integer bounds require a database that stores its keys big-endian or as integers; on any
+         * other database the range is empty and its error() reports LMDB_INCOMPATIBLE.
+         *
+         * @tparam KeyType
+         * @tparam ValueType
+         * @param from
+         * @param to
+         * @param reverse
+         * @return
+         */
+        template<typename KeyType, typename ValueType>
+        LMDBRange<KeyType, ValueType> range(const KeyType &from, const KeyType &to, bool reverse = false);
+
         /**
          * Returns if the transaction is readonly or not
          *
@@ -790,12 +1417,20 @@ namespace Database
         /**
          * Renew a read-only transaction that has been previously reset()
          *
+         * This takes a new snapshot of the database and waits out any resize of the memory map
+         * that is in progress.
+         *
          * @return
          */
         Error renew();
 
         /**
-         * Reset a read-only transaction.
+         * Reset a read-only transaction, releasing its snapshot of the database while keeping
+         * the handle (and its reader slot) so that it can be cheaply renew()'d later
+         *
+         * A reset transaction does not hold back a resize of the memory map.
+         *
+         * @return
          */
         Error reset();
 
@@ -804,7 +1439,7 @@ namespace Database
          *
          * @param db
          */
-        void set_database(std::shared_ptr<LMDBDatabase> &db);
+        void set_database(const std::shared_ptr<LMDBDatabase> &db);
 
       private:
         /**
@@ -818,7 +1453,7 @@ namespace Database
 
         std::shared_ptr<MDB_txn *> m_txn;
 
-        bool m_readonly;
+        bool m_readonly, m_reset = false;
     };
 
     /**
@@ -857,6 +1492,39 @@ namespace Database
          */
         Error del(int flags = 0);
 
+        /**
+         * Returns a range that lazily iterates the values stored with the specified key (in
+         * value order or in reverse value order) using this cursor
+         *
+         * Requires that MDB_DUPSORT was used when opening the database
+         *
+         * @tparam ValueType
+         * @tparam KeyType
+         * @param key
+         * @param reverse
+         * @return
+         */
+        template<typename ValueType, typename KeyType>
+        LMDBRange<KeyType, ValueType> dups(const KeyType &key, bool reverse = false);
+
+        /**
+         * Visits, in numeric key order, every key/value pair (including every duplicate of a key)
+         * whose key falls within the inclusive range specified until the visitor returns false
+         *
+         * The database must store its keys big-endian or as integers so that the order LMDB keeps
+         * them in is their numeric order. The values handed to the visitor are views that are only
+         * valid for the duration of the call.
+         *
+         * @param first
+         * @param last
+         * @param visitor
+         * @return
+         */
+        Error for_each(
+            const uint64_t &first,
+            const uint64_t &last,
+            const std::function<bool(const uint64_t &, const LMDBValueView &)> &visitor);
+
         /**
          * Retrieve key/data pairs by cursor.
          *
@@ -876,20 +1544,14 @@ namespace Database
         template<typename KeyType, typename ValueType>
         std::tuple<Error, KeyType, ValueType> get(const MDB_cursor_op &op = MDB_FIRST)
         {
-            const auto [error, r_key, r_value] = get(op);
+            const auto [error, r_key, r_value] = get_view(op);
 
-            KeyType key;
-
-            ValueType value;
-
-            if (!error)
+            if (error)
             {
-                key = KeyType(r_key);
-
-                value = ValueType(r_value);
+                return {error, {}, {}};
             }
 
-            return {error, key, value};
+            return {error, r_key.template decode<KeyType>(), r_value.template decode<ValueType>()};
         }
 
         /**
@@ -918,14 +1580,14 @@ namespace Database
         template<typename ValueType>
         std::tuple<Error, uint64_t, ValueType> get(const uint64_t &key, const MDB_cursor_op &op = MDB_SET)
         {
-            const auto [error, result_key, data] = get(key, op);
+            const auto [error, result_key, data] = get_view(key, op);
 
             if (error)
             {
                 return {error, 0, {}};
             }
 
-            return {error, result_key, ValueType(data)};
+            return {error, result_key, data.template decode<ValueType>()};
         }
 
         /**
@@ -953,6 +1615,13 @@ namespace Database
 
             if (result == MDB_SUCCESS)
             {
+                const auto decode_error = m_db->decompress_value(i_value);
+
+                if (decode_error)
+                {
+                    return {decode_error, {}, {}};
+                }
+
                 r_key = FROM_MDB_VAL(i_key);
 
                 r_value = FROM_MDB_VAL(i_value);
@@ -976,20 +1645,69 @@ namespace Database
         template<typename KeyType, typename ValueType>
         std::tuple<Error, KeyType, ValueType> get(const KeyType &key, const MDB_cursor_op &op = MDB_SET)
         {
-            const auto [error, i_key, i_value] = get(key, op);
+            const auto [error, i_key, i_value] = get_view(key, op);
+
+            if (error)
+            {
+                return {error, {}, {}};
+            }
+
+            return {error, i_key.template decode<KeyType>(), i_value.template decode<ValueType>()};
+        }
+
+        /**
+         * Retrieve views of key/data pairs by cursor without copying them out of the memory map
+         *
+         * The views are only valid until the cursor moves or its transaction ends
+         *
+         * @param op
+         * @return [found, key, value]
+         */
+        std::tuple<Error, LMDBValueView, LMDBValueView> get_view(const MDB_cursor_op &op = MDB_FIRST);
+
+        /**
+         * Retrieve a view of the value by cursor without copying it out of the memory map
+         *
+         * The view is only valid until the cursor moves or its transaction ends
+         *
+         * @param key
+         * @param op
+         * @return [found, key, value]
+         */
+        std::tuple<Error, uint64_t, LMDBValueView> get_view(const uint64_t &key, const MDB_cursor_op &op = MDB_SET);
+
+        /**
+         * Retrieve views of key/data pairs by cursor without copying them out of the memory map
+         *
+         * The views are only valid until the cursor moves or its transaction ends
+         *
+         * @tparam KeyType
+         * @param key
+         * @param op
+         * @return [found, key, value]
+         */
+        template<typename KeyType>
+        std::tuple<Error, LMDBValueView, LMDBValueView> get_view(const KeyType &key, const MDB_cursor_op &op = MDB_SET)
+        {
+            MDB_val i_value;
 
-            KeyType r_key;
+            MDB_VAL(key, i_key);
 
-            ValueType r_value;
+            const auto result = mdb_cursor_get(m_cursor, &i_key, &i_value, op);
 
-            if (!error)
+            if (result != MDB_SUCCESS)
             {
-                r_key = KeyType(i_key);
+                return {MAKE_ERROR_MSG(result, MDB_STR_ERR(result)), {}, {}};
+            }
+
+            const auto decode_error = m_db->decompress_value(i_value);
 
-                r_value = ValueType(i_value);
+            if (decode_error)
+            {
+                return {decode_error, {}, {}};
             }
 
-            return {error, r_key, r_value};
+            return {MAKE_ERROR(SUCCESS), LMDBValueView(i_key), LMDBValueView(i_value)};
         }
 
         /**
@@ -1007,19 +1725,13 @@ namespace Database
         {
             std::vector<ValueType> results;
 
-            bool success = false;
+            auto values = dups<ValueType>(key);
 
-            do
+            // only the values are decoded, the key is already known
+            for (auto it = values.begin(); it != values.end(); ++it)
             {
-                const auto [error, k, v] = get<KeyType, ValueType>(key, (!success) ? MDB_SET : MDB_NEXT_DUP);
-
-                if (!error)
-                {
-                    results.push_back(v);
-                }
-
-                success = error == SUCCESS;
-            } while (success);
+                results.push_back(it.value());
+            }
 
             Error error = (!results.empty()) ? SUCCESS : LMDB_EMPTY;
 
@@ -1046,7 +1758,7 @@ namespace Database
         {
             MDB_VAL(key, i_key);
 
-            MDB_VAL(value, i_value);
+            MDB_VAL_VALUE(value, m_db, i_value);
 
             const auto result = mdb_cursor_put(m_cursor, &i_key, &i_value, flags);
 
@@ -1069,15 +1781,30 @@ namespace Database
          */
         template<typename ValueType> Error put(const uint64_t &key, const ValueType &value, int flags = 0)
         {
-            MDB_VAL_NUM(key, i_key);
+            MDB_VAL_KEY(key, m_db, i_key);
 
-            MDB_VAL(value, i_value);
+            MDB_VAL_VALUE(value, m_db, i_value);
 
             const auto result = mdb_cursor_put(m_cursor, &i_key, &i_value, flags);
 
             return MAKE_ERROR_MSG(result, MDB_STR_ERR(result));
         }
 
+        /**
+         * Puts the key and value exactly as they are to be stored in the database (ie. as they were
+         * read from the database) using the specified flag(s), bypassing the key encoding and any
+         * compression of the database
+         *
+         * Note: You must check for MDB_MAP_FULL or MDB_TXN_FULL response values and handle those
+         * yourself as described for put()
+         *
+         * @param key
+         * @param value
+         * @param flags
+         * @return
+         */
+        Error put_stored(const std::vector<uint8_t> &key, const std::vector<uint8_t> &value, int flags = 0);
+
         /**
          * Renews the cursor
          *
@@ -1095,6 +1822,365 @@ namespace Database
         bool m_readonly;
     };
 
+    /**
+     * Converts keys of the specified type to and from the bytes stored in a database
+     *
+     * @tparam KeyType
+     */
+    template<typename KeyType> struct lmdb_key_codec_t
+    {
+        static std::vector<uint8_t> encode(const KeyType &key, key_encoding_t)
+        {
+            return std::vector<uint8_t>(key.data(), key.data() + key.size());
+        }
+
+        static KeyType decode(const LMDBValueView &key, key_encoding_t)
+        {
+            return key.template decode<KeyType>();
+        }
+    };
+
+    template<> struct lmdb_key_codec_t<uint64_t>
+    {
+        static std::vector<uint8_t> encode(const uint64_t &key, key_encoding_t encoding)
+        {
+            return encode_key_bytes(key, encoding);
+        }
+
+        static uint64_t decode(const LMDBValueView &key, key_encoding_t encoding)
+        {
+            return decode_key(key.data(), key.size(), encoding);
+        }
+    };
+
+    /**
+     * A single pass range over the key/value pairs of a database (or over the duplicates of a
+     * single key) that is walked with a cursor as it is iterated
+     *
+     * Nothing is read until the range is iterated and keys and values are only decoded when they
+     * are dereferenced, so streaming a large table uses a constant amount of memory and stopping
+     * early (ie. via break) skips the rest of the table entirely.
+     *
+     * The range must not outlive the transaction it reads from. Ranges obtained from a database
+     * own their read transaction; ranges obtained from a transaction or a cursor borrow it.
+     *
+     * @tparam KeyType
+     * @tparam ValueType
+     */
+    template<typename KeyType, typename ValueType> class LMDBRange
+    {
+      public:
+        class iterator
+        {
+          public:
+            using iterator_category = std::input_iterator_tag;
+
+            using value_type = std::pair<KeyType, ValueType>;
+
+            using difference_type = std::ptrdiff_t;
+
+            using pointer = const value_type *;
+
+            using reference = const value_type &;
+
+            iterator() = default;
+
+            explicit iterator(LMDBRange *range): m_range(range) {}
+
+            reference operator*() const
+            {
+                if (!m_item)
+                {
+                    m_item.emplace(key(), value());
+                }
+
+                return *m_item;
+            }
+
+            pointer operator->() const
+            {
+                return &operator*();
+            }
+
+            iterator &operator++()
+            {
+                m_item.reset();
+
+                if (!m_range->advance())
+                {
+                    m_range = nullptr;
+                }
+
+                return *this;
+            }
+
+            bool operator==(const iterator &other) const
+            {
+                return m_range == other.m_range;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return m_range != other.m_range;
+            }
+
+            /**
+             * Decodes only the key of the current pair
+             *
+             * @return
+             */
+            KeyType key() const
+            {
+                return lmdb_key_codec_t<KeyType>::decode(m_range->m_key, m_range->m_encoding);
+            }
+
+            /**
+             * Decodes only the value of the current pair
+             *
+             * @return
+             */
+            ValueType value() const
+            {
+                return m_range->m_value.template decode<ValueType>();
+            }
+
+            /**
+             * Returns a view of the undecoded value of the current pair
+             *
+             * @return
+             */
+            const LMDBValueView &value_view() const
+            {
+                return m_range->m_value;
+            }
+
+          private:
+            LMDBRange *m_range = nullptr;
+
+            mutable std::optional<value_type> m_item;
+        };
+
+        /**
+         * DO NOT CALL THIS METHOD DIRECTLY!
+         *
+         * @param txn the transaction owned by the range, if any
+         * @param owned_cursor the cursor owned by the range, if any
+         * @param cursor
+         * @param encoding
+         * @param reverse
+         */
+        LMDBRange(
+            std::unique_ptr<LMDBTransaction> txn,
+            std::unique_ptr<LMDBCursor> owned_cursor,
+            LMDBCursor *cursor,
+            key_encoding_t encoding,
+            bool reverse):
+            m_txn(std::move(txn)),
+            m_owned_cursor(std::move(owned_cursor)),
+            m_cursor(cursor),
+            m_encoding(encoding),
+            m_reverse(reverse)
+        {
+        }
+
+        /**
+         * Positions the cursor at the first pair of the range
+         *
+         * @return
+         */
+        iterator begin()
+        {
+            if (m_rejected)
+            {
+                return end();
+            }
+
+            if (m_dup_key)
+            {
+                move(*m_dup_key, MDB_SET);
+
+                if (!m_done && m_reverse)
+                {
+                    move(MDB_LAST_DUP);
+                }
+            }
+            else if (!m_reverse && m_lower)
+            {
+                move(*m_lower, MDB_SET_RANGE);
+            }
+            else if (!m_reverse)
+            {
+                move(MDB_FIRST);
+            }
+            else if (m_upper)
+            {
+                move(*m_upper, MDB_SET_RANGE);
+
+                if (m_done && m_error == LMDB_NOTFOUND)
+                {
+                    // every key in the database sorts before the upper bound
+                    move(MDB_LAST);
+                }
+                else if (!m_done && compare(*m_upper) > 0)
+                {
+                    move(MDB_PREV);
+                }
+                else if (!m_done && dupsort())
+                {
+                    move(MDB_LAST_DUP);
+                }
+            }
+            else
+            {
+                move(MDB_LAST);
+            }
+
+            return iterator(in_bounds() ? this : nullptr);
+        }
+
+        iterator end()
+        {
+            return iterator();
+        }
+
+        /**
+         * Returns the error that stopped the iteration, if it was stopped by something other than
+         * reaching the end of the range
+         *
+         * @return
+         */
+        [[nodiscard]] Error error() const
+        {
+            if (m_error == LMDB_NOTFOUND)
+            {
+                return MAKE_ERROR(SUCCESS);
+            }
+
+            return m_error;
+        }
+
+        /**
+         * DO NOT CALL THIS METHOD DIRECTLY!
+         *
+         * @param lower
+         * @param upper
+         */
+        void set_bounds(std::optional<std::vector<uint8_t>> lower, std::optional<std::vector<uint8_t>> upper)
+        {
+            // native integer keys are compared byte-wise, which is not their numeric order
+            if (std::is_same_v<KeyType, uint64_t> && m_encoding == KEY_ENCODING_NATIVE)
+            {
+                m_error = MAKE_ERROR_MSG(LMDB_INCOMPATIBLE, "Range scans require big-endian or integer keys");
+
+                m_rejected = true;
+
+                return;
+            }
+
+            m_lower = std::move(lower);
+
+            m_upper = std::move(upper);
+        }
+
+        /**
+         * DO NOT CALL THIS METHOD DIRECTLY!
+         *
+         * @param key
+         */
+        void set_dup_key(std::vector<uint8_t> key)
+        {
+            m_dup_key = std::move(key);
+        }
+
+      private:
+        /**
+         * Moves the cursor to the next pair of the range
+         *
+         * @return whether the cursor is still within the range
+         */
+        bool advance()
+        {
+            if (m_dup_key)
+            {
+                move((m_reverse) ? MDB_PREV_DUP : MDB_NEXT_DUP);
+            }
+            else
+            {
+                move((m_reverse) ? MDB_PREV : MDB_NEXT);
+            }
+
+            return in_bounds();
+        }
+
+        /**
+         * Compares the key under the cursor with the specified encoded key
+         *
+         * @param other
+         * @return
+         */
+        int compare(const std::vector<uint8_t> &other) const
+        {
+            MDB_val a = {m_key.size(), (void *)m_key.data()}, b = {other.size(), (void *)other.data()};
+
+            return mdb_cmp(mdb_cursor_txn(*m_cursor), mdb_cursor_dbi(*m_cursor), &a, &b);
+        }
+
+        bool dupsort() const
+        {
+            unsigned int flags = 0;
+
+            mdb_dbi_flags(mdb_cursor_txn(*m_cursor), mdb_cursor_dbi(*m_cursor), &flags);
+
+            return flags & MDB_DUPSORT;
+        }
+
+        bool in_bounds() const
+        {
+            if (m_done)
+            {
+                return false;
+            }
+
+            if (m_reverse)
+            {
+                return !m_lower || compare(*m_lower) >= 0;
+            }
+
+            return !m_upper || compare(*m_upper) <= 0;
+        }
+
+        void move(const MDB_cursor_op &op)
+        {
+            std::tie(m_error, m_key, m_value) = m_cursor->get_view(op);
+
+            m_done = bool(m_error);
+        }
+
+        void move(const std::vector<uint8_t> &key, const MDB_cursor_op &op)
+        {
+            std::tie(m_error, m_key, m_value) = m_cursor->get_view(key, op);
+
+            m_done = bool(m_error);
+        }
+
+        // the transaction must be destroyed after the cursor that reads from it
+        std::unique_ptr<LMDBTransaction> m_txn;
+
+        std::unique_ptr<LMDBCursor> m_owned_cursor;
+
+        LMDBCursor *m_cursor;
+
+        key_encoding_t m_encoding;
+
+        bool m_reverse, m_done = true, m_rejected = false;
+
+        std::optional<std::vector<uint8_t>> m_lower, m_upper, m_dup_key;
+
+        Error m_error;
+
+        LMDBValueView m_key, m_value;
+    };
+
     /**
      * Complete the template forward declarations. Check the forward declarations for
      * more information regarding each method
@@ -1151,16 +2237,9 @@ namespace Database
 
     template<typename KeyType, typename ValueType> std::tuple<Error, ValueType> LMDBDatabase::get(const KeyType &key)
     {
-        const auto [error, data] = get(key);
-
-        ValueType result;
-
-        if (!error)
-        {
-            result = ValueType(data);
-        }
+        auto txn = transaction(true);
 
-        return {error, result};
+        return txn->get<KeyType, ValueType>(key);
     }
 
     template<typename ValueType> std::tuple<Error, ValueType> LMDBDatabase::get(const uint64_t &key)
@@ -1283,6 +2362,60 @@ namespace Database
 
         return error;
     }
+
+    template<typename ValueType, typename KeyType>
+    LMDBRange<KeyType, ValueType> LMDBCursor::dups(const KeyType &key, bool reverse)
+    {
+        LMDBRange<KeyType, ValueType> result(nullptr, nullptr, this, m_db->key_encoding(), reverse);
+
+        result.set_dup_key(lmdb_key_codec_t<KeyType>::encode(key, m_db->key_encoding()));
+
+        return result;
+    }
+
+    template<typename KeyType, typename ValueType> LMDBRange<KeyType, ValueType> LMDBDatabase::range(bool reverse)
+    {
+        auto txn = transaction(true);
+
+        auto txn_cursor = txn->cursor();
+
+        auto cursor = txn_cursor.get();
+
+        return LMDBRange<KeyType, ValueType>(std::move(txn), std::move(txn_cursor), cursor, m_key_encoding, reverse);
+    }
+
+    template<typename KeyType, typename ValueType>
+    LMDBRange<KeyType, ValueType> LMDBDatabase::range(const KeyType &from, const KeyType &to, bool reverse)
+    {
+        auto result = range<KeyType, ValueType>(reverse);
+
+        result.set_bounds(
+            lmdb_key_codec_t<KeyType>::encode(from, m_key_encoding),
+            lmdb_key_codec_t<KeyType>::encode(to, m_key_encoding));
+
+        return result;
+    }
+
+    template<typename KeyType, typename ValueType> LMDBRange<KeyType, ValueType> LMDBTransaction::range(bool reverse)
+    {
+        auto txn_cursor = cursor();
+
+        auto raw_cursor = txn_cursor.get();
+
+        return LMDBRange<KeyType, ValueType>(nullptr, std::move(txn_cursor), raw_cursor, m_db->key_encoding(), reverse);
+    }
+
+    template<typename KeyType, typename ValueType>
+    LMDBRange<KeyType, ValueType> LMDBTransaction::range(const KeyType &from, const KeyType &to, bool reverse)
+    {
+        auto result = range<KeyType, ValueType>(reverse);
+
+        result.set_bounds(
+            lmdb_key_codec_t<KeyType>::encode(from, m_db->key_encoding()),
+            lmdb_key_codec_t<KeyType>::encode(to, m_db->key_encoding()));
+
+        return result;
+    }
 } // namespace Database
 
 #endif // DATABASE_LMDB_H
@@ -0,0 +1,365 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <algorithm>
+#include <blockchain_storage.h>
+#include <chain_verifier.h>
+#include <chrono>
+#include <cli_helper.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/fs.h>
+#include <cstdio>
+#include <logger.h>
+#include <snapshot.h>
+#include <staking_engine.h>
+#include <thread>
+
+/**
+ * Removes the file or directory (and its contents) at the specified path, if it exists
+ *
+ * @param path
+ */
+static void remove_path(const std::string &path)
+{
+    auto handle = cppfs::fs::open(path);
+
+    if (handle.isDirectory())
+    {
+        handle.removeDirectoryRec();
+    }
+    else if (handle.isFile())
+    {
+        handle.remove();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    auto cli = std::make_shared<Utilities::CLIHelper>(argv);
+
+    const auto default_db_path = cli->get_default_db_directory();
+
+    std::string db_path = default_db_path.toNative(), log_path, command, snapshot_path, trusted_checksum;
+
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    bool validate_construction = false, repair = false;
+
+    // clang-format off
+    cli->add_options("Database Tool")
+        ("command", "The command to perform: export, import, verify or check-tallies",
+            cxxopts::value<std::string>(command), "<command>")
+        ("snapshot", "The <file> to write the snapshot to or read the snapshot from",
+            cxxopts::value<std::string>(snapshot_path), "<file>")
+        ("d,db-path", "Specify the <path> to the database directory",
+            cxxopts::value<std::string>(db_path)->default_value(db_path), "<path>")
+        ("trusted-checksum", "The checksum that the snapshot must match to be imported without verifying its blocks",
+            cxxopts::value<std::string>(trusted_checksum), "<hash>")
+        ("threads", "The number of threads used to verify the database",
+            cxxopts::value<size_t>(threads)->default_value(std::to_string(threads)), "#")
+        ("validate-construction", "Also check the construction (and signatures) of every block while verifying",
+            cxxopts::value<bool>(validate_construction)->implicit_value("true"))
+        ("repair", "Replace the stored vote tallies with those counted from the stakes when checking tallies",
+            cxxopts::value<bool>(repair)->implicit_value("true"));
+    // clang-format on
+
+    cli->parse_positional({"command", "snapshot"}, "<export|import|verify|check-tallies> [file]");
+
+    cli->parse(argc, argv);
+
+    cli->argument_load("log-file", log_path);
+
+    auto logger = Logger::create_logger(log_path, cli->log_level());
+
+    if ((command != "export" && command != "import" && command != "verify" && command != "check-tallies")
+        || ((command == "export" || command == "import") && snapshot_path.empty()))
+    {
+        cli->print_help();
+
+        exit(1);
+    }
+
+    const auto blockchain_path = cli->get_db_path(db_path, Configuration::Database::BLOCKCHAIN_DB_NAME).path();
+
+    const auto staking_path = cli->get_db_path(db_path, Configuration::Database::STAKING_DB_NAME).path();
+
+    if (command == "check-tallies")
+    {
+        const auto staking = std::make_shared<Core::StakingEngine>(staking_path);
+
+        logger->info("Counting the votes of every candidate from its stakes...");
+
+        const auto [check_error, mismatches] = staking->check_vote_tallies();
+
+        if (check_error)
+        {
+            logger->error("Could not check vote tallies: {0}", check_error.to_string());
+
+            exit(1);
+        }
+
+        for (const auto &tally : mismatches)
+        {
+            logger->error(
+                "Candidate {0}: stored {1} votes, held {2} votes in memory, counted {3} votes",
+                tally.candidate_key.to_string(),
+                tally.stored_votes,
+                tally.cached_votes,
+                tally.counted_votes);
+        }
+
+        logger->info(
+            "Checked the vote tallies of {0} candidates, {1} do not match their stakes",
+            staking->get_candidate_tallies().size(),
+            mismatches.size());
+
+        if (mismatches.empty())
+        {
+            return 0;
+        }
+
+        if (!repair)
+        {
+            exit(1);
+        }
+
+        const auto repair_error = staking->rebuild_vote_tallies();
+
+        if (repair_error)
+        {
+            logger->error("Could not rebuild vote tallies: {0}", repair_error.to_string());
+
+            exit(1);
+        }
+
+        logger->info("Rebuilt the vote tallies of {0} candidates", staking->get_candidate_tallies().size());
+
+        return 0;
+    }
+
+    if (command == "verify")
+    {
+        const auto storage = std::make_shared<Core::BlockchainStorage>(blockchain_path);
+
+        logger->info("Verifying {0} blocks using {1} threads...", storage->get_block_count(), threads);
+
+        uint64_t reported_percent = 0;
+
+        // progress is reported under the lock of the verification so it needs no locking of its own
+        const auto verify_progress = [&](const Core::verification_info_t &info)
+        {
+            const auto percent = (info.blocks * 100) / std::max<uint64_t>(info.block_count, 1);
+
+            if (percent / 5 != reported_percent / 5)
+            {
+                logger->info("Verified {0} of {1} blocks ({2}%)", info.blocks, info.block_count, percent);
+
+                reported_percent = percent;
+            }
+        };
+
+        const auto verify_start = std::chrono::steady_clock::now();
+
+        const auto info = Core::verify_blockchain(storage, threads, validate_construction, verify_progress);
+
+        const auto verify_elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+                                        std::chrono::steady_clock::now() - verify_start)
+                                        .count();
+
+        for (const auto &[block_index, error] : info.failures)
+        {
+            logger->error("Block {0}: {1}", block_index, error.to_string());
+        }
+
+        logger->info(
+            "Verified {0} blocks, {1} transactions, {2} outputs and {3} key images",
+            info.blocks,
+            info.transactions,
+            info.outputs,
+            info.key_images);
+
+        logger->info(
+            "Completed verify in {0:.2f} seconds ({1:.0f} blocks/s, {2:.0f} transactions/s)",
+            verify_elapsed,
+            double(info.blocks) / std::max(verify_elapsed, 0.001),
+            double(info.transactions) / std::max(verify_elapsed, 0.001));
+
+        if (!info.failures.empty())
+        {
+            logger->error("{0} blocks failed verification", info.failures.size());
+
+            exit(1);
+        }
+
+        return 0;
+    }
+
+    const auto progress = [&](const Core::snapshot_info_t &info)
+    {
+        logger->info(
+            "Checkpoint #{0}: {1} records in {2} tables", info.checkpoints, info.records, info.tables);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    Error error;
+
+    Core::snapshot_info_t info;
+
+    if (command == "export")
+    {
+        // opening the databases through their owners brings older layouts up to date first
+        const auto storage = std::make_shared<Core::BlockchainStorage>(blockchain_path);
+
+        const auto staking = std::make_shared<Core::StakingEngine>(staking_path);
+
+        const Core::snapshot_environments_t environments = {
+            {Configuration::Database::BLOCKCHAIN_DB_NAME, Database::LMDB::getInstance(blockchain_path)},
+            {Configuration::Database::STAKING_DB_NAME, Database::LMDB::getInstance(staking_path)}};
+
+        logger->info("Exporting snapshot to {0}...", snapshot_path);
+
+        std::tie(error, info) = Core::export_snapshot(snapshot_path, environments, progress);
+
+        if (error)
+        {
+            std::remove(snapshot_path.c_str());
+        }
+    }
+    else
+    {
+        std::optional<crypto_hash_t> checksum;
+
+        if (!trusted_checksum.empty())
+        {
+            try
+            {
+                checksum = crypto_hash_t(trusted_checksum);
+            }
+            catch (const std::exception &e)
+            {
+                logger->error("Invalid trusted checksum: {0}", e.what());
+
+                exit(1);
+            }
+        }
+        else
+        {
+            logger->warn("No trusted checksum supplied, every imported block will be verified before it is used");
+        }
+
+        if (cppfs::fs::open(blockchain_path).exists() || cppfs::fs::open(staking_path).exists())
+        {
+            logger->error("Databases already exist in {0}, refusing to import over them", db_path);
+
+            exit(1);
+        }
+
+        // the snapshot is loaded into staging databases that only replace the real ones once fully verified
+        const auto blockchain_staging = blockchain_path + ".importing";
+
+        const auto staking_staging = staking_path + ".importing";
+
+        for (const auto &path : {blockchain_staging, staking_staging, staking_staging + "-lock"})
+        {
+            remove_path(path);
+        }
+
+        auto blockchain_env = Database::LMDB::getInstance(
+            blockchain_staging,
+            0,
+            0600,
+            Configuration::Database::MAP_MINIMUM_INCREMENT / (1024 * 1024),
+            Configuration::Database::MAXIMUM_DATABASES);
+
+        auto staking_env = Database::LMDB::getInstance(staking_staging);
+
+        logger->info("Importing snapshot from {0}...", snapshot_path);
+
+        std::tie(error, info) = Core::import_snapshot(
+            snapshot_path,
+            {{Configuration::Database::BLOCKCHAIN_DB_NAME, blockchain_env},
+             {Configuration::Database::STAKING_DB_NAME, staking_env}},
+            checksum,
+            progress);
+
+        // an untrusted snapshot is only known to be intact, so its blocks are verified before they are installed
+        if (!error && !checksum)
+        {
+            const auto storage = std::make_shared<Core::BlockchainStorage>(blockchain_staging);
+
+            logger->info("Verifying {0} imported blocks using {1} threads...", info.block_count, threads);
+
+            const auto verified = Core::verify_blockchain(storage, threads, validate_construction);
+
+            for (const auto &[block_index, block_error] : verified.failures)
+            {
+                logger->error("Block {0}: {1}", block_index, block_error.to_string());
+            }
+
+            std::tuple<Error, crypto_hash_t> tip_hash = {MAKE_ERROR(SUCCESS), crypto_hash_t()};
+
+            if (info.block_count != 0)
+            {
+                tip_hash = storage->get_block_hash(info.block_count - 1);
+            }
+
+            if (!verified.failures.empty())
+            {
+                error = MAKE_ERROR_MSG(
+                    SNAPSHOT_UNTRUSTED,
+                    std::to_string(verified.failures.size()) + " imported blocks failed verification.");
+            }
+            else if (
+                verified.blocks != info.block_count || std::get<0>(tip_hash) || std::get<1>(tip_hash) != info.tip_hash)
+            {
+                error = MAKE_ERROR_MSG(SNAPSHOT_UNTRUSTED, "Imported blocks do not match the snapshot header.");
+            }
+        }
+
+        blockchain_env->close();
+
+        staking_env->close();
+
+        if (!error)
+        {
+            if (std::rename(blockchain_staging.c_str(), blockchain_path.c_str()) != 0
+                || std::rename(staking_staging.c_str(), staking_path.c_str()) != 0)
+            {
+                logger->error("Could not move the imported databases into {0}", db_path);
+
+                exit(1);
+            }
+
+            remove_path(staking_staging + "-lock");
+        }
+        else
+        {
+            for (const auto &path : {blockchain_staging, staking_staging, staking_staging + "-lock"})
+            {
+                remove_path(path);
+            }
+        }
+    }
+
+    if (error)
+    {
+        logger->error("Could not {0} snapshot: {1}", command, error.to_string());
+
+        exit(1);
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::duration<double>>(
+        std::chrono::steady_clock::now() - start);
+
+    logger->info("Block Count: {0}", info.block_count);
+
+    logger->info("Tip Hash: {0}", info.tip_hash.to_string());
+
+    logger->info("Tables: {0} Records: {1}", info.tables, info.records);
+
+    logger->info("Checksum: {0}", info.checksum.to_string());
+
+    logger->info("Completed {0} in {1:.2f} seconds", command, elapsed.count());
+}
@@ -50,6 +50,20 @@ std::string Error::to_string() const
             return "The operation completed successfully.";
         case DB_EMPTY:
             return "The database is empty";
+        case DB_KEY_IMAGE_FILTER_INVALID:
+            return "The saved key image filter is missing or does not match the database.";
+        case DB_WRITER_STOPPED:
+            return "The block writer has been stopped and is no longer accepting blocks.";
+        case DB_WRITER_PRECEDING_BLOCK_FAILED:
+            return "The block was not stored as a block queued before it could not be stored.";
+        case DB_BLOCK_UNDO_NOT_FOUND:
+            return "The undo record for the block could not be found in the database.";
+        case DB_POP_TOO_MANY_BLOCKS:
+            return "Cannot remove more blocks than are stored in the database.";
+        case DB_VERIFICATION_FAILED:
+            return "The stored block does not match the records derived from it.";
+        case DB_BLOCK_INDEX_NOT_NEXT:
+            return "The block index does not follow the last block stored in the database.";
         case BASE58_DECODE:
             return "Could not decode Base58 string.";
         case ADDRESS_PREFIX_MISMATCH:
@@ -68,6 +82,20 @@ std::string Error::to_string() const
             return "The staking candidate was not found in the database.";
         case STAKING_STAKER_NOT_FOUND:
             return "The staker was not found in the database.";
+        case STAKING_STAKE_NOT_FOUND:
+            return "The stake was not found in the database.";
+        case STAKING_UNDO_NOT_FOUND:
+            return "The staking undo record for the block could not be found in the database.";
+        case STAKING_ROUND_INCOMPLETE:
+            return "The blocks of the round preceding the election have not all been stored.";
+        case SNAPSHOT_INVALID:
+            return "The snapshot file is not recognized or is truncated.";
+        case SNAPSHOT_CHECKSUM_MISMATCH:
+            return "The snapshot data does not match its checksum.";
+        case SNAPSHOT_UNTRUSTED:
+            return "The snapshot checksum does not match the trusted checksum.";
+        case SNAPSHOT_DESTINATION_NOT_EMPTY:
+            return "Snapshots may only be imported into an empty database.";
         default:
             return "The error code supplied does not have a default message. Please create one.";
     }
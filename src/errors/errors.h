@@ -43,6 +43,13 @@ enum ErrorCode
     DB_TRANSACTION_NOT_FOUND,
     DB_GLOBAL_INDEX_OUT_OF_BOUNDS,
     DB_DESERIALIZATION_ERROR,
+    DB_KEY_IMAGE_FILTER_INVALID,
+    DB_WRITER_STOPPED,
+    DB_WRITER_PRECEDING_BLOCK_FAILED,
+    DB_BLOCK_UNDO_NOT_FOUND,
+    DB_POP_TOO_MANY_BLOCKS,
+    DB_VERIFICATION_FAILED,
+    DB_BLOCK_INDEX_NOT_NEXT,
 
     // block error code(s)
     BLOCK_TXN_ORDER,
@@ -54,6 +61,15 @@ enum ErrorCode
     // staking error code(s)
     STAKING_CANDIDATE_NOT_FOUND,
     STAKING_STAKER_NOT_FOUND,
+    STAKING_STAKE_NOT_FOUND,
+    STAKING_UNDO_NOT_FOUND,
+    STAKING_ROUND_INCOMPLETE,
+
+    // snapshot error code(s)
+    SNAPSHOT_INVALID,
+    SNAPSHOT_CHECKSUM_MISMATCH,
+    SNAPSHOT_UNTRUSTED,
+    SNAPSHOT_DESTINATION_NOT_EMPTY,
 
     /**
      * Do not change LMDB values as they map directly to LMDB return codes
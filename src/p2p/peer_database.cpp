@@ -117,19 +117,46 @@ namespace P2P
     {
         std::scoped_lock lock(m_mutex);
 
-        auto peers = m_database->get_all<crypto_hash_t, network_peer_t>();
-
         const auto seed = std::chrono::system_clock::now().time_since_epoch().count();
 
-        // shuffle the peers around that we received using a random iterator
-        std::shuffle(peers.begin(), peers.end(), std::default_random_engine(seed));
+        std::default_random_engine random(seed);
+
+        std::vector<network_peer_t> peers;
 
-        if (count != 0 && peers.size() > count)
+        if (count != 0)
         {
-            peers.resize(count);
+            peers.reserve(count);
         }
 
-        return std::move(peers);
+        auto range = m_database->range<crypto_hash_t, network_peer_t>();
+
+        size_t seen = 0;
+
+        /**
+         * Reservoir sample the peers as we stream them from the database so that only the
+         * peers we return are ever decoded and held in memory
+         */
+        for (auto it = range.begin(); it != range.end(); ++it, ++seen)
+        {
+            if (count == 0 || peers.size() < count)
+            {
+                peers.push_back(it.value());
+
+                continue;
+            }
+
+            const auto slot = std::uniform_int_distribution<size_t>(0, seen)(random);
+
+            if (slot < count)
+            {
+                peers[slot] = it.value();
+            }
+        }
+
+        // the reservoir keeps the peers in database order, so shuffle them around
+        std::shuffle(peers.begin(), peers.end(), random);
+
+        return peers;
     }
 
     void PeerDB::prune()
@@ -0,0 +1,1051 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <benchmark.h>
+#include <block_writer.h>
+#include <blockchain_storage.h>
+#include <chain_verifier.h>
+#include <chrono>
+#include <cli_helper.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/fs.h>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <snapshot.h>
+#include <suffix_archive.h>
+#include <thread>
+
+#define BENCHMARK_DB_PATH "./benchmark_blockchain_storage"
+#define INGEST_OUTPUTS_PER_BLOCK 100
+#define INGEST_TEST_ITERATIONS 100
+#define RING_TEST_ITERATIONS 10
+#define CACHE_TEST_ITERATIONS 1'000
+#define CACHE_TEST_BLOCKS 100
+#define FILTER_TEST_KEYS 100'000
+#define FILTER_TEST_PROBES 100'000
+#define FILTER_TEST_ITERATIONS 1'000'000
+#define SYNC_TEST_BLOCKS 2'000
+#define SYNC_OUTPUTS_PER_BLOCK 10
+#define WRITER_TEST_BLOCKS 500
+#define ARCHIVE_TEST_ITERATIONS 1'000
+#define POP_TEST_ITERATIONS 10
+#define WALLET_SYNC_TRANSACTIONS_PER_BLOCK 10
+#define WALLET_SYNC_OUTPUTS_PER_TRANSACTION 2
+
+using namespace Types::Blockchain;
+
+/**
+ * Builds a block carrying a genesis style reward transaction with the requested number of outputs
+ *
+ * @param block_index
+ * @param output_count
+ * @return
+ */
+static inline block_t make_block(uint64_t block_index, size_t output_count)
+{
+    genesis_transaction_t reward_tx;
+
+    reward_tx.tx_public_key = Crypto::random_point();
+
+    const auto output = transaction_output_t(Crypto::random_point(), 0, Crypto::random_point());
+
+    reward_tx.outputs = std::vector<transaction_output_t>(output_count, output);
+
+    block_t block;
+
+    block.block_index = block_index;
+
+    block.timestamp = Configuration::GENESIS_BLOCK_TIMESTAMP + block_index;
+
+    block.reward_tx = reward_tx;
+
+    return block;
+}
+
+/**
+ * Builds a committed normal transaction spending a random key image into the requested number of outputs
+ *
+ * @param output_count
+ * @return
+ */
+static inline committed_normal_transaction_t make_normal_transaction(size_t output_count)
+{
+    committed_normal_transaction_t transaction;
+
+    transaction.tx_public_key = Crypto::random_point();
+
+    const crypto_key_image_t key_image = Crypto::random_point();
+
+    transaction.key_images.push_back(key_image);
+
+    for (size_t i = 0; i < output_count; ++i)
+    {
+        transaction.outputs.emplace_back(Crypto::random_point(), 0, Crypto::random_point());
+    }
+
+    return transaction;
+}
+
+/**
+ * Builds an uncommitted transaction carrying a suffix with random ring member offsets
+ *
+ * @param generator
+ * @return
+ */
+static inline uncommitted_transaction_t make_uncommitted_transaction(std::mt19937_64 &generator)
+{
+    uncommited_normal_transaction_t transaction;
+
+    for (size_t i = 0; i < Configuration::Transaction::RING_SIZE; ++i)
+    {
+        transaction.offsets.push_back(generator());
+    }
+
+    transaction.signatures.resize(1);
+
+    return transaction;
+}
+
+int main(int argc, char **argv)
+{
+    auto cli = std::make_shared<Utilities::CLIHelper>(argv);
+
+    size_t cache_size = Configuration::Database::DEFAULT_CACHE_SIZE / (1024 * 1024);
+
+    // clang-format off
+    cli->add_options("Benchmark")
+        ("cache-size", "The amount of memory (in MB) used to cache decoded blocks and transactions",
+            cxxopts::value<size_t>(cache_size)->default_value(std::to_string(cache_size)), "#");
+    // clang-format on
+
+    cli->parse(argc, argv);
+
+    auto db_path = cppfs::fs::open(BENCHMARK_DB_PATH);
+
+    db_path.removeDirectoryRec();
+
+    {
+        auto storage = std::make_shared<Core::BlockchainStorage>(BENCHMARK_DB_PATH, cache_size * 1024 * 1024);
+
+        uint64_t block_index = 0, stored_outputs = 0;
+
+        std::cout << "Block ingest time by number of stored outputs" << std::endl << std::endl;
+
+        benchmark_header(40, 25);
+
+        for (const size_t target_outputs : {10'000, 100'000, 1'000'000})
+        {
+            // fill the database until we reach the target number of outputs
+            while (stored_outputs < target_outputs)
+            {
+                const auto error = storage->put_block(make_block(block_index++, INGEST_OUTPUTS_PER_BLOCK), {});
+
+                if (error)
+                {
+                    std::cout << "Could not fill database: " << error << std::endl;
+
+                    exit(1);
+                }
+
+                stored_outputs += INGEST_OUTPUTS_PER_BLOCK;
+            }
+
+            benchmark(
+                [&storage, &block_index, &stored_outputs]()
+                {
+                    [[maybe_unused]] const auto error = storage->put_block(make_block(block_index++, 1), {});
+
+                    stored_outputs++;
+                },
+                "put_block @ " + std::to_string(target_outputs) + " outputs",
+                INGEST_TEST_ITERATIONS,
+                40,
+                25);
+        }
+
+        std::cout << std::endl
+                  << "Ring member fetch for " << Configuration::Transaction::MAXIMUM_INPUTS << " inputs of "
+                  << Configuration::Transaction::RING_SIZE << " ring members" << std::endl
+                  << std::endl;
+
+        std::mt19937_64 generator(0);
+
+        std::uniform_int_distribution<uint64_t> distribution(0, stored_outputs - 1);
+
+        std::vector<std::vector<uint64_t>> rings(Configuration::Transaction::MAXIMUM_INPUTS);
+
+        for (auto &ring : rings)
+        {
+            for (size_t i = 0; i < Configuration::Transaction::RING_SIZE; ++i)
+            {
+                ring.push_back(distribution(generator));
+            }
+        }
+
+        benchmark_header(40, 25);
+
+        benchmark(
+            [&storage, &rings]()
+            {
+                for (const auto &ring : rings)
+                {
+                    for (const auto &global_index : ring)
+                    {
+                        [[maybe_unused]] const auto [error, output] = storage->get_output_by_global_index(global_index);
+                    }
+                }
+            },
+            "get_output_by_global_index",
+            RING_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&storage, &rings]()
+            {
+                for (const auto &ring : rings)
+                {
+                    [[maybe_unused]] const auto [error, outputs] = storage->get_ring_outputs(ring);
+                }
+            },
+            "get_ring_outputs (per ring)",
+            RING_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&storage, &rings]()
+            { [[maybe_unused]] const auto [error, outputs] = storage->get_ring_outputs(rings); },
+            "get_ring_outputs (merged)",
+            RING_TEST_ITERATIONS,
+            40,
+            25);
+
+        std::cout << std::endl << "Recent block reads" << std::endl << std::endl;
+
+        benchmark_header(40, 25);
+
+        uint64_t read_index = 0;
+
+        benchmark(
+            [&storage, &block_index, &read_index]()
+            {
+                [[maybe_unused]] const auto [error, block, transactions] =
+                    storage->get_block(block_index - 1 - (read_index++ % CACHE_TEST_BLOCKS));
+            },
+            "get_block (recent)",
+            CACHE_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&storage, &block_index]()
+            {
+                [[maybe_unused]] const auto [error, hashes] =
+                    storage->get_block_hashes(block_index - CACHE_TEST_BLOCKS, block_index - 1);
+            },
+            "get_block_hashes (range)",
+            CACHE_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&storage, &block_index]()
+            {
+                const auto last_timestamp = Configuration::GENESIS_BLOCK_TIMESTAMP + block_index - 1;
+
+                [[maybe_unused]] const auto [error, indexes] =
+                    storage->get_block_indexes_by_timestamp(last_timestamp - CACHE_TEST_BLOCKS + 1, last_timestamp);
+            },
+            "get_block_indexes_by_timestamp (range)",
+            CACHE_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&storage, &block_index]()
+            {
+                [[maybe_unused]] const auto [error, headers] =
+                    storage->get_block_headers(block_index - CACHE_TEST_BLOCKS, block_index - 1);
+            },
+            "get_block_headers (recent range)",
+            CACHE_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&storage]()
+            {
+                [[maybe_unused]] const auto [error, headers] = storage->get_block_headers(0, CACHE_TEST_BLOCKS - 1);
+            },
+            "get_block_headers (oldest range)",
+            CACHE_TEST_ITERATIONS,
+            40,
+            25);
+
+        {
+            const auto [error, tip_hash] = storage->get_block_hash(block_index - 1);
+
+            benchmark(
+                [&storage, &tip_hash = tip_hash]()
+                { [[maybe_unused]] const auto [index_error, index] = storage->get_block_index(tip_hash); },
+                "get_block_index (by hash)",
+                CACHE_TEST_ITERATIONS,
+                40,
+                25);
+        }
+
+        const auto block_stats = storage->block_cache_stats();
+
+        const auto txn_stats = storage->transaction_cache_stats();
+
+        std::cout << std::endl
+                  << "Block cache: " << block_stats.hits << " hits, " << block_stats.misses << " misses, "
+                  << block_stats.evictions << " evictions, " << block_stats.entries << " entries, "
+                  << block_stats.bytes << "/" << block_stats.capacity << " bytes" << std::endl;
+
+        std::cout << "Transaction cache: " << txn_stats.hits << " hits, " << txn_stats.misses << " misses, "
+                  << txn_stats.evictions << " evictions, " << txn_stats.entries << " entries, " << txn_stats.bytes
+                  << "/" << txn_stats.capacity << " bytes" << std::endl;
+    }
+
+    db_path.removeDirectoryRec();
+
+    std::cout << std::endl << "Bulk import throughput by blocks per write transaction" << std::endl << std::endl;
+
+    for (const size_t batch_size : {1, 10, 100, 1'000})
+    {
+        // LMDB environments are cached by path, so each run needs its own database
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_" + std::to_string(batch_size);
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+        std::vector<std::pair<block_t, std::vector<transaction_t>>> blocks;
+
+        blocks.reserve(SYNC_TEST_BLOCKS);
+
+        for (uint64_t block_index = 0; block_index < SYNC_TEST_BLOCKS; ++block_index)
+        {
+            blocks.emplace_back(make_block(block_index, SYNC_OUTPUTS_PER_BLOCK), std::vector<transaction_t>());
+        }
+
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        const auto error = storage->put_blocks(blocks, batch_size);
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::high_resolution_clock::now() - start)
+                                 .count();
+
+        if (error)
+        {
+            std::cout << "Could not import blocks: " << error << std::endl;
+
+            exit(1);
+        }
+
+        std::cout << std::setw(40) << std::left << "put_blocks @ " + std::to_string(batch_size) + " blocks/txn"
+                  << std::setw(25) << std::right
+                  << std::to_string(uint64_t(double(SYNC_TEST_BLOCKS) / (double(elapsed) / 1'000'000.0)))
+                         + " blocks/s"
+                  << std::endl;
+
+        const auto growth_stats = storage->map_growth_stats();
+
+        std::cout << std::setw(40) << std::left << "  memory map growth" << std::setw(25) << std::right
+                  << std::to_string(growth_stats.expansions) + " expansions, "
+                         + std::to_string(growth_stats.retried_transactions) + " retries"
+                  << std::endl;
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl << "Block persistence throughput by durability mode" << std::endl << std::endl;
+
+    size_t run = 0;
+
+    for (const auto &[label, durability] :
+         {std::make_pair("put_block (synchronous)", Core::DURABILITY_SYNC),
+          std::make_pair("BlockWriter (sync)", Core::DURABILITY_SYNC),
+          std::make_pair("BlockWriter (interval)", Core::DURABILITY_INTERVAL),
+          std::make_pair("BlockWriter (nosync)", Core::DURABILITY_NOSYNC)})
+    {
+        const auto asynchronous = std::string(label) != "put_block (synchronous)";
+
+        // LMDB environments are cached by path, so each run needs its own database
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_writer_" + std::to_string(run++);
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+        std::vector<block_t> blocks;
+
+        for (uint64_t block_index = 0; block_index < WRITER_TEST_BLOCKS; ++block_index)
+        {
+            blocks.push_back(make_block(block_index, SYNC_OUTPUTS_PER_BLOCK));
+        }
+
+        size_t commits = WRITER_TEST_BLOCKS;
+
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        if (asynchronous)
+        {
+            Core::BlockWriter writer(storage, durability);
+
+            std::vector<std::future<Error>> results;
+
+            for (auto &block : blocks)
+            {
+                results.push_back(writer.enqueue(std::move(block), {}));
+            }
+
+            for (auto &result : results)
+            {
+                const auto error = result.get();
+
+                if (error)
+                {
+                    std::cout << "Could not write block: " << error << std::endl;
+
+                    exit(1);
+                }
+            }
+
+            commits = writer.stats().commits;
+        }
+        else
+        {
+            for (const auto &block : blocks)
+            {
+                const auto error = storage->put_block(block, {});
+
+                if (error)
+                {
+                    std::cout << "Could not write block: " << error << std::endl;
+
+                    exit(1);
+                }
+            }
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::high_resolution_clock::now() - start)
+                                 .count();
+
+        std::cout << std::setw(40) << std::left << label << std::setw(25) << std::right
+                  << std::to_string(uint64_t(double(WRITER_TEST_BLOCKS) / (double(elapsed) / 1'000'000.0)))
+                         + " blocks/s"
+                  << std::setw(25) << std::right << std::to_string(commits) + " commits" << std::endl;
+
+        storage.reset();
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl << "Block ingest time while archiving transaction suffixes" << std::endl << std::endl;
+
+    benchmark_header(40, 25);
+
+    for (const bool archived : {false, true})
+    {
+        // LMDB environments are cached by path, so each run needs its own database
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + ((archived) ? "_archived" : "_unarchived");
+
+        const auto archive_path = run_path + "_suffixes";
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        auto archive_db_path = cppfs::fs::open(archive_path);
+
+        run_db_path.removeDirectoryRec();
+
+        archive_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+        std::unique_ptr<Core::SuffixArchive> archive;
+
+        std::atomic<bool> feeding(archived);
+
+        std::thread feeder;
+
+        // stands in for the transaction pool handing every verified transaction to the archive
+        if (archived)
+        {
+            archive = std::make_unique<Core::SuffixArchive>(archive_path);
+
+            feeder = std::thread(
+                [&archive, &feeding]()
+                {
+                    std::mt19937_64 generator(0);
+
+                    while (feeding)
+                    {
+                        archive->archive(make_uncommitted_transaction(generator));
+                    }
+                });
+        }
+
+        uint64_t block_index = 0;
+
+        benchmark(
+            [&storage, &block_index]()
+            {
+                [[maybe_unused]] const auto error =
+                    storage->put_block(make_block(block_index++, SYNC_OUTPUTS_PER_BLOCK), {});
+            },
+            (archived) ? "put_block (archive enabled)" : "put_block (archive disabled)",
+            ARCHIVE_TEST_ITERATIONS,
+            40,
+            25);
+
+        if (archived)
+        {
+            feeding = false;
+
+            feeder.join();
+
+            archive->stop();
+
+            const auto stats = archive->stats();
+
+            std::cout << std::setw(40) << std::left << "  suffixes archived" << std::setw(25) << std::right
+                      << std::to_string(stats.archived) + " in " + std::to_string(stats.commits) + " commits"
+                      << std::endl;
+
+            archive.reset();
+        }
+
+        storage.reset();
+
+        run_db_path.removeDirectoryRec();
+
+        archive_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl << "Bootstrap from snapshot versus block replay" << std::endl << std::endl;
+
+    {
+        const auto source_path = std::string(BENCHMARK_DB_PATH) + "_snapshot_source";
+
+        const auto target_path = std::string(BENCHMARK_DB_PATH) + "_snapshot_target";
+
+        const auto snapshot_path = std::string(BENCHMARK_DB_PATH) + ".snapshot";
+
+        auto source_db_path = cppfs::fs::open(source_path);
+
+        auto target_db_path = cppfs::fs::open(target_path);
+
+        source_db_path.removeDirectoryRec();
+
+        target_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(source_path, cache_size * 1024 * 1024);
+
+        std::vector<std::pair<block_t, std::vector<transaction_t>>> blocks;
+
+        blocks.reserve(SYNC_TEST_BLOCKS);
+
+        for (uint64_t block_index = 0; block_index < SYNC_TEST_BLOCKS; ++block_index)
+        {
+            blocks.emplace_back(make_block(block_index, SYNC_OUTPUTS_PER_BLOCK), std::vector<transaction_t>());
+        }
+
+        const auto report = [](const std::string &label, const std::chrono::high_resolution_clock::time_point &start)
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count();
+
+            std::cout << std::setw(40) << std::left << label << std::setw(25) << std::right
+                      << std::to_string(uint64_t(double(SYNC_TEST_BLOCKS) / (double(elapsed) / 1'000'000.0)))
+                             + " blocks/s"
+                      << std::endl;
+        };
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        {
+            const auto error = storage->put_blocks(blocks);
+
+            if (error)
+            {
+                std::cout << "Could not import blocks: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        report("block replay (put_blocks)", start);
+
+        start = std::chrono::high_resolution_clock::now();
+
+        const auto [export_error, exported] = Core::export_snapshot(
+            snapshot_path, {{"blockchain", Database::LMDB::getInstance(source_path)}});
+
+        if (export_error)
+        {
+            std::cout << "Could not export snapshot: " << export_error << std::endl;
+
+            exit(1);
+        }
+
+        report("snapshot export", start);
+
+        auto target_env = Database::LMDB::getInstance(
+            target_path,
+            0,
+            0600,
+            Configuration::Database::MAP_MINIMUM_INCREMENT / (1024 * 1024),
+            Configuration::Database::MAXIMUM_DATABASES);
+
+        start = std::chrono::high_resolution_clock::now();
+
+        const auto [import_error, imported] =
+            Core::import_snapshot(snapshot_path, {{"blockchain", target_env}}, exported.checksum);
+
+        if (import_error)
+        {
+            std::cout << "Could not import snapshot: " << import_error << std::endl;
+
+            exit(1);
+        }
+
+        report("snapshot import (trusted)", start);
+
+        if (imported.block_count != SYNC_TEST_BLOCKS || imported.records != exported.records)
+        {
+            std::cout << "Imported snapshot does not match the exported database" << std::endl;
+
+            exit(1);
+        }
+
+        target_env->close();
+
+        std::remove(snapshot_path.c_str());
+
+        source_db_path.removeDirectoryRec();
+
+        target_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl << "Block removal by number of blocks popped" << std::endl << std::endl;
+
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_pop";
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+        std::vector<std::pair<block_t, std::vector<transaction_t>>> blocks;
+
+        blocks.reserve(SYNC_TEST_BLOCKS);
+
+        for (uint64_t block_index = 0; block_index < SYNC_TEST_BLOCKS; ++block_index)
+        {
+            blocks.emplace_back(make_block(block_index, SYNC_OUTPUTS_PER_BLOCK), std::vector<transaction_t>());
+        }
+
+        {
+            const auto error = storage->put_blocks(blocks);
+
+            if (error)
+            {
+                std::cout << "Could not import blocks: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        for (const size_t count : {1, 10, 100})
+        {
+            const auto popped =
+                std::vector<std::pair<block_t, std::vector<transaction_t>>>(blocks.end() - count, blocks.end());
+
+            uint64_t elapsed = 0;
+
+            for (size_t i = 0; i < POP_TEST_ITERATIONS; ++i)
+            {
+                const auto start = std::chrono::high_resolution_clock::now();
+
+                const auto error = storage->pop_blocks(count);
+
+                elapsed += std::chrono::duration_cast<std::chrono::microseconds>(
+                               std::chrono::high_resolution_clock::now() - start)
+                               .count();
+
+                if (error)
+                {
+                    std::cout << "Could not pop blocks: " << error << std::endl;
+
+                    exit(1);
+                }
+
+                // put the blocks back so that every iteration pops from the same chain
+                const auto put_error = storage->put_blocks(popped);
+
+                if (put_error)
+                {
+                    std::cout << "Could not restore blocks: " << put_error << std::endl;
+
+                    exit(1);
+                }
+            }
+
+            std::cout << std::setw(40) << std::left << "pop_blocks(" + std::to_string(count) + ")" << std::setw(25)
+                      << std::right << std::to_string(elapsed / POP_TEST_ITERATIONS) + " us" << std::endl;
+        }
+
+        if (storage->get_block_count() != SYNC_TEST_BLOCKS)
+        {
+            std::cout << "Block count does not match after popping and restoring blocks" << std::endl;
+
+            exit(1);
+        }
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl << "Chain verification throughput by number of threads" << std::endl << std::endl;
+
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_verify";
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+        std::vector<std::pair<block_t, std::vector<transaction_t>>> blocks;
+
+        blocks.reserve(SYNC_TEST_BLOCKS);
+
+        // the blocks are linked as verification checks that every block follows the one before it
+        for (uint64_t block_index = 0; block_index < SYNC_TEST_BLOCKS; ++block_index)
+        {
+            auto block = make_block(block_index, SYNC_OUTPUTS_PER_BLOCK);
+
+            if (!blocks.empty())
+            {
+                block.previous_blockhash = blocks.back().first.hash();
+            }
+
+            blocks.emplace_back(block, std::vector<transaction_t>());
+        }
+
+        {
+            const auto error = storage->put_blocks(blocks);
+
+            if (error)
+            {
+                std::cout << "Could not import blocks: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (const size_t threads : {size_t(1), size_t(2), size_t(4), cores})
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            const auto info = Core::verify_blockchain(storage, threads);
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count();
+
+            if (info.blocks != SYNC_TEST_BLOCKS || !info.failures.empty())
+            {
+                std::cout << "Verification failed for " << info.failures.size() << " blocks" << std::endl;
+
+                exit(1);
+            }
+
+            std::cout << std::setw(40) << std::left << std::to_string(threads) + " threads" << std::setw(25)
+                      << std::right
+                      << std::to_string(uint64_t(double(info.blocks) / (double(elapsed) / 1'000'000.0))) + " blocks/s"
+                      << std::endl;
+        }
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl
+              << "Wallet sync of " << SYNC_TEST_BLOCKS << " blocks of " << WALLET_SYNC_TRANSACTIONS_PER_BLOCK
+              << " transactions" << std::endl
+              << std::endl;
+
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_wallet_sync";
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        std::vector<std::pair<block_t, std::vector<transaction_t>>> blocks;
+
+        blocks.reserve(SYNC_TEST_BLOCKS);
+
+        size_t expected_outputs = 0;
+
+        for (uint64_t block_index = 0; block_index < SYNC_TEST_BLOCKS; ++block_index)
+        {
+            auto block = make_block(block_index, SYNC_OUTPUTS_PER_BLOCK);
+
+            std::vector<transaction_t> transactions;
+
+            for (size_t i = 0; i < WALLET_SYNC_TRANSACTIONS_PER_BLOCK; ++i)
+            {
+                const auto transaction = make_normal_transaction(WALLET_SYNC_OUTPUTS_PER_TRANSACTION);
+
+                block.transactions.push_back(transaction.hash());
+
+                transactions.emplace_back(transaction);
+            }
+
+            expected_outputs +=
+                SYNC_OUTPUTS_PER_BLOCK + WALLET_SYNC_TRANSACTIONS_PER_BLOCK * WALLET_SYNC_OUTPUTS_PER_TRANSACTION;
+
+            blocks.emplace_back(block, transactions);
+        }
+
+        {
+            auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+            const auto error = storage->put_blocks(blocks);
+
+            if (error)
+            {
+                std::cout << "Could not import blocks: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        // each method starts from a fresh instance so that neither is served from the caches filled by the import
+        const auto run = [&run_path, &cache_size, &expected_outputs](const std::string &name, const auto &method)
+        {
+            auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            const auto outputs = method(storage);
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count();
+
+            if (outputs != expected_outputs)
+            {
+                std::cout << name << " returned " << outputs << " of " << expected_outputs << " outputs" << std::endl;
+
+                exit(1);
+            }
+
+            std::cout << std::setw(40) << std::left << name << std::setw(25) << std::right
+                      << std::to_string(uint64_t(double(SYNC_TEST_BLOCKS) / (double(elapsed) / 1'000'000.0)))
+                             + " blocks/s"
+                      << std::endl;
+        };
+
+        run(
+            "get_block + get_transaction_indexes",
+            [](const std::shared_ptr<Core::BlockchainStorage> &storage)
+            {
+                size_t outputs = 0;
+
+                for (uint64_t block_index = 0; block_index < SYNC_TEST_BLOCKS; ++block_index)
+                {
+                    [[maybe_unused]] const auto [error, block, transactions] = storage->get_block(block_index);
+
+                    auto transaction_hashes = block.transactions;
+
+                    transaction_hashes.push_back(std::visit([](auto &&arg) { return arg.hash(); }, block.reward_tx));
+
+                    for (const auto &txn_hash : transaction_hashes)
+                    {
+                        [[maybe_unused]] const auto [index_error, indexes] = storage->get_transaction_indexes(txn_hash);
+
+                        outputs += indexes.size();
+                    }
+                }
+
+                return outputs;
+            });
+
+        run(
+            "get_wallet_sync_data",
+            [](const std::shared_ptr<Core::BlockchainStorage> &storage)
+            {
+                size_t outputs = 0;
+
+                uint64_t block_index = 0;
+
+                while (block_index < SYNC_TEST_BLOCKS)
+                {
+                    const auto [error, records] =
+                        storage->get_wallet_sync_data(block_index, SYNC_TEST_BLOCKS - block_index);
+
+                    if (error || records.empty())
+                    {
+                        break;
+                    }
+
+                    for (const auto &record : records)
+                    {
+                        for (const auto &transaction : record.transactions)
+                        {
+                            outputs += transaction.outputs.size();
+                        }
+                    }
+
+                    block_index = records.back().block_index + 1;
+                }
+
+                return outputs;
+            });
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_dictionary";
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        std::vector<std::pair<block_t, std::vector<transaction_t>>> blocks;
+
+        std::vector<crypto_hash_t> transaction_hashes;
+
+        for (uint64_t block_index = 0; block_index < CACHE_TEST_BLOCKS; ++block_index)
+        {
+            auto block = make_block(block_index, 1);
+
+            std::vector<transaction_t> transactions;
+
+            for (size_t i = 0; i < WALLET_SYNC_TRANSACTIONS_PER_BLOCK; ++i)
+            {
+                const auto transaction = make_normal_transaction(WALLET_SYNC_OUTPUTS_PER_TRANSACTION);
+
+                block.transactions.push_back(transaction.hash());
+
+                transaction_hashes.push_back(transaction.hash());
+
+                transactions.emplace_back(transaction);
+            }
+
+            blocks.emplace_back(block, transactions);
+        }
+
+        // the transactions stored before the first dictionary is trained are tagged with the empty dictionary
+        {
+            auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+            auto error = storage->put_blocks(blocks);
+
+            if (!error)
+            {
+                error = storage->train_transaction_dictionary();
+            }
+
+            if (error)
+            {
+                std::cout << "Could not store transactions and train a dictionary: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        // close the environment so that the storage is reopened exactly as it would be after a restart
+        Database::LMDB::getInstance(run_path)->close();
+
+        {
+            auto storage = std::make_shared<Core::BlockchainStorage>(run_path, cache_size * 1024 * 1024);
+
+            for (const auto &txn_hash : transaction_hashes)
+            {
+                const auto [error, transaction, block_hash] = storage->get_transaction(txn_hash);
+
+                if (error)
+                {
+                    std::cout << "Could not read a transaction stored before training after reopening: " << error
+                              << std::endl;
+
+                    exit(1);
+                }
+            }
+        }
+
+        Database::LMDB::getInstance(run_path)->close();
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    std::cout << std::endl << "Key image filter" << std::endl << std::endl;
+
+    {
+        Core::KeyImageFilter filter(FILTER_TEST_KEYS);
+
+        for (size_t i = 0; i < FILTER_TEST_KEYS; ++i)
+        {
+            const crypto_key_image_t key_image = Crypto::random_point();
+
+            filter.insert(key_image);
+        }
+
+        std::vector<crypto_key_image_t> probes;
+
+        probes.reserve(FILTER_TEST_PROBES);
+
+        size_t false_positives = 0;
+
+        // none of these key images were inserted so every positive answer is a false positive
+        for (size_t i = 0; i < FILTER_TEST_PROBES; ++i)
+        {
+            const crypto_key_image_t key_image = Crypto::random_point();
+
+            if (filter.contains(key_image))
+            {
+                false_positives++;
+            }
+
+            probes.push_back(key_image);
+        }
+
+        std::cout << std::setw(40) << std::left << "False positive rate" << std::setw(25) << std::right
+                  << std::to_string(double(false_positives) * 100.0 / double(FILTER_TEST_PROBES)) + "%" << std::endl
+                  << std::endl;
+
+        benchmark_header(40, 25);
+
+        size_t probe_index = 0;
+
+        benchmark(
+            [&filter, &probes, &probe_index]()
+            { [[maybe_unused]] const auto found = filter.contains(probes[probe_index++ % probes.size()]); },
+            "KeyImageFilter::contains",
+            FILTER_TEST_ITERATIONS,
+            40,
+            25);
+    }
+
+    return 0;
+}
@@ -0,0 +1,431 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <atomic>
+#include <benchmark.h>
+#include <chrono>
+#include <cli_helper.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/fs.h>
+#include <cstdlib>
+#include <db_lmdb.h>
+#include <iomanip>
+#include <new>
+#include <thread>
+#include <types.h>
+
+#define BENCHMARK_DB_PATH "./benchmark_db_lmdb"
+#define READ_TEST_KEYS 1'000
+#define READ_TEST_ITERATIONS 10'000
+#define SCAN_TEST_ITERATIONS 100
+#define THREADED_READ_TEST_ITERATIONS 100'000
+#define WRITE_TEST_KEYS 1'000'000
+#define WRITE_TEST_KEYS_PER_TRANSACTION 10'000
+#define COMPRESSION_TEST_TRANSACTIONS 100'000
+#define COMPRESSION_READ_ITERATIONS 100'000
+
+using namespace Types::Blockchain;
+
+static std::atomic<size_t> allocation_count(0);
+
+/**
+ * Every heap allocation in this program is counted so that we can report
+ * how many allocations each read path performs
+ */
+void *operator new(size_t size)
+{
+    allocation_count++;
+
+    if (auto ptr = std::malloc(size))
+    {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+/**
+ * Runs the function the specified number of times and returns the average number
+ * of heap allocations performed per call
+ *
+ * @tparam T
+ * @param function
+ * @param iterations
+ * @return
+ */
+template<typename T> static inline double allocations_per_call(T function, size_t iterations)
+{
+    const size_t start = allocation_count;
+
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        function();
+    }
+
+    return double(allocation_count - start) / double(iterations);
+}
+
+/**
+ * Builds a committed transaction with the shape of a typical two input, two output transfer
+ *
+ * @param nonce
+ * @return
+ */
+static inline committed_normal_transaction_t make_transaction(uint64_t nonce)
+{
+    committed_normal_transaction_t transaction;
+
+    transaction.tx_public_key = Crypto::random_point();
+
+    transaction.nonce = nonce;
+
+    transaction.fee = Configuration::Transaction::Fees::MINIMUM_FEE;
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        transaction.key_images.push_back(Crypto::random_point());
+
+        transaction.outputs.push_back(transaction_output_t(Crypto::random_point(), 0, Crypto::random_point()));
+    }
+
+    transaction.pruning_hash = Crypto::random_hash();
+
+    return transaction;
+}
+
+int main(int argc, char **argv)
+{
+    auto cli = std::make_shared<Utilities::CLIHelper>(argv);
+
+    cli->parse(argc, argv);
+
+    auto db_path = cppfs::fs::open(BENCHMARK_DB_PATH);
+
+    db_path.removeDirectoryRec();
+
+    auto env = Database::LMDB::getInstance(BENCHMARK_DB_PATH, MDB_NOSYNC);
+
+    auto db = env->open_database("outputs");
+
+    std::vector<crypto_hash_t> keys;
+
+    // fill the database with outputs stored under random keys
+    for (size_t i = 0; i < READ_TEST_KEYS; ++i)
+    {
+        const auto key = Crypto::random_hash();
+
+        const auto output = transaction_output_t(Crypto::random_point(), i, Crypto::random_point());
+
+        const auto error = db->put(key, output.serialize());
+
+        if (error)
+        {
+            std::cout << "Could not fill database: " << error << std::endl;
+
+            exit(1);
+        }
+
+        keys.push_back(key);
+    }
+
+    auto txn = db->transaction(true);
+
+    size_t key_index = 0;
+
+    // the read path used before views: the value is copied into a vector and then decoded
+    const auto copy_read = [&txn, &keys, &key_index]()
+    {
+        const auto [error, data] = txn->get(keys[key_index++ % keys.size()]);
+
+        [[maybe_unused]] const auto output = transaction_output_t(data);
+    };
+
+    // the typed read path that decodes directly from a view of the memory map
+    const auto view_read = [&txn, &keys, &key_index]()
+    {
+        [[maybe_unused]] const auto [error, output] =
+            txn->get<crypto_hash_t, transaction_output_t>(keys[key_index++ % keys.size()]);
+    };
+
+    std::cout << "Output read allocations per call" << std::endl << std::endl;
+
+    std::cout << std::setw(40) << std::left << "get (copy)" << std::setw(25) << std::right
+              << allocations_per_call(copy_read, READ_TEST_ITERATIONS) << std::endl;
+
+    std::cout << std::setw(40) << std::left << "get (view)" << std::setw(25) << std::right
+              << allocations_per_call(view_read, READ_TEST_ITERATIONS) << std::endl
+              << std::endl;
+
+    benchmark_header(40, 25);
+
+    benchmark(copy_read, "get (copy)", READ_TEST_ITERATIONS, 40, 25);
+
+    benchmark(view_read, "get (view)", READ_TEST_ITERATIONS, 40, 25);
+
+    txn->abort();
+
+    // the whole table is decoded into a vector before the caller sees the first output
+    const auto vector_scan = [&db]()
+    { [[maybe_unused]] const auto outputs = db->get_all<crypto_hash_t, transaction_output_t>(); };
+
+    // each output is decoded as the cursor reaches it and then discarded
+    const auto range_scan = [&db]()
+    {
+        auto outputs = db->range<crypto_hash_t, transaction_output_t>();
+
+        for (auto it = outputs.begin(); it != outputs.end(); ++it)
+        {
+            [[maybe_unused]] const auto output = it.value();
+        }
+    };
+
+    std::cout << std::endl << "Full table scan allocations per call" << std::endl << std::endl;
+
+    std::cout << std::setw(40) << std::left << "get_all" << std::setw(25) << std::right
+              << allocations_per_call(vector_scan, SCAN_TEST_ITERATIONS) << std::endl;
+
+    std::cout << std::setw(40) << std::left << "range" << std::setw(25) << std::right
+              << allocations_per_call(range_scan, SCAN_TEST_ITERATIONS) << std::endl
+              << std::endl;
+
+    benchmark_header(40, 25);
+
+    benchmark(vector_scan, "get_all", SCAN_TEST_ITERATIONS, 40, 25);
+
+    benchmark(range_scan, "range", SCAN_TEST_ITERATIONS, 40, 25);
+
+    std::cout << std::endl << "Concurrent point reads by number of threads" << std::endl << std::endl;
+
+    for (const bool pooled : {false, true})
+    {
+        env->set_read_transaction_pool_size((pooled) ? 4 : 0);
+
+        for (const size_t thread_count : {1, 2, 4, 8, 16})
+        {
+            std::vector<std::thread> threads;
+
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            for (size_t i = 0; i < thread_count; ++i)
+            {
+                threads.emplace_back(
+                    [&db, &keys, i]()
+                    {
+                        for (size_t j = 0; j < THREADED_READ_TEST_ITERATIONS; ++j)
+                        {
+                            [[maybe_unused]] const auto [error, output] =
+                                db->get<crypto_hash_t, transaction_output_t>(keys[(i + j) % keys.size()]);
+                        }
+                    });
+            }
+
+            for (auto &thread : threads)
+            {
+                thread.join();
+            }
+
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count();
+
+            const auto reads = double(thread_count * THREADED_READ_TEST_ITERATIONS);
+
+            const auto label = std::string((pooled) ? "get (pooled txn)" : "get (new txn)") + " @ "
+                               + std::to_string(thread_count) + " threads";
+
+            std::cout << std::setw(40) << std::left << label << std::setw(25) << std::right
+                      << std::to_string(uint64_t(reads / (double(elapsed) / 1'000'000.0))) + " reads/s"
+                      << std::endl;
+        }
+    }
+
+    env->close();
+
+    db_path.removeDirectoryRec();
+
+    std::cout << std::endl
+              << "Sequential output writes (" << WRITE_TEST_KEYS << " records)" << std::endl
+              << std::endl;
+
+    const auto output = transaction_output_t(Crypto::random_point(), 0, Crypto::random_point()).serialize_output();
+
+    for (const bool sequential : {false, true})
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + ((sequential) ? "_sequential" : "_bytes");
+
+        cppfs::fs::open(run_path).remove();
+
+        // a large growth factor keeps map expansion out of the measurement
+        auto run_env = Database::LMDB::getInstance(run_path, MDB_NOSUBDIR | MDB_NOSYNC, 0600, 512);
+
+        auto run_db = (sequential) ? run_env->open_sequential_database("outputs") : run_env->open_database("outputs");
+
+        const auto start = std::chrono::high_resolution_clock::now();
+
+        for (uint64_t index = 0; index < WRITE_TEST_KEYS;)
+        {
+            auto write_txn = run_db->transaction();
+
+            for (size_t i = 0; i < WRITE_TEST_KEYS_PER_TRANSACTION; ++i, ++index)
+            {
+                const auto error = (sequential) ? write_txn->append(index, output) : write_txn->put(index, output);
+
+                if (error)
+                {
+                    std::cout << "Could not write outputs: " << error << std::endl;
+
+                    exit(1);
+                }
+            }
+
+            const auto error = write_txn->commit();
+
+            if (error)
+            {
+                std::cout << "Could not commit outputs: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 std::chrono::high_resolution_clock::now() - start)
+                                 .count();
+
+        run_env->close();
+
+        const auto label = std::string((sequential) ? "append (integer keys)" : "put (byte keys)");
+
+        std::cout << std::setw(40) << std::left << label << std::setw(25) << std::right
+                  << std::to_string(uint64_t(double(WRITE_TEST_KEYS) / (double(elapsed) / 1'000'000.0)))
+                         + " records/s"
+                  << std::setw(25) << std::right
+                  << std::to_string(cppfs::fs::open(run_path).size() / (1024 * 1024)) + " MB" << std::endl;
+
+        cppfs::fs::open(run_path).remove();
+
+        cppfs::fs::open(run_path + "-lock").remove();
+    }
+
+    std::cout << std::endl
+              << "Transaction reads by value format (" << COMPRESSION_TEST_TRANSACTIONS << " transactions)"
+              << std::endl
+              << std::endl;
+
+    std::vector<crypto_hash_t> transaction_hashes;
+
+    std::vector<std::vector<uint8_t>> transactions;
+
+    for (size_t i = 0; i < COMPRESSION_TEST_TRANSACTIONS; ++i)
+    {
+        const auto transaction = make_transaction(i);
+
+        transaction_hashes.push_back(transaction.hash());
+
+        transactions.push_back(transaction.serialize());
+    }
+
+    std::vector<std::tuple<std::string, size_t>> sizes;
+
+    benchmark_header(40, 25);
+
+    for (const bool compressed : {false, true})
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + ((compressed) ? "_compressed" : "_raw");
+
+        cppfs::fs::open(run_path).remove();
+
+        auto run_env = Database::LMDB::getInstance(run_path, MDB_NOSUBDIR | MDB_NOSYNC, 0600, 512);
+
+        auto run_db = run_env->open_database("transactions");
+
+        if (compressed)
+        {
+            const auto samples = std::vector<std::vector<uint8_t>>(
+                transactions.begin(),
+                transactions.begin()
+                    + std::min(transactions.size(), Configuration::Database::COMPRESSION_TRAINING_SAMPLES));
+
+            const auto error = run_db->set_compression(Database::CompressionDictionary::train(
+                1, samples, Configuration::Database::COMPRESSION_DICTIONARY_SIZE));
+
+            if (error)
+            {
+                std::cout << "Could not enable compression: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        {
+            auto write_txn = run_db->transaction();
+
+            for (size_t i = 0; i < transactions.size(); ++i)
+            {
+                const auto error = write_txn->put(transaction_hashes[i], transactions[i]);
+
+                if (error)
+                {
+                    std::cout << "Could not write transactions: " << error << std::endl;
+
+                    exit(1);
+                }
+            }
+
+            const auto error = write_txn->commit();
+
+            if (error)
+            {
+                std::cout << "Could not commit transactions: " << error << std::endl;
+
+                exit(1);
+            }
+        }
+
+        auto read_txn = run_db->transaction(true);
+
+        size_t transaction_index = 0;
+
+        const auto transaction_read = [&read_txn, &transaction_hashes, &transaction_index]()
+        {
+            [[maybe_unused]] const auto [error, transaction] =
+                read_txn->get<crypto_hash_t, committed_normal_transaction_t>(
+                    transaction_hashes[(transaction_index++ * 7'919) % transaction_hashes.size()]);
+        };
+
+        const auto label = std::string((compressed) ? "get (dictionary compressed)" : "get (raw)");
+
+        benchmark(transaction_read, label, COMPRESSION_READ_ITERATIONS, 40, 25);
+
+        read_txn->abort();
+
+        run_env->close();
+
+        sizes.emplace_back(label, cppfs::fs::open(run_path).size());
+
+        cppfs::fs::open(run_path).remove();
+
+        cppfs::fs::open(run_path + "-lock").remove();
+    }
+
+    std::cout << std::endl << "Transaction storage size by value format" << std::endl << std::endl;
+
+    for (const auto &[label, size] : sizes)
+    {
+        std::cout << std::setw(40) << std::left << label << std::setw(25) << std::right
+                  << std::to_string(size / 1024) + " KB" << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,540 @@
+// Copyright (c) 2021, The TurtleCoin Developers
+//
+// Please see the included LICENSE file for more information.
+
+#include <algorithm>
+#include <benchmark.h>
+#include <chrono>
+#include <cli_helper.h>
+#include <cppfs/FileHandle.h>
+#include <cppfs/fs.h>
+#include <election_scheduler.h>
+#include <iomanip>
+#include <merkle_frontier.h>
+#include <staking_engine.h>
+
+#define BENCHMARK_DB_PATH "./benchmark_staking_engine"
+#define STAKE_TEST_CANDIDATES 100
+#define STAKE_TEST_STAKERS 100'000
+#define SCAN_TEST_ITERATIONS 10
+#define INDEX_TEST_ITERATIONS 10'000
+#define ELECTION_TEST_ITERATIONS 100
+#define LOOKUP_TEST_ITERATIONS 1'000'000
+#define FRONTIER_TEST_MAXIMUM_LEAVES 1'024
+#define FRONTIER_TEST_ITERATIONS 1'000
+#define BLOCK_TEST_BLOCKS 10
+#define BLOCK_TEST_STAKES 100
+
+using namespace Types::Staking;
+
+/**
+ * Builds a committed stake transaction placing a stake from a new staker with the candidate
+ *
+ * @param candidate_key
+ * @param amount
+ * @return
+ */
+static inline Types::Blockchain::committed_stake_transaction_t
+    make_stake_transaction(const crypto_public_key_t &candidate_key, uint64_t amount)
+{
+    Types::Blockchain::committed_stake_transaction_t transaction;
+
+    transaction.tx_public_key = Crypto::random_point();
+
+    transaction.stake_amount = amount;
+
+    transaction.candidate_public_key = candidate_key;
+
+    transaction.staker_public_view_key = Crypto::random_point();
+
+    transaction.staker_public_spend_key = Crypto::random_point();
+
+    return transaction;
+}
+
+int main(int argc, char **argv)
+{
+    auto cli = std::make_shared<Utilities::CLIHelper>(argv);
+
+    cli->parse(argc, argv);
+
+    // the frontier must yield the same root as root_hash() for every round length, including when restored mid-round
+    for (size_t leaf_count = 1; leaf_count <= FRONTIER_TEST_MAXIMUM_LEAVES; ++leaf_count)
+    {
+        std::vector<crypto_hash_t> hashes;
+
+        auto frontier = Core::merkle_frontier_t(leaf_count);
+
+        for (size_t i = 0; i < leaf_count; ++i)
+        {
+            hashes.push_back(Crypto::random_hash());
+
+            frontier.append(hashes.back());
+
+            if (i == leaf_count / 2)
+            {
+                frontier = Core::merkle_frontier_t(frontier.serialize());
+            }
+        }
+
+        if (!frontier.complete() || frontier.root() != Crypto::Hashing::Merkle::root_hash(hashes))
+        {
+            std::cout << "Merkle frontier does not match root_hash with " << leaf_count << " leaves" << std::endl;
+
+            exit(1);
+        }
+    }
+
+    {
+        std::vector<crypto_hash_t> round_blocks;
+
+        for (size_t i = 0; i < Configuration::Consensus::BLOCKS_PER_ROUND; ++i)
+        {
+            round_blocks.push_back(Crypto::random_hash());
+        }
+
+        std::cout << "Round seeds for a round of " << Configuration::Consensus::BLOCKS_PER_ROUND << " blocks"
+                  << std::endl
+                  << std::endl;
+
+        benchmark_header(40, 25);
+
+        // the seed used before the frontier: the whole round is hashed once its last block is stored
+        benchmark(
+            [&round_blocks]()
+            { [[maybe_unused]] const auto seed = Crypto::Hashing::Merkle::root_hash(round_blocks); },
+            "root_hash",
+            FRONTIER_TEST_ITERATIONS,
+            40,
+            25);
+
+        auto frontier = Core::merkle_frontier_t();
+
+        for (size_t i = 0; i + 1 < round_blocks.size(); ++i)
+        {
+            frontier.append(round_blocks[i]);
+        }
+
+        benchmark(
+            [&frontier, &round_blocks]()
+            {
+                auto last = frontier;
+
+                last.append(round_blocks.back());
+
+                [[maybe_unused]] const auto seed = last.root();
+            },
+            "merkle_frontier_t (last block)",
+            FRONTIER_TEST_ITERATIONS,
+            40,
+            25);
+
+        std::cout << std::endl;
+    }
+
+    auto db_path = cppfs::fs::open(BENCHMARK_DB_PATH);
+
+    db_path.removeDirectoryRec();
+
+    // the environment is opened without syncing each commit before the staking engine opens it
+    [[maybe_unused]] const auto env = Database::LMDB::getInstance(BENCHMARK_DB_PATH, MDB_NOSYNC);
+
+    auto engine = std::make_shared<Core::StakingEngine>(BENCHMARK_DB_PATH);
+
+    std::vector<crypto_public_key_t> candidates;
+
+    for (size_t i = 0; i < STAKE_TEST_CANDIDATES; ++i)
+    {
+        const auto candidate = candidate_node_t(
+            Crypto::random_point(), Crypto::random_point(), Crypto::random_point(), Crypto::random_hash());
+
+        const auto error = engine->add_candidate(candidate);
+
+        if (error)
+        {
+            std::cout << "Could not add candidate: " << error << std::endl;
+
+            exit(1);
+        }
+
+        candidates.push_back(candidate.public_signing_key);
+    }
+
+    std::vector<crypto_hash_t> stakers;
+
+    // each staker places one stake with one of the candidates
+    for (size_t i = 0; i < STAKE_TEST_STAKERS; ++i)
+    {
+        const auto staker = staker_t(Crypto::random_point(), Crypto::random_point());
+
+        const auto error =
+            engine->record_stake(staker, Crypto::random_hash(), candidates[i % candidates.size()], i + 1);
+
+        if (error)
+        {
+            std::cout << "Could not record stake: " << error << std::endl;
+
+            exit(1);
+        }
+
+        stakers.push_back(staker.id());
+    }
+
+    std::cout << "Staker lookups with " << STAKE_TEST_STAKERS << " stakers across " << STAKE_TEST_CANDIDATES
+              << " candidates" << std::endl
+              << std::endl;
+
+    benchmark_header(40, 25);
+
+    size_t staker_index = 0;
+
+    // the lookup used before the staker index: every stake of every candidate is visited
+    benchmark(
+        [&engine, &stakers, &staker_index]()
+        {
+            const auto &staker_id = stakers[staker_index++ % stakers.size()];
+
+            std::map<crypto_public_key_t, std::vector<stake_t>> results;
+
+            for (const auto &candidate_key : engine->get_candidates())
+            {
+                for (const auto &stake : engine->get_candidate_stakes(candidate_key))
+                {
+                    if (stake.staker_id == staker_id)
+                    {
+                        results[candidate_key].push_back(stake);
+                    }
+                }
+            }
+        },
+        "get_staker_stakes (scan)",
+        SCAN_TEST_ITERATIONS,
+        40,
+        25);
+
+    benchmark(
+        [&engine, &stakers, &staker_index]()
+        { [[maybe_unused]] const auto stakes = engine->get_staker_stakes(stakers[staker_index++ % stakers.size()]); },
+        "get_staker_stakes",
+        INDEX_TEST_ITERATIONS,
+        40,
+        25);
+
+    benchmark(
+        [&engine, &stakers, &candidates, &staker_index]()
+        {
+            const auto index = staker_index++;
+
+            [[maybe_unused]] const auto votes = engine->get_staker_candidate_votes(
+                stakers[index % stakers.size()], candidates[index % candidates.size()]);
+        },
+        "get_staker_candidate_votes",
+        INDEX_TEST_ITERATIONS,
+        40,
+        25);
+
+    std::cout << std::endl
+              << "Election vote tallies with " << STAKE_TEST_CANDIDATES << " candidates" << std::endl
+              << std::endl;
+
+    {
+        const auto [error, mismatches] = engine->check_vote_tallies();
+
+        if (error || !mismatches.empty())
+        {
+            std::cout << "Vote tallies do not match the stakes: " << mismatches.size() << " candidates" << std::endl;
+
+            exit(1);
+        }
+    }
+
+    std::vector<crypto_hash_t> last_round_blocks;
+
+    for (size_t i = 0; i < Configuration::Consensus::ELECTOR_TARGET_COUNT; ++i)
+    {
+        last_round_blocks.push_back(Crypto::random_hash());
+    }
+
+    benchmark_header(40, 25);
+
+    // the tallies used before they were materialized: every stake of every candidate is summed
+    benchmark(
+        [&engine]()
+        {
+            for (const auto &candidate_key : engine->get_candidates())
+            {
+                uint64_t votes = 0;
+
+                for (const auto &stake : engine->get_candidate_stakes(candidate_key))
+                {
+                    votes += stake.stake;
+                }
+            }
+        },
+        "candidate votes (scan)",
+        SCAN_TEST_ITERATIONS,
+        40,
+        25);
+
+    benchmark(
+        [&engine]() { [[maybe_unused]] const auto tallies = engine->get_candidate_tallies(); },
+        "get_candidate_tallies",
+        INDEX_TEST_ITERATIONS,
+        40,
+        25);
+
+    benchmark(
+        [&engine, &last_round_blocks]()
+        { [[maybe_unused]] const auto elected = engine->run_election(last_round_blocks); },
+        "run_election",
+        ELECTION_TEST_ITERATIONS,
+        40,
+        25);
+
+    std::cout << std::endl
+              << "Producer lookups for a round of " << Configuration::Consensus::BLOCKS_PER_ROUND << " blocks"
+              << std::endl
+              << std::endl;
+
+    {
+        const auto chain_path = std::string(BENCHMARK_DB_PATH) + "_chain";
+
+        auto chain_db_path = cppfs::fs::open(chain_path);
+
+        chain_db_path.removeDirectoryRec();
+
+        auto storage = std::make_shared<Core::BlockchainStorage>(chain_path);
+
+        std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>> blocks;
+
+        for (uint64_t block_index = 0; block_index < 2 * Configuration::Consensus::BLOCKS_PER_ROUND; ++block_index)
+        {
+            Types::Blockchain::genesis_transaction_t reward_tx;
+
+            reward_tx.tx_public_key = Crypto::random_point();
+
+            reward_tx.outputs = {
+                Types::Blockchain::transaction_output_t(Crypto::random_point(), 0, Crypto::random_point())};
+
+            Types::Blockchain::block_t block;
+
+            block.block_index = block_index;
+
+            block.timestamp = Configuration::GENESIS_BLOCK_TIMESTAMP + block_index;
+
+            block.reward_tx = reward_tx;
+
+            blocks.emplace_back(block, std::vector<Types::Blockchain::transaction_t>());
+        }
+
+        if (const auto error = storage->put_blocks(blocks))
+        {
+            std::cout << "Could not store blocks: " << error << std::endl;
+
+            exit(1);
+        }
+
+        auto scheduler = std::make_shared<Core::ElectionScheduler>(storage, engine);
+
+        for (const auto &[block, transactions] : blocks)
+        {
+            // the round seeds and tallies are saved by the staking engine as the blocks are applied
+            if (const auto error = engine->apply_block_staking(block, transactions))
+            {
+                std::cout << "Could not apply block: " << error << std::endl;
+
+                exit(1);
+            }
+
+            scheduler->block_stored(block.block_index);
+        }
+
+        scheduler->flush();
+
+        const auto round = Core::ElectionScheduler::round_of(blocks.size());
+
+        const auto [error, elected] = scheduler->get_election(round);
+
+        if (error || scheduler->stats().failed != 0)
+        {
+            std::cout << "Could not elect the next round: " << error << std::endl;
+
+            exit(1);
+        }
+
+        const auto [round_error, round_blocks] = storage->get_block_hashes(
+            blocks.size() - Configuration::Consensus::BLOCKS_PER_ROUND, blocks.size() - 1);
+
+        const auto producer = elected->producers.back();
+
+        benchmark_header(40, 25);
+
+        // the lookup used before the scheduler: the round is elected again for every block validated
+        benchmark(
+            [&engine, &round_blocks, &producer]()
+            {
+                const auto [producers, validators] = engine->run_election(round_blocks);
+
+                [[maybe_unused]] const auto found =
+                    std::find(producers.begin(), producers.end(), producer) != producers.end();
+            },
+            "is_producer (run_election)",
+            ELECTION_TEST_ITERATIONS,
+            40,
+            25);
+
+        benchmark(
+            [&scheduler, &round, &producer]()
+            { [[maybe_unused]] const auto found = scheduler->is_producer(round, producer); },
+            "is_producer",
+            LOOKUP_TEST_ITERATIONS,
+            40,
+            25);
+
+        scheduler.reset();
+
+        storage.reset();
+
+        chain_db_path.removeDirectoryRec();
+    }
+
+    engine.reset();
+
+    db_path.removeDirectoryRec();
+
+    std::cout << std::endl
+              << "Applying " << BLOCK_TEST_BLOCKS << " blocks of " << BLOCK_TEST_STAKES
+              << " stakes (syncing every commit)" << std::endl
+              << std::endl;
+
+    {
+        const auto run_path = std::string(BENCHMARK_DB_PATH) + "_blocks";
+
+        auto run_db_path = cppfs::fs::open(run_path);
+
+        run_db_path.removeDirectoryRec();
+
+        auto block_engine = std::make_shared<Core::StakingEngine>(run_path);
+
+        const auto candidate = candidate_node_t(
+            Crypto::random_point(), Crypto::random_point(), Crypto::random_point(), Crypto::random_hash());
+
+        [[maybe_unused]] const auto candidate_error = block_engine->add_candidate(candidate);
+
+        std::vector<std::pair<Types::Blockchain::block_t, std::vector<Types::Blockchain::transaction_t>>> blocks;
+
+        for (uint64_t block_index = 0; block_index < 2 * BLOCK_TEST_BLOCKS; ++block_index)
+        {
+            Types::Blockchain::block_t block;
+
+            block.block_index = block_index;
+
+            std::vector<Types::Blockchain::transaction_t> transactions;
+
+            for (size_t i = 0; i < BLOCK_TEST_STAKES; ++i)
+            {
+                const auto transaction = make_stake_transaction(candidate.public_signing_key, i + 1);
+
+                block.transactions.push_back(transaction.hash());
+
+                transactions.emplace_back(transaction);
+            }
+
+            blocks.emplace_back(block, transactions);
+        }
+
+        const auto report = [](const std::string &name, const std::chrono::high_resolution_clock::time_point &start)
+        {
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::high_resolution_clock::now() - start)
+                                     .count();
+
+            std::cout << std::setw(40) << std::left << name << std::setw(25) << std::right
+                      << std::to_string(uint64_t(double(BLOCK_TEST_BLOCKS) / (double(elapsed) / 1'000'000.0)))
+                             + " blocks/s"
+                      << std::endl;
+        };
+
+        // the first half of the blocks are recorded a stake at a time as they were before
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            for (size_t i = 0; i < BLOCK_TEST_BLOCKS; ++i)
+            {
+                for (const auto &transaction : blocks[i].second)
+                {
+                    const auto &stake_tx = std::get<Types::Blockchain::committed_stake_transaction_t>(transaction);
+
+                    const auto error = block_engine->record_stake(
+                        staker_t(stake_tx.staker_public_view_key, stake_tx.staker_public_spend_key),
+                        stake_tx.hash(),
+                        stake_tx.candidate_public_key,
+                        stake_tx.stake_amount);
+
+                    if (error)
+                    {
+                        std::cout << "Could not record stake: " << error << std::endl;
+
+                        exit(1);
+                    }
+                }
+            }
+
+            report("record_stake", start);
+        }
+
+        const auto votes_before = block_engine->get_candidate_votes(candidate.public_signing_key);
+
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            for (size_t i = BLOCK_TEST_BLOCKS; i < blocks.size(); ++i)
+            {
+                const auto error = block_engine->apply_block_staking(blocks[i].first, blocks[i].second);
+
+                if (error)
+                {
+                    std::cout << "Could not apply block staking: " << error << std::endl;
+
+                    exit(1);
+                }
+            }
+
+            report("apply_block_staking", start);
+        }
+
+        {
+            const auto start = std::chrono::high_resolution_clock::now();
+
+            for (size_t i = blocks.size(); i > BLOCK_TEST_BLOCKS; --i)
+            {
+                const auto error = block_engine->revert_block_staking(blocks[i - 1].first);
+
+                if (error)
+                {
+                    std::cout << "Could not revert block staking: " << error << std::endl;
+
+                    exit(1);
+                }
+            }
+
+            report("revert_block_staking", start);
+        }
+
+        const auto [error, mismatches] = block_engine->check_vote_tallies();
+
+        if (error || !mismatches.empty()
+            || block_engine->get_candidate_votes(candidate.public_signing_key) != votes_before)
+        {
+            std::cout << "Reverting the blocks did not restore the vote tallies" << std::endl;
+
+            exit(1);
+        }
+
+        block_engine.reset();
+
+        run_db_path.removeDirectoryRec();
+    }
+
+    return 0;
+}
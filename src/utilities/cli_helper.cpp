@@ -181,8 +181,20 @@ namespace Utilities
         }
     }
 
+    void CLIHelper::parse_positional(const std::vector<std::string> &options, const std::string &help)
+    {
+        m_options.parse_positional(options);
+
+        m_options.positional_help(help);
+    }
+
     void CLIHelper::print_cli_header()
     {
         std::cout << COLOR::green << get_cli_header() << COLOR::reset << std::flush;
     }
+
+    void CLIHelper::print_help()
+    {
+        std::cout << m_options.help({}) << std::endl;
+    }
 } // namespace Utilities
@@ -49,8 +49,12 @@ namespace Utilities
 
         void parse(int argc, char **argv);
 
+        void parse_positional(const std::vector<std::string> &options, const std::string &help);
+
         static void print_cli_header();
 
+        void print_help();
+
       private:
         cxxopts::Options m_options;
 